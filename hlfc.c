@@ -4,8 +4,58 @@
    Input:   File hlfcBookList.txt   - file list to be read (UTF8 BOM file)
             Files in the above lit will be automatically read, assumed code page = 1250 (Central Europe)
    Output:  File hlfcResult.txt     - result
+            Files hlfcResult.csv, hlfcResult.jsonl, hlfcResult.bin - the counts without the bar charts (--format)
+   Option:  -j N                    - count N books at the same time by N threads (0: number of CPUs)
+            --cache                 - count only the changed books, the others are from hlfcCache.bin
+            --cache-check           - count every book, report the wrong entries in hlfcCache.bin and update it
+            --cache-rebuild         - count every book and make hlfcCache.bin again
+            --follow                - keep running, count the bytes appended to the books and write hlfcResult.txt again
+            --follow-interval MS    - changes in MS milli seconds are put together (default: 1000)
+            --typing-model FILE     - read the typing methods and the business hours from FILE (e.g. hlfcTypingModel.txt)
+            --optimize              - search the keys of the hungarian letters for the shortest typing time of the books
+            --ngram                 - count the bigrams and the trigrams, report the hungarian letters as graphemes (cs, dzs, ...)
+            --ngram-top K           - number of bigrams and trigrams in the report (default: 20)
+            --words                 - word statistics, and the measured letters per word for the typing time
+            --words-top K           - number of words in the report (default: 10)
+            --words-memory MB       - max memory for the words of all the books (default: 1024)
+            --compact               - bounded memory for very many books:  small batches, packed books (not with --cache, --follow)
+            --encoding NAME         - encoding of the books:  auto (each book, default), cp1250, utf8, iso8859-2, cp852
+            --format LIST           - result files, comma separated:  text (hlfcResult.txt, default), csv, json, bin
+                                      hlfcResult.csv, .jsonl, .bin have the counts of each book and the grand total
+            --shard i/N             - count only the books at the position k of the book list, k % N = i-1 (i: 1 .. N)
+                                      writes only the partial result hlfcPart<i>of<N>.bin, unless --format is given
+            --partial FILE          - write the histogram of each book to the partial result FILE
+            --stats                 - time of each stage (wall, cpu), the slowest books, read calls and peak RSS to stderr
+            --stats-json FILE       - --stats, and the statistics with every book (bytes, MB/s) in FILE (JSON)
+            --sample TOL            - estimate a large book from random blocks, until the 95% confidence interval of every
+                                      percent in the bar chart is within +-TOL (e.g. 0.1) and the top letters are stable
+            --sample-block KB       - size of a sampled block (default: 64)
+            --sample-top N          - letters in the ranking to be stable, and their intervals in the report (default: 10)
+            --index                 - write the positional index BOOK.hlfcidx of each counted book, for hlfc query
+            --index-block KB        - bytes between the checkpoints of the index (default: 64).  larger: smaller index, slower query
+            --list FILE             - book list file, one title in a line.  "-" is stdin (default: hlfcBookList.txt)
+            SOURCE ...              - book files, directories (every file, recursively) or glob patterns, instead of the book list
    NOTE:    files have to be placed in the same location to the exe file
-            Books file's code page is 1250 (Central Europe).  Not Unicode/UTF-8.
+            Books file's code page is 1250 (Central Europe), UTF-8, ISO-8859-2 or CP852.  Each book is known by the BOM
+            or the first non-ASCII bytes.  A book is converted to CP1250, the other letters are counted as one letter (0x81).
+            Compressed books (gzip, zstd) are read without a temporary file, if compiled with
+            -DHLFC_ZLIB -lz (gzip) and -DHLFC_ZSTD -lzstd (zstd).  The format is known by the magic bytes.
+            A book in a tar or zip archive is "archive!member" (e.g. books.zip!Bukfenc.txt), read without extracting.
+            An archive (.tar, .zip) in the SOURCE or in the book list is all its members.
+            hlfcResult.bin is little endian columns (u64, and f64 for the typing seconds), to be memory mapped.
+            The layout is written in front of step15_printCsvHeader() in the source.
+   Merge:   hlfc merge [-j N] [--typing-model FILE] [--optimize] [--format LIST] hlfcPart1of4.bin ... hlfcPart4of4.bin
+            the report of the shards (e.g. 4 processes or machines), same as the run of all the books by one process.
+   Query:   hlfc query [-j N] [--typing-model FILE] [--format LIST] [--range FROM:TO ...] [--window KB [--window-step KB]] BOOK ...
+            the letters of the byte ranges of the books counted with --index (e.g. 0:64K, 1M:2M, 3M: is to the end),
+            from the index and the bytes after the nearest checkpoint.  --window KB:  a range at every --window-step KB,
+            the time series of the book, e.g. with --format csv.  Each range is a book of the report.
+   Library: hlfc.h - count the documents in the memory (init, update, merge, finalize, report to any sink),
+            compile hlfc.c with -DHLFC_LIBRARY (no main()).
+   Bench:   hlfc bench [-j N] [--typing-model FILE] [--format LIST] [--bench-mb MB] [--bench-books N] [DIR]
+            MB/s and books/s of the counting kernel, step10, the report and end-to-end runs on synthetic CP1250 books
+            (the letters of the [Grand Total]), by book size and book count.  The counts are checked.  (default: 64, 1000)
+            The books are in a new directory hlfcBench.XXXXXX in DIR (default: the temp directory), removed at the end.
 
    Written: DQ4WX0 - Takahiro FUJIWARA 
             2022.10.28. Initial version
@@ -14,10 +64,54 @@
             2022.10.31  Ver 0.3     Add typeing speed.  Support UTF-8 BOM header for the output file.
             2022.11.01  Ver 0.4     Add calculation of business hours in a year.
             2022.11.03  Ver 0.5     Support typing error correction rate.  Bug fix for the slowest, 2nd slowest logic
+            2026.10.16  Ver 0.6     Table driven CP1250 character class and upper case.  Same count without the Hungarian locale.
+            2026.10.16  Ver 0.7     Count only the raw histogram per book.  Other counters and grand total are derived from it.
+            2026.10.16  Ver 0.8     Read a book by mmap() or large read() buffer.  CRLF is one newline on every OS.
+            2026.10.16  Ver 0.9     Option -j N: count the books by N threads.  The result is printed in the book list order.
+            2026.10.16  Ver 0.10    Option -j N: a very large book is split into chunks and counted by N threads.
+            2026.10.16  Ver 0.11    Option --cache: keep the histogram of each book in hlfcCache.bin, count only the changed books.
+            2026.10.16  Ver 0.12    Option --follow: count the appended bytes of the books and write the result again.
+            2026.10.16  Ver 0.13    Typing time by the cost vector of each method.  Option --typing-model FILE.
+            2026.10.16  Ver 0.14    Option --optimize: keyboard layout optimizer, the exact assignment by sorting.
+            2026.10.16  Ver 0.15    Option --ngram: bigrams, trigrams and graphemes in the same pass.
+            2026.10.16  Ver 0.16    Option --words: word statistics, measured letters per word.
+            2026.10.16  Ver 0.17    Book list in one pass, from --list FILE, stdin, directories and glob patterns.  Stream mode.
+            2026.10.16  Ver 0.18    Option --compact: small batches, packed books with 32 bits counters for --optimize.
+            2026.10.16  Ver 0.19    Compressed books (gzip, zstd), decompressed by a pipe thread during the count.
+            2026.10.16  Ver 0.20    Books in tar and zip archives (archive!member), stored members without a copy.
+            2026.10.16  Ver 0.21    UTF-8 books, decoded to CP1250.  Option --encoding NAME, auto detection for each book.
+            2026.10.16  Ver 0.22    Built-in codepage tables (CP1250, ISO-8859-2, CP852), the report without the OS conversion.
+            2026.10.16  Ver 0.23    Report made in the memory by tables, the books by the threads (-j N), written in order.
+            2026.10.16  Ver 0.24    Option --format LIST: CSV, JSON lines and binary columns of the counts, the report is optional.
+            2026.10.16  Ver 0.25    Option --shard i/N, --partial FILE: partial results, merged by "hlfc merge".
+            2026.10.16  Ver 0.26    hlfc bench:  synthetic books, throughput of each stage and the check of the counts.
+            2026.10.16  Ver 0.27    Option --stats, --stats-json FILE:  time of each stage, the books and the reads.
+            2026.10.16  Ver 0.28    Library hlfc.h (-DHLFC_LIBRARY):  the counter for the documents in the memory.
+            2026.10.16  Ver 0.29    Option --sample TOL:  large books estimated from random blocks, with the confidence interval.
+            2026.10.16  Ver 0.30    Option --index:  checkpoints of the histogram.  hlfc query:  byte ranges and windows of a book.
  *************************************************************************************************************/
 #include <stdio.h>
+#include <stdarg.h>
+#include <signal.h>
 #if defined(_WIN32) || defined(_WIN64)
 #   include <windows.h>
+#   include <psapi.h>
+#   define strncasecmp _strnicmp
+#else
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <unistd.h>
+#   include <errno.h>
+#   include <pthread.h>
+#   include <time.h>
+#   include <dirent.h>
+#   include <glob.h>
+#   include <sys/resource.h>
+#endif
+#if defined(__linux__)
+#   include <sys/inotify.h>
+#   include <poll.h>
 #endif
 #include <locale.h>
 #include <stdlib.h>
@@ -27,23 +121,48 @@
 #include <string.h>
 #include <math.h>
 #include <limits.h>
+#if defined(HLFC_ZLIB)                                  // compile with -DHLFC_ZLIB and link zlib:  .gz books
+#   include <zlib.h>
+#endif
+#if defined(HLFC_ZSTD)                                  // compile with -DHLFC_ZSTD and link libzstd:  .zst books
+#   include <zstd.h>
+#endif
+#include "hlfc.h"                                       // the library:  compile with -DHLFC_LIBRARY, no main()
+#if defined(HLFC_LIBRARY) && defined(__GNUC__)          // everything but hlfc*() is static:  the steps of the command are not used
+#   pragma GCC diagnostic ignored "-Wunused-function"
+#   pragma GCC diagnostic ignored "-Wunused-variable"
+#endif
 #define MIN(a,b) (((a) < (b)) ? (a) : (b))
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
 #define PROGNAME "hlfc"
 #define BOOKLIST (PROGNAME "BookList.txt")
 #define OUTPUTFILE (PROGNAME "Result.txt")
+#define CACHEFILE (PROGNAME "Cache.bin")
+#define BENCH_DIR (PROGNAME "Bench")                    // hlfc bench:  prefix of the new directory of the synthetic books
+#define INDEX_EXT ("." PROGNAME "idx")                  // --index:  positional index of a book, "BOOK.hlfcidx"
 #define COMMENTSYMBOL '#'                               // comment start symbol in the book list
 #define LC_CTYPE_HUNGARY    "Hungarian_Hungary.1250"    // 2nd parameter for setlocale.  good value: "Hungarian_Hungary.1250"
                                                         // 1250 is the code page (central Europe, windows)
                                                         // isalpha() works with hungarian letters áéíóőöúűü ÁÉÍÓŐÖÚŰÜ
                                                         // other function need to check.  e.g. toupper(), ispunct()...
 #define BOM_UTF8    "\xef\xbb\xbf"                      // BOM (Byte Order Mark) for UTF-8
-#define NUM_OF_TYPINGMETHOD         3                   // number of typing Method to be estimated the time
+#define MAX_TYPINGMETHOD            HLFC_MAX_TYPINGMETHOD   // max number of typing Method to be estimated the time
 
 // ------------------------ Letter Frequency
 struct bookFrequency {
     char *bookTitle;
+    unsigned long long bytes;                           // size of the book, counted by step10_calcBookFrequency()
+    unsigned long long fileSize;                        // --cache: file size when the book is counted
+    unsigned long long mtime;                           // --cache: last modified time when the book is counted
+    unsigned long long hash;                            // --cache: content hash, calculated by step10_calcBookFrequency()
+    bool cached;                                        // --cache: the letter frequency is from the cache.  no need to count
+    unsigned long long offset;                          // bytes in the file already counted.  --follow counts from here
+    int encoding;                                       // ENCODING_AUTO (not known yet), ENCODING_CP1250, ENCODING_UTF8 ...
+    struct ngramFrequency *pNgram;                      // --ngram:  bigram and trigram of the book.  NULL: no n-gram
+    struct wordFrequency *pWords;                       // --words:  words of the book.  NULL: no word statistics
+    struct sampleFrequency *pSample;                    // --sample:  the sampled blocks of the book.  NULL: counted fully
     struct letterFrequency {
+        unsigned long long raw[256];                    // raw count of each byte in a book (before toupper1250)
         unsigned long long c[256];                      // frequency count of this letter in a book
         unsigned char sortIdx[256];                     // sort index
         unsigned long long totalAlphabets;              // count of total hungarian alphabet
@@ -51,19 +170,31 @@ struct bookFrequency {
         unsigned long long punctuation;                 // count of punctuation letters, using ispunct1250()
         unsigned long long digit;                       // count of digit numbers, using isdigit()
         unsigned long long totalLetters;                // count of total letters = without white space, using isspace()
+        double lettersPerWord;                          // --words:  measured average word length.  0: not measured
         struct typingTimeforBook {
             double typingSecondForBook;                 // total typing time for this book
             int    sortIdx;                             // slow index of this method
-        } typingMethod[NUM_OF_TYPINGMETHOD];
+        } typingMethod[MAX_TYPINGMETHOD];
                                                         // calcuated speed in a program
     } lf;
 };
 
-struct totalFrequency {
+static struct totalFrequency {
     int books;
     struct letterFrequency lf;
+    struct ngramFrequency *pNgram;                      // --ngram:  n-gram of every books.  NULL: no n-gram
+    struct wordFrequency *pWords;                       // --words:  words of every books.  NULL: no word statistics
 } grandTotal = { 0 };
 
+static struct sampleFrequency {                     // --sample:  a book estimated from the blocks, or the sum of the books
+    unsigned long long books;                       // books estimated.  0: counted fully
+    unsigned long long blocks;                      // blocks of the estimated books (--sample-block KB)
+    unsigned long long sampledBlocks;               // blocks read
+    unsigned long long bytes;                       // file size of the estimated books
+    unsigned long long sampledBytes;                // bytes read
+    double var[3][256];                             // variance of the count of each letter (lf.c[]):  coefficients of p^0, p^1, p^2
+} sampleTotal = { 0 };
+
 // ------------------------ Typing Speed
 #define TYPINGSPEED_REGULARPOS      (60./(50.*0.95*5))   // 40-60wpm  (average 50 * accuracy(95%)     https://thenaturehero.com/type-with-two-fingers/
 #define TYPINGSPEED_UNREGULARPOS    (60./(27.*0.85*5.))  // 27wpm (slow averag 27 * accuracy(85%)  in two-fingers typing speed. https://thenaturehero.com/type-with-two-fingers/
@@ -88,60 +219,140 @@ struct typingMethod {
     struct {
         double typeSpeed;
     } unregularPosition;
-} typingMethod[NUM_OF_TYPINGMETHOD] = {
+    double cost[256];                               // seconds to type each letter, made by compileTypingMethod()
+};
+static const struct typingMethod builtinTypingMethod[] = {
     {   // [0]
-        "Method[a]", "Hungarian keyboard",
+        .shortName10 = "Method[a]", .name = "Hungarian keyboard",
         //  if the hungarian letter is same position on the familiar keyboard, then the speed is TYPINGSPEED_REGULARPOS
-        {   // regular position letters - regular position means the position is same as compared KEYBOARD (JP/US/...)
-            KEYBOARD_REGLARPOS_JP,
-            TYPINGSPEED_REGULARPOS
+        .regularPosition = {   // regular position letters - regular position means the position is same as compared KEYBOARD (JP/US/...)
+            .letter = KEYBOARD_REGLARPOS_JP,
+            .typeSpeed = TYPINGSPEED_REGULARPOS
         },
         //  other keys - different position, then the speed will be TYPINGSPEED_UNREGULARPOS which means similar to two-fingers typing
-        {   // unregular position letters
-            TYPINGSPEED_UNREGULARPOS                // other letter speed is slow. = speed is almost same as unregular key.
+        .unregularPosition = {   // unregular position letters
+            .typeSpeed = TYPINGSPEED_UNREGULARPOS   // other letter speed is slow. = speed is almost same as unregular key.
         }
     },
     {   // [1]
-        "Method[b]", "Use mouse",
+        .shortName10 = "Method[b]", .name = "Use mouse",
         // This is the base - familiar keyboard. speed is fast which means TYPINGSPEED_REGULARPOS
-        {   // regular position letters
-            KEYBOARD_LETTERS_JP,                    //  This is the regular position 
-            TYPINGSPEED_REGULARPOS
+        .regularPosition = {   // regular position letters
+            .letter = KEYBOARD_LETTERS_JP,          //  This is the regular position 
+            .typeSpeed = TYPINGSPEED_REGULARPOS
         },
         // however, other letter = unable to type by the regular key = need to use screen keyboard = need mouse and back to the keyboard.
-        {   // unregular position letters           // The time of 'use mouse and back to the keyboard'
-            TYPINGSPEED_MOUSE
+        .unregularPosition = {   // unregular position letters   // The time of 'use mouse and back to the keyboard'
+            .typeSpeed = TYPINGSPEED_MOUSE
         }
     },
     {   // [2]
-        "Method[c]", "Use shortcut key",
+        .shortName10 = "Method[c]", .name = "Use shortcut key",
         // This is also the base - familar keyboard.  speed is fast which means TYPINGSPEED_REGULARPOS
         // (there is no unfamiliar key on the keyboard.  A letter which is not on in the list here, that means hungarian special letter.)
-        { 
-            KEYBOARD_LETTERS_JP,
-            TYPINGSPEED_REGULARPOS
+        .regularPosition = { 
+            .letter = KEYBOARD_LETTERS_JP,
+            .typeSpeed = TYPINGSPEED_REGULARPOS
         },
         // however, other letter = unable to type by the regular key = need to use shortcut key.
-        { 
-            TYPINGSPEED_REGULARPOS*2                // shortcut key.  E.g., Ctrl+' then a = á.  that means 2 key stroke.
+        .unregularPosition = { 
+            .typeSpeed = TYPINGSPEED_REGULARPOS*2   // shortcut key.  E.g., Ctrl+' then a = á.  that means 2 key stroke.
         }
     }   
 };
+static struct typingModel {                         // the business hours and the typing methods, see loadTypingModel()
+    int workingHours;                               // business working hours in a day
+    int typingHours;                                // business typing hours in a day
+    int daysInYear;                                 // working business days in a year
+    int lettersPerWord;                             // 1 word = N letters
+    const char *fname;                              // typing model file (--typing-model).  NULL: built-in model
+    int methods;                                    // number of methods in method[]
+    struct typingMethod method[MAX_TYPINGMETHOD];
+} typingModel;                                      // the model of the command, main() loads it.  the library has its own
+
+// -------------------------------- Command line option
+#define RESULT_TEXT         0                       // hlfcResult.txt:     the report, bar charts (default)
+#define RESULT_CSV          1                       // hlfcResult.csv:     a line for each book
+#define RESULT_JSON         2                       // hlfcResult.jsonl:   a JSON object in a line for each book
+#define RESULT_BIN          3                       // hlfcResult.bin:     little endian columns, to be memory mapped
+#define RESULT_FORMATS      4
+static struct resultFormat {
+    char *name;                                     // name in --format
+    char *ext;                                      // extension of the result file, instead of ".txt"
+} resultFormat[RESULT_FORMATS] = { { "text", ".txt" }, { "csv", ".csv" }, { "json", ".jsonl" }, { "bin", ".bin" } };
+
+static struct hlfcOption {
+    int jobs;                                       // -j N:  number of threads to count the books.  1: serial
+    int cache;                                      // --cache:  CACHE_OFF, CACHE_USE, CACHE_CHECK, CACHE_REBUILD
+    bool follow;                                    // --follow:  watch the books and count the appended bytes
+    int followInterval;                             // --follow-interval MS:  changes in this time are put together
+    bool optimize;                                  // --optimize:  search the keyboard layout for the hungarian letters
+    bool ngram;                                     // --ngram:  count the bigrams and the trigrams too
+    int ngramTop;                                   // --ngram-top K:  number of n-grams in the report
+    bool words;                                     // --words:  word statistics, the measured letters per word
+    int wordsTop;                                   // --words-top K:  number of words in the report
+    int wordsMemory;                                // --words-memory MB:  max memory for the words of all the books
+    bool compact;                                   // --compact:  the state of a book is used again soon after it is printed
+    int encoding;                                   // --encoding NAME:  ENCODING_AUTO, ENCODING_CP1250, ENCODING_UTF8 ...
+    int formats;                                    // --format LIST:  bits of RESULT_TEXT, RESULT_CSV, RESULT_JSON, RESULT_BIN
+    int shard;                                      // --shard i/N:  i (1 .. N), the books of this process
+    int shards;                                     // --shard i/N:  N.  1: every book
+    char *partialFName;                             // --partial FILE:  partial result file.  NULL: not written
+    bool merge;                                     // hlfc merge FILE ...:  the report from the partial result files
+    bool bench;                                     // hlfc bench [DIR]:  synthetic books, throughput of each stage
+    int benchMb;                                    // --bench-mb MB:  bytes of the kernel buffer and the book size sweep
+    int benchBooks;                                 // --bench-books N:  max books of a set
+    bool stats;                                     // --stats:  time of each stage, the books and the reads to stderr
+    char *statsFName;                               // --stats-json FILE:  the statistics and every book in FILE (JSON)
+    double sample;                                  // --sample TOL:  half width of the confidence interval in percent.  0: no sampling
+    int sampleBlock;                                // --sample-block KB:  size of a sampled block
+    int sampleTop;                                  // --sample-top N:  letters in the ranking to be stable
+    bool index;                                     // --index:  write the positional index of each counted book
+    int indexBlock;                                 // --index-block KB:  bytes between the checkpoints
+    bool query;                                     // hlfc query BOOK ...:  the byte ranges of the books by the index
+    struct byteRange {
+        unsigned long long from;
+        unsigned long long to;                      // ULLONG_MAX:  to the end of the book
+    } *ranges;                                      // --range FROM:TO ...  none: the whole book
+    int numOfRanges;
+    int window;                                     // --window KB:  a range at every step.  0: --range
+    int windowStep;                                 // --window-step KB:  0: same as the window
+    struct bookSource {
+        bool list;                                  // true: book list file (--list FILE, "-").  false: file, directory, glob
+        char *name;
+    } *sources;                                     // sources of the book titles.  none: BOOKLIST
+    int numOfSources;
+    char *typingModelFName;                         // --typing-model FILE:  NULL: built-in typing model
+} option = {                                        // the defaults.  the other options are 0, false, NULL
+    .jobs = 1,
+    .followInterval = 1000,
+    .ngramTop = 20,
+    .wordsTop = 10,
+    .wordsMemory = 1024,
+    .formats = 1 << RESULT_TEXT,
+    .shard = 1,
+    .shards = 1,
+    .benchMb = 64,
+    .benchBooks = 1000,
+    .sampleBlock = 64,
+    .sampleTop = 10,
+    .indexBlock = 64,
+};
 
 // -------------------------------- General libraries
-FILE *spOutputFile;                                 // all output will be here
+static FILE *spOutputFile;                          // all output will be here
 
 /**********************************************
     libraries
 ***********************************************/
-char *ltrim(char *s) {
+static char *ltrim(char *s) {
     while(isspace(*s)) {
         s++;
     }
     return s;
 }
 
-char *rtrim(char *s) {
+static char *rtrim(char *s) {
     char* back = s + strlen(s);
     while(isspace(*(--back))) {
         // do nothing
@@ -150,79 +361,205 @@ char *rtrim(char *s) {
     return s;
 }
 
-char *trim(char *s) {
+static char *trim(char *s) {
     return rtrim(ltrim(s)); 
 }
 
-static unsigned char hungarianLowerLetters[] = HUNGARIAN_LOWERLETTERS;
-static unsigned char hungarianUpperLetters[] = HUNGARIAN_UPPERLETTERS;
-//                                      –   “   ’   ‘   …   „   ‚   «   °    
-static unsigned char hungarianPunctuation[]  = "\x96\x93\x92\x91\x85\x84\x82\xab\xb0"
-//                                      »   ×   ä   ç   ô
-                                      "\xbb\xd7\xe4\xe7\xf4";
 /*
-    isHungarian() for CP1250
-    true only for Hungarian special letter áéíóőöúűü ÁÉÍÓŐÖÚŰÜ
+    Character class table for CP1250 (Central Europe)
+    Built at compile time.  Same result as isalpha(), ispunct(), ... with setlocale(LC_CTYPE, "Hungarian_Hungary.1250"),
+    so that the count does not depend on the locale of the OS.  (Linux usually does not have the locale)
+    CP1250_PUNCT also includes the special punctuation  – — “ ” ’ ‘ … „ ‚ ‹ › « » • · § © ° ×  and  ä ç ô  (not a Hungarian letter),
+    CP1250_SPACE also includes the no-break space 0xA0
 */
-int isHungarian(int c) {
-    for ( int i=0; i<sizeof(hungarianLowerLetters)/sizeof(hungarianLowerLetters[0]); i++ ) {
-        if (c == hungarianLowerLetters[i]) {
-            return true;
-        }
-    }
-    for ( int i=0; i<sizeof(hungarianUpperLetters)/sizeof(hungarianUpperLetters[0]); i++ ) {
-        if (c == hungarianUpperLetters[i]) {
-            return true;
-        }
-    }
-    return false;
-}
+#define CP1250_ALPHA        0x01                    // alphabet letter, same as isalpha() of the Hungarian locale
+#define CP1250_HUNGARIAN    0x02                    // Hungarian special letter áéíóőöúűü ÁÉÍÓŐÖÚŰÜ
+#define CP1250_PUNCT        0x04                    // punctuation letter
+#define CP1250_DIGIT        0x08                    // [0-9] digit numbers
+#define CP1250_SPACE        0x10                    // white space
+#define A_  CP1250_ALPHA
+#define H_  CP1250_HUNGARIAN
+#define P_  CP1250_PUNCT
+#define D_  CP1250_DIGIT
+#define S_  CP1250_SPACE
+static const unsigned char cp1250Class[256] = {
+    /* 0_ */ 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0    , S_   , S_   , S_   , S_   , S_   , 0    , 0,
+    /* 1_ */ 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0    , 0,
+    /* 2_ */ S_   , P_   , P_   , P_   , P_   , P_   , P_   , P_   , P_   , P_   , P_   , P_   , P_   , P_   , P_   , P_,
+    /* 3_ */ D_   , D_   , D_   , D_   , D_   , D_   , D_   , D_   , D_   , D_   , P_   , P_   , P_   , P_   , P_   , P_,
+    /* 4_ */ P_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_,
+    /* 5_ */ A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , P_   , P_   , P_   , P_   , P_,
+    /* 6_ */ P_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_,
+    /* 7_ */ A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_   , P_   , P_   , P_   , P_   , 0,
+    /* 8_ */ 0    , 0    , P_   , 0    , P_   , P_   , 0    , 0    , 0    , 0    , A_   , P_   , A_   , A_   , A_   , A_,
+    /* 9_ */ 0    , P_   , P_   , P_   , P_   , P_   , P_   , P_   , 0    , 0    , A_   , P_   , A_   , A_   , A_   , A_,
+    /* A_ */ S_   , A_   , 0    , A_   , 0    , A_   , 0    , P_   , 0    , P_   , A_   , P_   , 0    , 0    , 0    , A_,
+    /* B_ */ P_   , 0    , 0    , A_   , 0    , A_   , 0    , P_   , 0    , A_   , A_   , P_   , A_   , 0    , A_   , A_,
+    /* C_ */ A_   , A_|H_, A_   , A_   , A_   , A_   , A_   , A_   , A_   , A_|H_, A_   , A_   , A_   , A_|H_, A_   , A_,
+    /* D_ */ A_   , A_   , A_   , A_|H_, A_   , A_|H_, A_|H_, P_   , A_   , A_   , A_|H_, A_|H_, A_|H_, A_   , A_   , A_,
+    /* E_ */ A_   , A_|H_, A_   , A_   , A_|P_, A_   , A_   , A_|P_, A_   , A_|H_, A_   , A_   , A_   , A_|H_, A_   , A_,
+    /* F_ */ A_   , A_   , A_   , A_|H_, A_|P_, A_|H_, A_|H_, 0    , A_   , A_   , A_|H_, A_|H_, A_|H_, A_   , A_   , 0,
+};
+#undef A_
+#undef H_
+#undef P_
+#undef D_
+#undef S_
+/*
+    Upper case table for CP1250 (Central Europe)
+    also convert áúóíéüöűő to ÁÚÓÍÉÜÖŰŐ, and the other Central Europe letters e.g. š to Š
+*/
+static const unsigned char cp1250Upper[256] = {
+    /* 0_ */ 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    /* 1_ */ 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+    /* 2_ */ 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f,
+    /* 3_ */ 0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b, 0x3c, 0x3d, 0x3e, 0x3f,
+    /* 4_ */ 0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+    /* 5_ */ 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x5b, 0x5c, 0x5d, 0x5e, 0x5f,
+    /* 6_ */ 0x60, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x4b, 0x4c, 0x4d, 0x4e, 0x4f,
+    /* 7_ */ 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x7b, 0x7c, 0x7d, 0x7e, 0x7f,
+    /* 8_ */ 0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8a, 0x8b, 0x8c, 0x8d, 0x8e, 0x8f,
+    /* 9_ */ 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x8a, 0x9b, 0x8c, 0x8d, 0x8e, 0x8f,
+    /* A_ */ 0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab, 0xac, 0xad, 0xae, 0xaf,
+    /* B_ */ 0xb0, 0xb1, 0xb2, 0xa3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xa5, 0xaa, 0xbb, 0xbc, 0xbd, 0xbc, 0xaf,
+    /* C_ */ 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+    /* D_ */ 0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xdf,
+    /* E_ */ 0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf,
+    /* F_ */ 0xd0, 0xd1, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xf7, 0xd8, 0xd9, 0xda, 0xdb, 0xdc, 0xdd, 0xde, 0xff,
+};
+
 /*
     toupper() for CP1250
     also convert áúóíéüöűő to ÁÚÓÍÉÜÖŰŐ 
 */
-int toupper1250(int c) {
-    for ( int i=0; i<sizeof(hungarianLowerLetters)/sizeof(hungarianLowerLetters[0]); i++ ) {
-        if (c == hungarianLowerLetters[i]) {
-            return hungarianUpperLetters[i];
-        }
-    }
-    return toupper(c);
+static int toupper1250(int c) {
+    return cp1250Upper[(unsigned char)c];
 }
 
 /*
     isalpha() for CP1250
     also true for áúóíéüöűő and ÁÚÓÍÉÜÖŰŐ
 */
-int isalpha1250(int c) {
-    if ( isHungarian(c) ) {
-        return true;
+static int isalpha1250(int c) {
+    return (cp1250Class[(unsigned char)c] & CP1250_ALPHA) != 0;
+}
+
+static int ispunct1250(int c) {
+    return (cp1250Class[(unsigned char)c] & CP1250_PUNCT) != 0;
+}
+/*
+    Codepage
+    built-in tables, no conversion by the OS.  Each codepage has the Unicode of 0x80-0xff (0: not used).
+    The books in ISO-8859-2 or CP852 are converted to CP1250 by toCp1250[] before the count, so the counters are only
+    for CP1250.  The report is printed by cp1250Utf8[], the UTF-8 string of each CP1250 letter.
+    A letter which is not in CP1250 is CP1250_OTHER, counted as a letter but not an alphabet.
+    õ û Õ Û are ő ű Ő Ű (Latin-1 had no ő ű, old texts use them).
+*/
+#define ENCODING_AUTO       HLFC_ENCODING_AUTO      // not known yet:  decided by the first non-ASCII bytes
+#define ENCODING_CP1250     HLFC_ENCODING_CP1250
+#define ENCODING_UTF8       HLFC_ENCODING_UTF8
+#define ENCODING_ISO8859_2  HLFC_ENCODING_ISO8859_2
+#define ENCODING_CP852      HLFC_ENCODING_CP852     // DOS Central Europe
+#define ENCODINGS           5
+#define CP1250_OTHER        0x81                    // a letter which is not in CP1250 (0x81 is not used in CP1250)
+
+static const unsigned short cp1250Unicode[128] = {
+    /* 8_ */ 0x20ac, 0     , 0x201a, 0     , 0x201e, 0x2026, 0x2020, 0x2021, 0     , 0x2030, 0x0160, 0x2039, 0x015a, 0x0164, 0x017d, 0x0179,
+    /* 9_ */ 0     , 0x2018, 0x2019, 0x201c, 0x201d, 0x2022, 0x2013, 0x2014, 0     , 0x2122, 0x0161, 0x203a, 0x015b, 0x0165, 0x017e, 0x017a,
+    /* A_ */ 0x00a0, 0x02c7, 0x02d8, 0x0141, 0x00a4, 0x0104, 0x00a6, 0x00a7, 0x00a8, 0x00a9, 0x015e, 0x00ab, 0x00ac, 0x00ad, 0x00ae, 0x017b,
+    /* B_ */ 0x00b0, 0x00b1, 0x02db, 0x0142, 0x00b4, 0x00b5, 0x00b6, 0x00b7, 0x00b8, 0x0105, 0x015f, 0x00bb, 0x013d, 0x02dd, 0x013e, 0x017c,
+    /* C_ */ 0x0154, 0x00c1, 0x00c2, 0x0102, 0x00c4, 0x0139, 0x0106, 0x00c7, 0x010c, 0x00c9, 0x0118, 0x00cb, 0x011a, 0x00cd, 0x00ce, 0x010e,
+    /* D_ */ 0x0110, 0x0143, 0x0147, 0x00d3, 0x00d4, 0x0150, 0x00d6, 0x00d7, 0x0158, 0x016e, 0x00da, 0x0170, 0x00dc, 0x00dd, 0x0162, 0x00df,
+    /* E_ */ 0x0155, 0x00e1, 0x00e2, 0x0103, 0x00e4, 0x013a, 0x0107, 0x00e7, 0x010d, 0x00e9, 0x0119, 0x00eb, 0x011b, 0x00ed, 0x00ee, 0x010f,
+    /* F_ */ 0x0111, 0x0144, 0x0148, 0x00f3, 0x00f4, 0x0151, 0x00f6, 0x00f7, 0x0159, 0x016f, 0x00fa, 0x0171, 0x00fc, 0x00fd, 0x0163, 0x02d9,
+};
+static const unsigned short iso8859_2Unicode[128] = {
+    /* 8_ */ 0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087, 0x0088, 0x0089, 0x008a, 0x008b, 0x008c, 0x008d, 0x008e, 0x008f,
+    /* 9_ */ 0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097, 0x0098, 0x0099, 0x009a, 0x009b, 0x009c, 0x009d, 0x009e, 0x009f,
+    /* A_ */ 0x00a0, 0x0104, 0x02d8, 0x0141, 0x00a4, 0x013d, 0x015a, 0x00a7, 0x00a8, 0x0160, 0x015e, 0x0164, 0x0179, 0x00ad, 0x017d, 0x017b,
+    /* B_ */ 0x00b0, 0x0105, 0x02db, 0x0142, 0x00b4, 0x013e, 0x015b, 0x02c7, 0x00b8, 0x0161, 0x015f, 0x0165, 0x017a, 0x02dd, 0x017e, 0x017c,
+    /* C_ */ 0x0154, 0x00c1, 0x00c2, 0x0102, 0x00c4, 0x0139, 0x0106, 0x00c7, 0x010c, 0x00c9, 0x0118, 0x00cb, 0x011a, 0x00cd, 0x00ce, 0x010e,
+    /* D_ */ 0x0110, 0x0143, 0x0147, 0x00d3, 0x00d4, 0x0150, 0x00d6, 0x00d7, 0x0158, 0x016e, 0x00da, 0x0170, 0x00dc, 0x00dd, 0x0162, 0x00df,
+    /* E_ */ 0x0155, 0x00e1, 0x00e2, 0x0103, 0x00e4, 0x013a, 0x0107, 0x00e7, 0x010d, 0x00e9, 0x0119, 0x00eb, 0x011b, 0x00ed, 0x00ee, 0x010f,
+    /* F_ */ 0x0111, 0x0144, 0x0148, 0x00f3, 0x00f4, 0x0151, 0x00f6, 0x00f7, 0x0159, 0x016f, 0x00fa, 0x0171, 0x00fc, 0x00fd, 0x0163, 0x02d9,
+};
+static const unsigned short cp852Unicode[128] = {
+    /* 8_ */ 0x00c7, 0x00fc, 0x00e9, 0x00e2, 0x00e4, 0x016f, 0x0107, 0x00e7, 0x0142, 0x00eb, 0x0150, 0x0151, 0x00ee, 0x0179, 0x00c4, 0x0106,
+    /* 9_ */ 0x00c9, 0x0139, 0x013a, 0x00f4, 0x00f6, 0x013d, 0x013e, 0x015a, 0x015b, 0x00d6, 0x00dc, 0x0164, 0x0165, 0x0141, 0x00d7, 0x010d,
+    /* A_ */ 0x00e1, 0x00ed, 0x00f3, 0x00fa, 0x0104, 0x0105, 0x017d, 0x017e, 0x0118, 0x0119, 0x00ac, 0x017a, 0x010c, 0x015f, 0x00ab, 0x00bb,
+    /* B_ */ 0x2591, 0x2592, 0x2593, 0x2502, 0x2524, 0x00c1, 0x00c2, 0x011a, 0x015e, 0x2563, 0x2551, 0x2557, 0x255d, 0x017b, 0x017c, 0x2510,
+    /* C_ */ 0x2514, 0x2534, 0x252c, 0x251c, 0x2500, 0x253c, 0x0102, 0x0103, 0x255a, 0x2554, 0x2569, 0x2566, 0x2560, 0x2550, 0x256c, 0x00a4,
+    /* D_ */ 0x0111, 0x0110, 0x010e, 0x00cb, 0x010f, 0x0147, 0x00cd, 0x00ce, 0x011b, 0x2518, 0x250c, 0x2588, 0x2584, 0x0162, 0x016e, 0x2580,
+    /* E_ */ 0x00d3, 0x00df, 0x00d4, 0x0143, 0x0144, 0x0148, 0x0160, 0x0161, 0x0154, 0x00da, 0x0155, 0x0170, 0x00fd, 0x00dd, 0x0163, 0x00b4,
+    /* F_ */ 0x00ad, 0x02dd, 0x02db, 0x02c7, 0x02d8, 0x00a7, 0x00f7, 0x00b8, 0x00b0, 0x00a8, 0x02d9, 0x0171, 0x0158, 0x0159, 0x25a0, 0x00a0,
+};
+
+static struct codepage {
+    const char *name;                               // --encoding NAME
+    const unsigned short *unicode;                  // 0x80-0xff.  NULL: not a single byte codepage
+    unsigned char toCp1250[256];                    // made by initCodepage()
+} codepage[ENCODINGS] = {                           // index: ENCODING_*
+    { .name = "auto" },
+    { .name = "cp1250",     .unicode = cp1250Unicode },
+    { .name = "utf8" },
+    { .name = "iso8859-2",  .unicode = iso8859_2Unicode },
+    { .name = "cp852",      .unicode = cp852Unicode },
+};
+static char cp1250Utf8[256][4];                     // UTF-8 string of each CP1250 letter, made by initCodepage()
+
+/*
+    CP1250 letter of the Unicode
+    return: CP1250_OTHER if not in CP1250
+*/
+static int unicodeToCp1250(unsigned int cp) {
+    if ( cp < 0x80 ) {
+        return cp;
     }
-    return isalpha(c);
+    for ( int i=0; i<128; i++ ) {
+        if ( cp1250Unicode[i] == cp ) {
+            return 0x80 + i;
+        }
+    }
+    switch ( cp ) {
+        case 0xd5:  return 0xd5;                    // Õ to Ő
+        case 0xdb:  return 0xdb;                    // Û to Ű
+        case 0xf5:  return 0xf5;                    // õ to ő
+        case 0xfb:  return 0xfb;                    // û to ű
+    }
+    return CP1250_OTHER;
 }
 
-int ispunct1250(int c) {
-    for ( int i=0; i<sizeof(hungarianPunctuation)/sizeof(hungarianPunctuation[0]); i++ ) {
-        if ( c == hungarianPunctuation[i] ) {
-            return true;
-        }        
+static void initCodepage() {
+    for ( int c=0; c<256; c++ ) {
+        unsigned int cp = c < 0x80 ? c: cp1250Unicode[c-0x80];
+        char *s = cp1250Utf8[c];
+        if ( cp == 0 && c != 0 ) {
+            strcpy(s, "\xef\xbf\xbd");              // not used in CP1250 (CP1250_OTHER):  U+FFFD
+        } else if ( cp < 0x80 ) {
+            s[0] = cp;
+        } else if ( cp < 0x800 ) {
+            s[0] = 0xc0 | (cp >> 6);
+            s[1] = 0x80 | (cp & 0x3f);
+        } else {
+            s[0] = 0xe0 | (cp >> 12);
+            s[1] = 0x80 | ((cp >> 6) & 0x3f);
+            s[2] = 0x80 | (cp & 0x3f);
+        }
+    }
+    for ( int e=0; e<ENCODINGS; e++ ) {
+        for ( int c=0; c<256; c++ ) {
+            bool same = c < 0x80 || e == ENCODING_CP1250 || codepage[e].unicode == NULL;
+            codepage[e].toCp1250[c] = same ? c: unicodeToCp1250(codepage[e].unicode[c-0x80]);
+        }
     }
-    return ispunct(c);
 }
+
 /*
-    Assume that the character is Code Page 1250 = Central Europe
-    Change CP1200 character to UTF8 for able to print
+    CP1250 letter to the printable UTF-8 string.  white space (not ' ') is "_"
 */
-char *toPrintableChar1250(char c, char *unicodeStr, int maxLen) {
-    if ( c==' ' || !isspace(c) ) {
-        wchar_t wcStr[2] = { '\0', '\0' };
-        unicodeStr[0] = c;
-        unicodeStr[1] = '\0';
-        MultiByteToWideChar(1250, 0, unicodeStr, 1, wcStr, sizeof(wcStr)/sizeof(wcStr[0])); // assume CP1250 and change it to widechar
-        WideCharToMultiByte(CP_UTF8, 0, wcStr, sizeof(wcStr)/sizeof(wcStr[0]), unicodeStr, maxLen, NULL, NULL); // change widechar to utf8
-        return unicodeStr;
-    }
-    return "_";             // unprintable character
+static const char *toPrintableChar1250(int c) {
+    c = (unsigned char)c;
+    return (c == ' ' || !(cp1250Class[c] & CP1250_SPACE)) ? cp1250Utf8[c]: "_";
 }
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -237,6 +574,15 @@ FILE *fopenUtf8(char *fname, char *fmode) {
     MultiByteToWideChar(CP_UTF8, 0, fmode, -1, WCfmode, sizeof(WCfmode)/sizeof(WCfmode[0]));    // convert UTF-8 string to wchar_t
     return _wfopen(WCfname, WCfmode);
 } 
+
+/*
+    GetFileAttributes() of the file which name is UTF8
+*/
+DWORD getFileAttributesUtf8(const char *fname) {
+    wchar_t WCfname[512];
+    MultiByteToWideChar(CP_UTF8, 0, fname, -1, WCfname, sizeof(WCfname)/sizeof(WCfname[0]));    // convert UTF-8 string to wchar_t
+    return GetFileAttributesW(WCfname);
+}
 #else
 /*
     in the Linux, fopenUtf8() is same as fopen()
@@ -244,451 +590,6981 @@ FILE *fopenUtf8(char *fname, char *fmode) {
 #   define fopenUtf8(fname, fmode) fopen(fname, fmode)
 #endif
 
-// ------------------------------------ Solution for the task
 /*
-    count how many books need to process.
-    File = book.  Title = file name. the files are in the book list
+    Thread
+    thin wrapper of Windows thread and pthread, and the mutex and the condition variable for them
 */
-int step01_countBookList(char* inFName) {
-    FILE *spIn;
-    char linebuf[512];
-    char *linebufp;
-    int books = 0;
- 
-    if ( (spIn=fopen(inFName, "r")) == NULL ) {
-        fprintf(stderr, "***Error line %d:  file read open error:  %s\n", __LINE__, inFName);
-        return 0;
+typedef void *(*threadFunc)(void *arg);
+#if defined(_WIN32) || defined(_WIN64)
+typedef HANDLE threadHandle;
+struct threadStart {
+    threadFunc func;
+    void *arg;
+};
+static DWORD WINAPI threadTrampoline(LPVOID p) {
+    struct threadStart start = *(struct threadStart *)p;
+    free(p);
+    start.func(start.arg);
+    return 0;
+}
+static int threadCreate(threadHandle *pT, threadFunc func, void *arg) {
+    struct threadStart *p = malloc(sizeof(*p));
+    if ( p == NULL ) {
+        return false;
     }
-    for (int i=0; fgets(linebuf, sizeof(linebuf), spIn); i++) {
-        char *trimLine = trim(linebuf);
-        if ( *trimLine != '\0' && *trimLine!=COMMENTSYMBOL ) {
-            books++;            
-        }
+    p->func = func;
+    p->arg = arg;
+    if ( (*pT = CreateThread(NULL, 0, threadTrampoline, p, 0, NULL)) == NULL ) {
+        free(p);
+        return false;
     }
-    fclose(spIn);
-    return books;
+    return true;
+}
+static void threadJoin(threadHandle t) {
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+}
+static long atomicFetchAdd(volatile long *p, long value) {
+    return InterlockedExchangeAdd(p, value);
+}
+static int numberOfCpu() {
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors;
+}
+typedef CRITICAL_SECTION mutexHandle;
+typedef CONDITION_VARIABLE condHandle;
+static void mutexInit(mutexHandle *pM) {
+    InitializeCriticalSection(pM);
+}
+static void mutexLock(mutexHandle *pM) {
+    EnterCriticalSection(pM);
+}
+static void mutexUnlock(mutexHandle *pM) {
+    LeaveCriticalSection(pM);
+}
+static void mutexDestroy(mutexHandle *pM) {
+    DeleteCriticalSection(pM);
+}
+static void condInit(condHandle *pC) {
+    InitializeConditionVariable(pC);
+}
+static void condWait(condHandle *pC, mutexHandle *pM) {
+    SleepConditionVariableCS(pC, pM, INFINITE);
+}
+static void condBroadcast(condHandle *pC) {
+    WakeAllConditionVariable(pC);
+}
+static void condDestroy(condHandle *pC) {
 }
+#else
+typedef pthread_t threadHandle;
+static int threadCreate(threadHandle *pT, threadFunc func, void *arg) {
+    return pthread_create(pT, NULL, func, arg) == 0;
+}
+static void threadJoin(threadHandle t) {
+    pthread_join(t, NULL);
+}
+static long atomicFetchAdd(volatile long *p, long value) {
+    return __atomic_fetch_add(p, value, __ATOMIC_RELAXED);
+}
+static int numberOfCpu() {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n: 1;
+}
+typedef pthread_mutex_t mutexHandle;
+typedef pthread_cond_t condHandle;
+static void mutexInit(mutexHandle *pM) {
+    pthread_mutex_init(pM, NULL);
+}
+static void mutexLock(mutexHandle *pM) {
+    pthread_mutex_lock(pM);
+}
+static void mutexUnlock(mutexHandle *pM) {
+    pthread_mutex_unlock(pM);
+}
+static void mutexDestroy(mutexHandle *pM) {
+    pthread_mutex_destroy(pM);
+}
+static void condInit(condHandle *pC) {
+    pthread_cond_init(pC, NULL);
+}
+static void condWait(condHandle *pC, mutexHandle *pM) {
+    pthread_cond_wait(pC, pM);
+}
+static void condBroadcast(condHandle *pC) {
+    pthread_cond_broadcast(pC);
+}
+static void condDestroy(condHandle *pC) {
+    pthread_cond_destroy(pC);
+}
+#endif
 
 /*
-    Initialize Letter Frequency table for a book.
-    Input:  pointer of totalFrequency
-            pointer of the top of bookFrequency table[]
-            books:  number of books
-    Ouput:  TotalFrequeny Table
-            bookFrequeny Table
+    Book reader
+    hand the content of a book to the counting code as contiguous spans.  (no fgetc() per letter)
+    READER_MMAP:    memory mapped file.  The kernel reads ahead (madvise SEQUENTIAL)
+    READER_READ:    large aligned read() buffer.  For pipes, small files, and files bigger than the address space budget
+    Always binary.  CRLF is counted as one newline by the caller, so the count is the same on Windows and Linux.
+    A compressed book (gzip or zstd, known by the magic bytes, not by the file name) is decompressed by a pipe
+    thread.  The pipe thread fills the buffers of a bounded queue (PIPE_BUFFERS), and readerNext() hands them to
+    the counting loop.  So the decompression and the counting are at the same time, and no temporary file.
+    The formats need the library at the compile time:  -DHLFC_ZLIB (zlib), -DHLFC_ZSTD (libzstd).
 */
-void step02_initializeLf(struct totalFrequency *pGt, struct bookFrequency *pBf, int books) {
-    memset(pGt, 0, sizeof(*pGt));
-    for (int i=0; i<sizeof(pGt->lf.sortIdx)/sizeof(pGt->lf.sortIdx[0]); i++) {
-        pGt->lf.sortIdx[i] = i;             // initialize sort index
-    }
-    memset(pBf, 0, sizeof(struct bookFrequency)*books);
-    for (int i=0; i<books; i++) {
-        for (int j=0; j<sizeof(pBf->lf.sortIdx)/sizeof(pBf->lf.sortIdx[0]); j++) {
-            pBf[i].lf.sortIdx[j] = j;       // initialize sort index
-        }
-    }
-}
+#define READER_READ             0                   // read() to the aligned buffer
+#define READER_MMAP             1                   // memory mapped file
+#define READER_BUFFER_SIZE      (1024*1024)         // read() buffer size
+#define READER_BUFFER_ALIGN     4096                // read() buffer alignment (page size)
+#define READER_SPAN_SIZE        (1024*1024*1024)    // max size of a span from the memory mapped file
+#define READER_MMAP_MIN         (256*1024)          // smaller file is read by read().  mmap() costs more than read()
+#define READER_MMAP_MAX         (sizeof(void*)>=8 ? (1ull<<40): (256ull<<20))  // address space budget for mmap()
+#define FORMAT_PLAIN            0                   // not compressed
+#define FORMAT_GZIP             1                   // magic 1f 8b
+#define FORMAT_ZSTD             2                   // magic 28 b5 2f fd
+#define FORMAT_DEFLATE          3                   // zip member (no header, no magic)
+#define PIPE_BUFFERS            4                   // queue from the pipe thread to the counting loop
+#define PIPE_BUFFER_SIZE        (1024*1024)         // size of a decompressed buffer
+
+struct bookReader;
+struct readerPipe;
+struct archive;
+struct archiveMember;
+static void readerClose(struct bookReader *pR);
+static const struct archiveMember *archiveFindMember(const char *title, struct archive **ppA);
+static int readerOpenMember(struct bookReader *pR, struct archive *pA, const struct archiveMember *pM, char *fname);
+static size_t readerNextRaw(struct bookReader *pR, const unsigned char **ppSpan);
+static int readerPipeOpen(struct bookReader *pR, int format, char *fname);
+static void readerPipeClose(struct readerPipe *pP);
+static void statsReader(const struct bookReader *pR);
+
+struct bookReader {
+    int mode;                                       // READER_MMAP or READER_READ
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE hFile;
+    HANDLE hMap;
+#else
+    int fd;
+#endif
+    unsigned char *map;                             // READER_MMAP: top of the mapped file
+    unsigned long long size;                        // READER_MMAP: file size
+    unsigned long long pos;                         // READER_MMAP: next position to hand
+    unsigned char *buf;                             // READER_READ: aligned buffer
+    void *bufAlloc;                                 // READER_READ: allocated memory for buf
+    size_t pendingLen;                              // READER_READ: buf has the first span, read by readerOpen()
+    bool borrowed;                                  // archive member:  map is in the mapped archive, not unmapped
+    struct readerPipe *pPipe;                       // compressed book:  the decompressed spans are from the pipe thread
+    unsigned long long reads;                       // --stats:  read() calls
+    unsigned long long readBytes;                   // --stats:  bytes by read()
+    unsigned long long mappedBytes;                 // --stats:  spans of the mapped file
+};
+
+struct readerPipe {
+    int format;                                     // FORMAT_GZIP or FORMAT_ZSTD
+    struct bookReader *pIn;                         // the compressed file, read by the pipe thread
+    threadHandle thread;
+    mutexHandle mutex;
+    condHandle cond;
+    unsigned char *buf[PIPE_BUFFERS];
+    size_t len[PIPE_BUFFERS];
+    int head;                                       // next buffer to the counting loop
+    int filled;                                     // number of the buffers from head, filled by the pipe thread
+    bool held;                                      // the counting loop has buf[head]
+    bool done;                                      // the pipe thread is finished
+    bool stop;                                      // readerClose():  the pipe thread has to be finished
+    unsigned long long skip;                        // readerSeek():  decompressed bytes to skip
+    const unsigned char *in;                        // pipe thread:  compressed bytes not used yet
+    size_t inLen;
+    bool streamEnd;                                 // pipe thread:  the last gzip member or zstd frame is finished
+    bool started;                                   // the pipe thread is started
+#if defined(HLFC_ZLIB)
+    z_stream z;
+#endif
+#if defined(HLFC_ZSTD)
+    ZSTD_DStream *pZstd;
+#endif
+};
 
 /*
-    read the book title from the book list.
-    Input:  inFName:    file name of the book list
-            pBF:        pointer for the struct bookFrequency
-            books:      number of the books in the book list, this number is already got from function step01_countBookList();
+    allocate the aligned read buffer
 */
-int step03_readBookList(char* inFName, struct bookFrequency *pBf, int books) {
-    FILE *spIn;
-    char linebuf[512];
-    char *linebufp;
-
-    if ( inFName ) {
-        grandTotal.books = 0;
-        if ( (spIn=fopen(inFName, "r")) == NULL ) {
-            fprintf(stderr, "***Error line %d:  file read open error:  %s\n", __LINE__, inFName);
-            return 0;
-        }
-        for (int i=0; fgets(linebuf, sizeof(linebuf), spIn); i++) {
-            char *trimLine = trim(linebuf);
-            if ( *trimLine != '\0' && *trimLine!=COMMENTSYMBOL ) {
-                int len=strlen(trimLine);
-                pBf[grandTotal.books].bookTitle = malloc(sizeof(char)*(strlen(trimLine)+1) );
-                strncpy(pBf[grandTotal.books].bookTitle, trimLine, sizeof(char)*(strlen(trimLine)+1));
-                grandTotal.books++;
-            }
-        }
-        fclose(spIn);
-        return (grandTotal.books==books? books: 0);
-    } else { // terminate procedure
-        for ( int i=0; i<books; i++ ) {
-            free(pBf[i].bookTitle);
-        }
+static int readerAllocBuffer(struct bookReader *pR) {
+    if ( (pR->bufAlloc = malloc(READER_BUFFER_SIZE + READER_BUFFER_ALIGN)) == NULL ) {
+        return false;
     }
+    pR->buf = (unsigned char *)(((size_t)pR->bufAlloc + READER_BUFFER_ALIGN - 1) & ~(size_t)(READER_BUFFER_ALIGN - 1));
+    return true;
 }
 
 /*
-    memory free for 03_readBookList
+    the format of the book from the magic bytes.  READER_READ:  the first span is kept for readerNext()
+    compressed:  the pipe thread is started
 */
-int terminate03_readBookList(char* inFName, struct bookFrequency *pBf, int books) {
-    return step03_readBookList(NULL, pBf, books);
+static int readerOpenFormat(struct bookReader *pR, char *fname) {
+    const unsigned char *p = pR->map;
+    size_t len = (size_t)MIN(pR->size, 4);
+    int format = FORMAT_PLAIN;
+    if ( pR->mode == READER_READ ) {
+        len = pR->pendingLen = readerNextRaw(pR, &p);
+    }
+    if ( len >= 2 && p[0] == 0x1f && p[1] == 0x8b ) {
+        format = FORMAT_GZIP;
+    } else if ( len >= 4 && memcmp(p, "\x28\xb5\x2f\xfd", 4) == 0 ) {
+        format = FORMAT_ZSTD;
+    }
+    if ( format != FORMAT_PLAIN && !readerPipeOpen(pR, format, fname) ) {
+        readerClose(pR);
+        return false;
+    }
+    return true;
 }
 
-#define BARCHART_LEN_PERCENT_NULL   7       // value of strlen("00.0% ") + 1 (for null terminate)   default: 7
-#define BARCHART_BARLEN             13      // length of bar char (max bar length)                  default: 13
-#define BARCAHRT_SATURATION         12.0    // percentage of saturation (double)                    default: 12.0
-#define BARCHART_HOW_MANY_IN_LINE   3       // 3 bar char in one line                               need to be: 3
 /*
-    barChar function
-    sortLF: soft index only for the Letter Frequency Table.    
+    open the file for the reader, mmap() if the size is mmapMin or larger
+    return: true if success
 */
-void sortLf(struct letterFrequency *pLf) {
-    for (int i=0; i<sizeof(pLf->c)/sizeof(pLf->c[0])-1; i++) {
-        for (int j=i+1; j<sizeof(pLf->c)/sizeof(pLf->c[0]); j++) {
-            if ( pLf->c[ pLf->sortIdx[i] ] < pLf->c[ pLf->sortIdx[j] ] ) {
-                int tmp = pLf->sortIdx[i];
-                pLf->sortIdx[i] = pLf->sortIdx[j];
-                pLf->sortIdx[j] = tmp;
+static int readerOpenFile(struct bookReader *pR, char *fname, unsigned long long mmapMin) {
+    memset(pR, 0, sizeof(*pR));
+    pR->mode = READER_READ;
+#if defined(_WIN32) || defined(_WIN64)
+    wchar_t WCfname[512];
+    LARGE_INTEGER size;
+    MultiByteToWideChar(CP_UTF8, 0, fname, -1, WCfname, sizeof(WCfname)/sizeof(WCfname[0]));    // convert UTF-8 string to wchar_t
+    pR->hFile = CreateFileW(WCfname, GENERIC_READ, FILE_SHARE_READ|FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if ( pR->hFile == INVALID_HANDLE_VALUE ) {
+        return false;
+    }
+    if ( GetFileType(pR->hFile) == FILE_TYPE_DISK && GetFileSizeEx(pR->hFile, &size)
+      && mmapMin <= (unsigned long long)size.QuadPart && (unsigned long long)size.QuadPart <= READER_MMAP_MAX ) {
+        if ( (pR->hMap = CreateFileMappingW(pR->hFile, NULL, PAGE_READONLY, 0, 0, NULL)) != NULL ) {
+            if ( (pR->map = MapViewOfFile(pR->hMap, FILE_MAP_READ, 0, 0, 0)) != NULL ) {
+                pR->mode = READER_MMAP;
+                pR->size = size.QuadPart;
+                return true;
             }
+            CloseHandle(pR->hMap);
+            pR->hMap = NULL;
+        }
+    }
+#else
+    struct stat st;
+    if ( (pR->fd = open(fname, O_RDONLY)) < 0 ) {
+        return false;
+    }
+    if ( fstat(pR->fd, &st) == 0 && S_ISREG(st.st_mode)
+      && mmapMin <= (unsigned long long)st.st_size && (unsigned long long)st.st_size <= READER_MMAP_MAX ) {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, pR->fd, 0);
+        if ( map != MAP_FAILED ) {
+#   if defined(MADV_SEQUENTIAL)
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+#   endif
+            pR->mode = READER_MMAP;
+            pR->map = map;
+            pR->size = st.st_size;
+            return true;
         }
     }
+#endif
+    if ( !readerAllocBuffer(pR) ) {
+        readerClose(pR);
+        return false;
+    }
+    return true;
 }
 
 /*
-    barChart function
-    static character table for the chartBar 
-*/
-static char *barChart_xStr = "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx"
-                             "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx";
-static char *barChart_xSpc = "                                                                           "
-                             "                                                                           ";
-static char *barChart_head = "---------------------------------------------------------------------------"
-                             "---------------------------------------------------------------------------";
-static char *barChart_foot = "---------------------------------------------------------------------------"
-                             "---------------------------------------------------------------------------";                             
-/*
-    barChart function
-    create a table header for one table
+    open the book for the reader
+    fname:  file name in UTF-8.  "archive!member" is a member of the tar or zip archive
+    return: true if success
 */
-char *barChartHeader(char *pStr, int maxLen, double saturat) {
-    snprintf(pStr, maxLen+BARCHART_LEN_PERCENT_NULL, "%.*s%.*s",7, barChart_head, maxLen, barChart_head); 
-    return pStr;
+static int readerOpen(struct bookReader *pR, char *fname) {
+    struct archive *pA;
+    const struct archiveMember *pM = archiveFindMember(fname, &pA);
+    if ( pM ) {
+        return readerOpenMember(pR, pA, pM, fname);
+    }
+    return readerOpenFile(pR, fname, READER_MMAP_MIN) && readerOpenFormat(pR, fname);
 }
 
 /*
-    barChart function
-    create a table footer for one table
+    get the next span of the file (compressed or not)
 */
-char *barChartFooter(char *pStr, int maxLen, double saturat) {
-    snprintf(pStr, maxLen+BARCHART_LEN_PERCENT_NULL, "%.*s%.*s",7, barChart_head, maxLen, barChart_head); 
-    return pStr;
+static size_t readerNextRaw(struct bookReader *pR, const unsigned char **ppSpan) {
+    if ( pR->pendingLen ) {
+        size_t len = pR->pendingLen;
+        pR->pendingLen = 0;
+        *ppSpan = pR->buf;
+        return len;
+    }
+    if ( pR->mode == READER_MMAP ) {
+        size_t len = (size_t)MIN(pR->size - pR->pos, (unsigned long long)READER_SPAN_SIZE);
+        *ppSpan = pR->map + pR->pos;
+        pR->pos += len;
+        pR->mappedBytes += len;
+        return len;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    DWORD len;
+    if ( !ReadFile(pR->hFile, pR->buf, READER_BUFFER_SIZE, &len, NULL) ) {
+        return 0;                                   // read error or end of the pipe
+    }
+#else
+    ssize_t len;
+    while ( (len = read(pR->fd, pR->buf, READER_BUFFER_SIZE)) < 0 && errno == EINTR ) {
+        // retry
+    }
+    if ( len < 0 ) {
+        fprintf(stderr, "***Error line %d:  file read error:  %s\n", __LINE__, strerror(errno));
+        return 0;
+    }
+#endif
+    *ppSpan = pR->buf;
+    pR->reads++;
+    pR->readBytes += len;
+    return (size_t)len;
 }
 
 /*
-    barChart function
-    create a table content for one table
+    decompress the book to out[size]
+    return: length of out.  0 = end of the book (or error)
 */
-char* barChart(char *pStr, int maxLen, double saturat, double value) {
-    int numOfSmallx;    // number of Large X
-    double lastx_value;    // value of last X
-    char *lastStr;
-    numOfSmallx = (int)(value / saturat * maxLen);
-    lastx_value = value - (double)numOfSmallx / maxLen * saturat;
-    if ( saturat+(double)saturat/maxLen/3 < value ) {
-        numOfSmallx = maxLen - 1;
-        lastStr = "*";
-    } else {
-        if ( lastx_value <= (double)saturat/maxLen/3. ) {
-            lastStr = "";
-        } else if ( (double)saturat/maxLen/3. < lastx_value && lastx_value < (double)saturat/maxLen*2./3. ) {
-            lastStr = ".";
-        } else {
-            lastStr = ":";
+static size_t pipeDecompress(struct readerPipe *pP, unsigned char *out, size_t size) {
+    size_t outLen = 0;
+#if !defined(HLFC_ZLIB) && !defined(HLFC_ZSTD)
+    (void)out;                                      // no decompressor is compiled in
+#endif
+    while ( outLen < size ) {
+        if ( pP->inLen == 0 && (pP->inLen = readerNextRaw(pP->pIn, &pP->in)) == 0 ) {
+            if ( !pP->streamEnd ) {
+                fprintf(stderr, "***Error line %d:  compressed book is cut\n", __LINE__);
+                pP->streamEnd = true;               // no more message
+            }
+            break;
         }
+#if defined(HLFC_ZLIB)
+        if ( pP->format == FORMAT_GZIP || pP->format == FORMAT_DEFLATE ) {
+            uInt inLen = (uInt)MIN(pP->inLen, UINT_MAX);
+            int ret;
+            if ( pP->streamEnd ) {
+                inflateReset(&pP->z);               // the next gzip member
+                pP->streamEnd = false;
+            }
+            pP->z.next_in = (Bytef *)pP->in;
+            pP->z.avail_in = inLen;
+            pP->z.next_out = out + outLen;
+            pP->z.avail_out = (uInt)(size - outLen);
+            ret = inflate(&pP->z, Z_NO_FLUSH);
+            pP->in += inLen - pP->z.avail_in;
+            pP->inLen -= inLen - pP->z.avail_in;
+            outLen = size - pP->z.avail_out;
+            if ( ret == Z_STREAM_END ) {
+                pP->streamEnd = true;
+            } else if ( ret != Z_OK && ret != Z_BUF_ERROR ) {
+                fprintf(stderr, "***Error line %d:  deflate data error:  %s\n", __LINE__, pP->z.msg ? pP->z.msg: "");
+                pP->streamEnd = true;               // no more message
+                pP->inLen = 0;
+                pP->pIn->pendingLen = 0;
+                return outLen;
+            }
+        }
+#endif
+#if defined(HLFC_ZSTD)
+        if ( pP->format == FORMAT_ZSTD ) {
+            ZSTD_inBuffer inBuf = { pP->in, pP->inLen, 0 };
+            ZSTD_outBuffer outBuf = { out, size, outLen };
+            size_t ret = ZSTD_decompressStream(pP->pZstd, &outBuf, &inBuf);
+            if ( ZSTD_isError(ret) ) {
+                fprintf(stderr, "***Error line %d:  zstd data error:  %s\n", __LINE__, ZSTD_getErrorName(ret));
+                pP->streamEnd = true;
+                pP->inLen = 0;
+                return outLen;
+            }
+            pP->in += inBuf.pos;
+            pP->inLen -= inBuf.pos;
+            outLen = outBuf.pos;
+            pP->streamEnd = (ret == 0);             // a frame is finished
+        }
+#endif
     }
-    if ( value==0) {
-        snprintf(pStr, maxLen+BARCHART_LEN_PERCENT_NULL, "       %.*s%s%.*s", numOfSmallx, barChart_xStr, lastStr, maxLen-numOfSmallx-strlen(lastStr), barChart_xSpc);
-    } else {
-        snprintf(pStr, maxLen+BARCHART_LEN_PERCENT_NULL, "%4.1lf%% %.*s%s%.*s", value, numOfSmallx, barChart_xStr, lastStr, maxLen-numOfSmallx-strlen(lastStr), barChart_xSpc);
-    }
-    return pStr;
+    return outLen;
 }
 
 /*
-    calculate the letter frequeny for a book
+    pipe thread:  decompress the book to the free buffers of the queue
 */
-int step10_calcBookFrequency(struct bookFrequency *pBf) {
-    FILE *spIn;
-    int c;
-    unsigned long lc=0;      // line count
-    unsigned long cc=0;      // character count including newline
-
-    if ( (spIn=fopenUtf8(pBf->bookTitle, "r")) == NULL ) {                      //  (not the content.  only the fine name)
-        fprintf(stderr, "***Error line %d:  file read open error:  %s\n", __LINE__, pBf->bookTitle);
-        return 0;
-    }
-    for ( ; (c=fgetc(spIn)) != EOF; cc++) {
-        char unicodeStr[8];
-        // count ecah letter
-        pBf->lf.c[(unsigned char)toupper1250((unsigned char)c)]++;
-        grandTotal.lf.c[(unsigned char)toupper1250((unsigned char)c)]++;
-        // count punctuation letters
-        pBf->lf.punctuation += ispunct1250((unsigned char) c)? 1: 0;
-        grandTotal.lf.punctuation += (ispunct1250((unsigned char) c)? 1: 0);
-        // count [0-9] digit numbers
-        pBf->lf.digit += (isdigit((unsigned char)c)? 1: 0);
-        grandTotal.lf.digit += (isdigit((unsigned char)c)? 1: 0);
-        // count Hungarian special letters
-        if ( isHungarian(c) ) {
-            (pBf->lf.totalHungarian)++;
-            grandTotal.lf.totalHungarian++;
-        }
-        // count alphabet letters
-        if ( isalpha(c) ) {
-            (pBf->lf.totalAlphabets)++;
-            grandTotal.lf.totalAlphabets++;
-        }
-        // count all letters
-        if ( !isspace(c) ) {
-            (pBf->lf.totalLetters)++;
-            grandTotal.lf.totalLetters++;
-        }
-        // test
-        // fprintf(spOutputFile, "%s", toPrintableChar1250(c, unicodeStr, sizeof(unicodeStr)/sizeof(unicodeStr[0])) );
-        // count lines (not used)
-        if ( c=='\n' ) {
-            lc++;
+static void *readerPipeMain(void *arg) {
+    struct readerPipe *pP = arg;
+    for (;;) {
+        int slot;
+        bool stop;
+        size_t len;
+        mutexLock(&pP->mutex);
+        while ( pP->filled == PIPE_BUFFERS && !pP->stop ) {
+            condWait(&pP->cond, &pP->mutex);        // the queue is full
         }
-    }
-    fclose(spIn);
-    return cc;
-}
-
-double getLetterSpeed(char c, int method) {
-    for ( int i=0; i<sizeof(typingMethod[method].regularPosition.letter)/sizeof(typingMethod[method].regularPosition.letter[0]); i++) {
-        if ( toupper(c)==toupper1250(typingMethod[method].regularPosition.letter[i]) ) {
-            return typingMethod[method].regularPosition.typeSpeed;
+        slot = (pP->head + pP->filled) % PIPE_BUFFERS;
+        stop = pP->stop;
+        mutexUnlock(&pP->mutex);
+        if ( stop || (len = pipeDecompress(pP, pP->buf[slot], PIPE_BUFFER_SIZE)) == 0 ) {
+            break;
         }
+        mutexLock(&pP->mutex);
+        pP->len[slot] = len;
+        pP->filled++;
+        condBroadcast(&pP->cond);
+        mutexUnlock(&pP->mutex);
     }
-    return typingMethod[method].unregularPosition.typeSpeed;
-};
-
-int speedToWpm(double speedPerLetter) {
-    return (int)(60. / (speedPerLetter * 5.) +0.5);
+    mutexLock(&pP->mutex);
+    pP->done = true;
+    condBroadcast(&pP->cond);
+    mutexUnlock(&pP->mutex);
+    return NULL;
 }
 
-void step20_calcTypingSpeed(char *bookName, struct letterFrequency *pLf) {
-    fprintf(spOutputFile, "[Typing Speed]\n");
-    for ( int method=0; method<sizeof(typingMethod)/sizeof(typingMethod[0]); method++ ) {
-        double typingSecondForBook = 0.;
-        for ( int i=0; i<sizeof(pLf->c)/sizeof(pLf->c[0]); i++) {
-            typingSecondForBook += getLetterSpeed(i, method) * pLf->c[i];
-        }
-        pLf->typingMethod[method].typingSecondForBook = typingSecondForBook;
-        fprintf(spOutputFile, "  %-10s: %7.1lf hours - %s (using %d to %dwpm)\n",
-            typingMethod[method].shortName10, typingSecondForBook/(60*60), 
-            typingMethod[method].name, 
-            speedToWpm(typingMethod[method].unregularPosition.typeSpeed),
-            speedToWpm(typingMethod[method].regularPosition.typeSpeed) );
+/*
+    start the pipe thread for the compressed book
+    return: false if the format is not compiled in, or no memory
+*/
+static int readerPipeOpen(struct bookReader *pR, int format, char *fname) {
+    struct readerPipe *pP = calloc(1, sizeof(struct readerPipe));
+    bool ready = false;
+    if ( pP == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        return false;
     }
-}
-
-void step21_calcBusinessHours(char *bookName, struct letterFrequency *pLf) {
-    fprintf(spOutputFile, "If %.lf%% of business hours need to type whole in a year,\n",
-        (double)BUSINESS_TYPINGHOURS / BUSINESS_WORKINGHOURS * 100. ) ;
-    // initialize sort index
-    for ( int i=0; i<sizeof(pLf->typingMethod)/sizeof(pLf->typingMethod[0]); i++) {
-        pLf->typingMethod[i].sortIdx = i;
+    pP->format = format;
+    pP->pIn = pR;
+    mutexInit(&pP->mutex);
+    condInit(&pP->cond);
+    pR->pPipe = pP;                                 // readerPipeClose() by readerClose() if an error
+#if defined(HLFC_ZLIB)
+    if ( format == FORMAT_GZIP || format == FORMAT_DEFLATE ) {
+        ready = inflateInit2(&pP->z, format == FORMAT_GZIP ? 15+16: -15) == Z_OK;  // gzip header, or raw deflate
     }
-    // index sort
-    for ( int i=0; i<sizeof(pLf->typingMethod)/sizeof(pLf->typingMethod[0])-1; i++ ) {
-        for ( int j=i+1; j<sizeof(pLf->typingMethod)/sizeof(pLf->typingMethod[0]); j++ ) {
-            if ( pLf->typingMethod[i].typingSecondForBook < pLf->typingMethod[j].typingSecondForBook ) {
-                int tmp = pLf->typingMethod[i].sortIdx;
-                pLf->typingMethod[i].sortIdx = pLf->typingMethod[j].sortIdx;
-                pLf->typingMethod[j].sortIdx = tmp;
-            }
-        }
+#endif
+#if defined(HLFC_ZSTD)
+    if ( format == FORMAT_ZSTD ) {
+        ready = (pP->pZstd = ZSTD_createDStream()) != NULL && !ZSTD_isError(ZSTD_initDStream(pP->pZstd));
     }
-    // get slower order
-    int slowerIdx[sizeof(pLf->typingMethod)/sizeof(pLf->typingMethod[0])];
-    for ( int i=0; i<sizeof(pLf->typingMethod)/sizeof(pLf->typingMethod[0]); i++ ) {
-        slowerIdx[pLf->typingMethod[i].sortIdx] = i;
+#endif
+    if ( !ready ) {
+        fprintf(stderr, "***Error line %d:  %s book is not supported (compile with %s):  %s\n", __LINE__,
+            format == FORMAT_ZSTD ? "zstd": format == FORMAT_GZIP ? "gzip": "deflate", format == FORMAT_ZSTD ? "-DHLFC_ZSTD -lzstd": "-DHLFC_ZLIB -lz", fname);
+        return false;
     }
-    // print
-    double lettersPerYear0 = (double)(BUSINESS_DAYS_IN_YEAR * BUSINESS_TYPINGHOURS) * 60 * 60 
-                           / (pLf->typingMethod[slowerIdx[0]].typingSecondForBook / pLf->totalLetters);
-    double reduceSeconds[sizeof(pLf->typingMethod)/sizeof(pLf->typingMethod[slowerIdx[0]])];
-    fprintf(spOutputFile, "  %s is the slowest, able to type %llu words in a year.\n",
-        typingMethod[slowerIdx[0]].shortName10,
-        lettersPerYear0 / LETTERS_PER_WORD );
-    for (int i=1; i<sizeof(pLf->typingMethod)/sizeof(pLf->typingMethod[0]); i++ ) {
-        double needSeconds = lettersPerYear0 * (pLf->typingMethod[slowerIdx[i]].typingSecondForBook) / (double)pLf->totalLetters;
-        reduceSeconds[slowerIdx[i]] = (double)(BUSINESS_DAYS_IN_YEAR * BUSINESS_TYPINGHOURS * 60 * 60) - needSeconds;
-        fprintf(spOutputFile, "  %s reduces %5.1lf hours (%5.1lf business days %dh typing) than %s\n",
-            typingMethod[slowerIdx[i]].shortName10,
-            reduceSeconds[slowerIdx[i]]/(60*60),
-            reduceSeconds[slowerIdx[i]]/(60*60)/BUSINESS_TYPINGHOURS,
-            BUSINESS_TYPINGHOURS,
-            typingMethod[slowerIdx[0]].shortName10
-        );
+    for ( int i=0; i<PIPE_BUFFERS; i++ ) {
+        if ( (pP->buf[i] = malloc(PIPE_BUFFER_SIZE)) == NULL ) {
+            fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+            return false;
+        }
     }
-    fprintf(spOutputFile, "  %s reduces %5.1lf hours (%5.1lf business days %dh typing) than %s\n",
-        typingMethod[slowerIdx[2]].shortName10,
-        (reduceSeconds[slowerIdx[2]]-reduceSeconds[pLf->typingMethod[1].sortIdx])/(60*60),
-        (reduceSeconds[slowerIdx[2]]-reduceSeconds[pLf->typingMethod[1].sortIdx])/(60*60)/BUSINESS_TYPINGHOURS,
-        BUSINESS_TYPINGHOURS,
-        typingMethod[slowerIdx[1]].shortName10
-    );
+    if ( !threadCreate(&pP->thread, readerPipeMain, pP) ) {
+        fprintf(stderr, "***Error line %d:  thread create error\n", __LINE__);
+        return false;
+    }
+    pP->started = true;
+    return true;
 }
 
 /*
-    print the letter frequency for a book
+    hand the next decompressed buffer.  the previous buffer is given back to the pipe thread.
 */
-int step11_printBookFrequency(char *bookName, struct letterFrequency *pLf) {
-    int idx;
-    int printCount;
-    int lineCount;
-    unsigned char dispMatrix[(256+BARCHART_HOW_MANY_IN_LINE-1)/BARCHART_HOW_MANY_IN_LINE][BARCHART_HOW_MANY_IN_LINE] = { 0 }; // display matrix
-    fprintf(spOutputFile, "\n---------%s\n", bookName);
-    sortLf(pLf);
-    // step 1. get printCount and lineCount
-    printCount = 0;
-    for ( idx=0; idx<sizeof(pLf->c)/sizeof(pLf->c[0]); idx++) {
-        int c = pLf->sortIdx[idx];                      // get a letter which has the biggest percentage
-        if ( pLf->c[c] ) {                              // check the value of it percentage
-            if ( !ispunct1250(c) ) {                    // if the character is not punctuation (=alpha numeric)
-                if ( !isspace(c) ) {                    // if the character is not white space
-                    if ( !isdigit(c) ) {                // if the characger is not digit numbers
-                        printCount++;
-                    }
-                }
-            }
+static size_t readerPipeNext(struct readerPipe *pP, const unsigned char **ppSpan) {
+    for (;;) {
+        size_t len;
+        mutexLock(&pP->mutex);
+        if ( pP->held ) {
+            pP->head = (pP->head + 1) % PIPE_BUFFERS;
+            pP->filled--;
+            pP->held = false;
+            condBroadcast(&pP->cond);
         }
-    }
-    lineCount = (printCount + BARCHART_HOW_MANY_IN_LINE - 1)  / BARCHART_HOW_MANY_IN_LINE; 
-
-    // step2. set char to the position of the matrix
-    printCount = 0;
-    for ( idx=0; idx<sizeof(pLf->c)/sizeof(pLf->c[0]); idx++) {
-        int c = pLf->sortIdx[idx];                      // get a letter which has the biggest percentage
-        if ( pLf->c[c] ) {                              // check the value of it percentage
-            if ( !ispunct1250(c) ) {                    // if the character is not punctuation (=alpha numeric)
-                if ( !isspace(c) ) {                    // if the character is not white space
-                    if ( !isdigit(c) ) {                // if the character is not digit numbers
-                        int row = printCount % lineCount;
-                        int col = printCount / lineCount;
-                        dispMatrix[row][col] = c;   // set a letter
-                        printCount++;
-                    }
-                }
-            }
+        while ( pP->filled == 0 && !pP->done ) {
+            condWait(&pP->cond, &pP->mutex);        // the queue is empty
         }
-    }
-
-    // step 3. print the bar chart
-    for (int section=0; section<3; section++) {             // section: 1=header, 2=bar chart, 3=footer
-        for ( int row=0; row<lineCount; row++ ) {
-            if ( (section==0 && row==0) || (section==1) || (section==2 && row==0)) {
-                fprintf(spOutputFile, " ");
-            }
-            for ( int col=0; col<BARCHART_HOW_MANY_IN_LINE; col++ ) {
-                int c = dispMatrix[row][col];
-                char unicodeStr[8];
-                char barString[3][BARCHART_BARLEN+BARCHART_LEN_PERCENT_NULL];
-                if ( section==0 ) {
-                    if ( row==0 ) {                         // print the header
-                        if ( col!=0 ) {                     // before the 2nd, 3rd bar chart in a line
-                            fprintf(spOutputFile, "   ");               
-                        }
-                        fprintf(spOutputFile, "/--%s\\",
-                            barChartHeader(&(barString[col][0]), BARCHART_BARLEN, (double)BARCAHRT_SATURATION));
-                    }
-                } else if ( section==1 ) {                  // print the bar chart content
-                    if ( col!=0 ) {                         // before the 2nd, 3rd bar chart in a line
-                        fprintf(spOutputFile, "   ");               
-                    }
-                    fprintf(spOutputFile, "|%s|%s|",
-                        toPrintableChar1250(c?c:' ', unicodeStr, sizeof(unicodeStr)/sizeof(unicodeStr[0])),
-                        barChart(&(barString[col][0]), BARCHART_BARLEN, (double)BARCAHRT_SATURATION, 100.*(pLf->c[c]) / pLf->totalAlphabets)
-                        );
-                    if ( c!='\0' && !isalpha1250(c) ) fprintf(stderr, "Line %7d: Found %s(%02x) -- need to implement this.\n", __LINE__, unicodeStr, c );
-                } else if ( section==2 ) {
-                    if ( row==0 ) {                         // print the footer
-                        if ( col!=0 ) {                     // before the 2nd, 3rd bar chart in a line
-                            fprintf(spOutputFile, "   ");               
-                        }
-                        fprintf(spOutputFile, "\\--------+-+-+-+-+-+-*/");
-                    } else if ( row==1 ) {                         // print the footer
-                        fprintf(spOutputFile, "          0 2 4 6 8 10    ");
-                    } else if ( row==2 ) {                         // print the footer
-                        fprintf(spOutputFile, "          %% %% %% %% %% %% 12%%+");
-                    }                         
-                } 
-            }
-            if ( (section==0 && row==0) || (section==1) || (section==2 && row < 3)) {
-                fprintf(spOutputFile, "\n");
-            }
+        if ( pP->filled == 0 ) {
+            mutexUnlock(&pP->mutex);
+            return 0;
+        }
+        pP->held = true;
+        len = pP->len[pP->head];
+        *ppSpan = pP->buf[pP->head];
+        mutexUnlock(&pP->mutex);
+        if ( pP->skip >= len ) {                    // readerSeek()
+            pP->skip -= len;
+            continue;
         }
+        *ppSpan += pP->skip;
+        len -= (size_t)pP->skip;
+        pP->skip = 0;
+        return len;
     }
-    fprintf(spOutputFile, "Total letters                          : %8llu\n", pLf->totalLetters);
-    fprintf(spOutputFile, " - Punctuations    in Total letters    : %8lu (%4.1lf%%)\n", pLf->punctuation, 100.*pLf->punctuation/pLf->totalLetters);
-    fprintf(spOutputFile, " - [0-9] numbers   in Total letters    : %8lu (%4.1lf%%)\n", pLf->digit, 100.*pLf->digit/pLf->totalLetters);
-    fprintf(spOutputFile, " - Total Alphabets in Total letters    : %8llu (%4.1lf%%)\n", pLf->totalAlphabets, 100.*pLf->totalAlphabets/pLf->totalLetters);
-    fprintf(spOutputFile, "    -  Hungarian áéíóőöúűü in Alphabets: %8llu (%4.1lf%%)\n", pLf->totalHungarian, 100.*pLf->totalHungarian/pLf->totalAlphabets);
-    step20_calcTypingSpeed(bookName, pLf);
-    step21_calcBusinessHours(bookName, pLf);
 }
 
-void step30_printConfiguration() {
-    fprintf(spOutputFile, "-----------------------------------------------------------------------------------\n" );
-    fprintf(spOutputFile, "[Configuration]\n" );
-    fprintf(spOutputFile, "  Typing Speed (same as familiar keyboard       : % 6.1lf [wpm] (%lf sec/letter)\n", 60./TYPINGSPEED_REGULARPOS/LETTERS_PER_WORD, TYPINGSPEED_REGULARPOS);
-    fprintf(spOutputFile, "  Typing Speed (different from familiar keyboard: % 6.1lf [wpm] (%lf sec/letter)\n", 60./TYPINGSPEED_UNREGULARPOS/LETTERS_PER_WORD, TYPINGSPEED_UNREGULARPOS);
-    fprintf(spOutputFile, "  Typing Speed (using mouse back to the keyboard: % 6.1lf [wpm] (%lf sec/letter)\n", 60./TYPINGSPEED_MOUSE/LETTERS_PER_WORD, TYPINGSPEED_MOUSE);
-    fprintf(spOutputFile, "  Hungarian business days in a year, 2022       : % 4d   [days]\n", BUSINESS_DAYS_IN_YEAR );
-    fprintf(spOutputFile, "  Business typing hours in a day                : % 4d   [hours]\n", BUSINESS_TYPINGHOURS );
-    fprintf(spOutputFile, "  wpm:  word per minute (common sense)          : % 4d   [letters]\n", LETTERS_PER_WORD );
+static void readerPipeClose(struct readerPipe *pP) {
+    if ( pP->started ) {
+        mutexLock(&pP->mutex);
+        pP->stop = true;
+        condBroadcast(&pP->cond);
+        mutexUnlock(&pP->mutex);
+        threadJoin(pP->thread);
+    }
+#if defined(HLFC_ZLIB)
+    if ( pP->format == FORMAT_GZIP || pP->format == FORMAT_DEFLATE ) {
+        inflateEnd(&pP->z);
+    }
+#endif
+#if defined(HLFC_ZSTD)
+    ZSTD_freeDStream(pP->pZstd);
+#endif
+    for ( int i=0; i<PIPE_BUFFERS; i++ ) {
+        free(pP->buf[i]);
+    }
+    mutexDestroy(&pP->mutex);
+    condDestroy(&pP->cond);
+    free(pP);
 }
 
 /*
-    main() entry.
-    usage:  no parameter.   Just run the program.
-    Input:  BOOKLIST (PROGNAME "BookList.txt")
-    Ouput:  OUTPUTFILE (PROGNAME "Result.txt")
-    Error:  stderr
+    get the next span of the book
+    ppSpan: [out] top of the span.  valid until the next readerNext() or readerClose()
+    return: length of the span.  0 = end of the book (or read error)
 */
-int main(int argc, char* argv[]) {
-    struct bookFrequency *pBookFrequency;
-    setlocale(LC_CTYPE, LC_CTYPE_HUNGARY);              // enable hungarian letters áéíóőöúűü
-    if ( (spOutputFile=fopen(OUTPUTFILE, "w")) == NULL ) {
-        fprintf(stderr, "***Error line %d: file open error: %s\n", __LINE__, OUTPUTFILE);
-        return 2;
+static size_t readerNext(struct bookReader *pR, const unsigned char **ppSpan) {
+    if ( pR->pPipe ) {
+        return readerPipeNext(pR->pPipe, ppSpan);
     }
-    fprintf(spOutputFile, "%s", BOM_UTF8);              // write BOM header to the UTF-8 file.
+    return readerNextRaw(pR, ppSpan);
+}
+
 /*
-    fprintf(spOutputFile, "isalpha(0xe1)=%d\n", isalpha(0xe9));
+    skip to the position of the book (--follow reads only the appended bytes)
+    return: false if it is not able to seek (e.g. pipe)
+*/
+static int readerSeek(struct bookReader *pR, unsigned long long offset) {
+    if ( pR->pPipe ) {
+        pR->pPipe->skip = offset;                   // the decompressed bytes are not able to seek
+        return true;
+    }
+    pR->pendingLen = 0;
+    if ( pR->mode == READER_MMAP ) {
+        pR->pos = MIN(offset, pR->size);
+        return true;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    LARGE_INTEGER li;
+    li.QuadPart = offset;
+    return SetFilePointerEx(pR->hFile, li, NULL, FILE_BEGIN);
+#else
+    return lseek(pR->fd, (off_t)offset, SEEK_SET) != (off_t)-1;
+#endif
+}
+
+/*
+    close the book
+*/
+static void readerClose(struct bookReader *pR) {
+    if ( pR->pPipe ) {
+        readerPipeClose(pR->pPipe);
+        pR->pPipe = NULL;
+    }
+    if ( option.stats ) {
+        statsReader(pR);                            // after the pipe thread
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    if ( pR->map && !pR->borrowed ) {
+        UnmapViewOfFile(pR->map);
+    }
+    if ( pR->hMap ) {
+        CloseHandle(pR->hMap);
+    }
+    if ( pR->hFile && pR->hFile != INVALID_HANDLE_VALUE ) {
+        CloseHandle(pR->hFile);
+    }
+#else
+    if ( pR->map && !pR->borrowed ) {
+        munmap(pR->map, pR->size);
+    }
+    if ( pR->fd > 0 ) {
+        close(pR->fd);
+    }
+#endif
+    free(pR->bufAlloc);
+    memset(pR, 0, sizeof(*pR));
+}
+
+/*
+    Archive (tar, zip)
+    "archive!member" is a member of the archive.  An archive (.tar, .zip) in the sources is all its members.
+    The archive is mapped once and kept in spArchives until the end.  The index of the members is made at the
+    first time, then the readers (also the threads) only read it.  (made by the main thread in the book list)
+    A stored member (every tar member, zip method 0) is a span of the mapped archive, no copy.
+    A deflate member (zip method 8) is decompressed by the pipe thread (FORMAT_DEFLATE, needs -DHLFC_ZLIB).
+    tar:    ustar (prefix + name), GNU long name ('L') and pax path.  Only regular files.  Not compressed tar.
+    zip:    central directory, also zip64.  Directories are skipped.
+*/
+#define ARCHIVE_STORED      0                       // zip method 0, and tar
+#define ARCHIVE_DEFLATE     8                       // zip method 8
+#define TAR_BLOCK           512
+
+struct archiveMember {
+    size_t name;                                    // offset in names
+    unsigned long long offset;                      // top of the data in the archive
+    unsigned long long packedSize;                  // bytes in the archive
+    unsigned long long size;                        // bytes of the member
+    int method;                                     // ARCHIVE_STORED or ARCHIVE_DEFLATE
+};
+
+struct archive {
+    struct archive *pNext;
+    char *fname;
+    struct bookReader map;                          // READER_MMAP of the archive
+    struct archiveMember *member;                   // in the archive order
+    int members;
+    int capacity;
+    int *sorted;                                    // index of member[], in the name order
+    char *names;                                    // names of the members
+    size_t namesLen;
+    size_t namesSize;
+};
+
+static struct archive *spArchives;                  // opened archives
+
+static unsigned int getU16le(const unsigned char *p) {
+    return p[0] | (p[1] << 8);
+}
+
+static unsigned int getU32le(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned long long getU64le(const unsigned char *p) {
+    return getU32le(p) | ((unsigned long long)getU32le(p+4) << 32);
+}
+
+static int archiveAddMember(struct archive *pA, const char *name, size_t nameLen, unsigned long long offset,
+                            unsigned long long packedSize, unsigned long long size, int method) {
+    struct archiveMember *pM;
+    if ( offset > pA->map.size || packedSize > pA->map.size - offset ) {
+        return false;                               // broken archive
+    }
+    if ( pA->members == pA->capacity ) {
+        int capacity = pA->capacity ? pA->capacity*2: 256;
+        struct archiveMember *pNew = realloc(pA->member, sizeof(struct archiveMember)*capacity);
+        if ( pNew == NULL ) {
+            return false;
+        }
+        pA->member = pNew;
+        pA->capacity = capacity;
+    }
+    if ( pA->namesLen + nameLen + 1 > pA->namesSize ) {
+        size_t namesSize = MAX(pA->namesSize*2, pA->namesLen + nameLen + 1 + 4096);
+        char *pNew = realloc(pA->names, namesSize);
+        if ( pNew == NULL ) {
+            return false;
+        }
+        pA->names = pNew;
+        pA->namesSize = namesSize;
+    }
+    pM = &pA->member[pA->members++];
+    pM->name = pA->namesLen;
+    memcpy(pA->names + pA->namesLen, name, nameLen);
+    pA->names[pA->namesLen + nameLen] = '\0';
+    pA->namesLen += nameLen + 1;
+    pM->offset = offset;
+    pM->packedSize = packedSize;
+    pM->size = size;
+    pM->method = method;
+    return true;
+}
+
+/*
+    number of the tar header field (octal, or base-256 if the top bit is on)
+*/
+static unsigned long long tarNumber(const unsigned char *p, int len) {
+    unsigned long long v = 0;
+    if ( p[0] & 0x80 ) {
+        for ( int i=1; i<len; i++ ) {
+            v = (v << 8) | p[i];
+        }
+        return v;
+    }
+    for ( int i=0; i<len && p[i]; i++ ) {
+        if ( '0' <= p[i] && p[i] <= '7' ) {
+            v = (v << 3) | (p[i] - '0');
+        }
+    }
+    return v;
+}
+
+static int archiveReadTar(struct archive *pA) {
+    const unsigned char *map = pA->map.map;
+    unsigned long long size = pA->map.size;
+    char *longName = NULL;                          // 'L' or pax path for the next member
+    unsigned long long offset = 0;
+    int ok = true;
+    while ( ok && offset + TAR_BLOCK <= size ) {
+        const unsigned char *h = map + offset;
+        unsigned long long dataSize = tarNumber(h + 124, 12);
+        unsigned long long sum = 0;
+        char name[256+1];
+        if ( h[0] == '\0' ) {
+            break;                                  // end of the archive (zero block)
+        }
+        for ( int i=0; i<TAR_BLOCK; i++ ) {
+            sum += (148 <= i && i < 156) ? ' ': h[i];
+        }
+        if ( sum != tarNumber(h + 148, 8) ) {
+            fprintf(stderr, "***Error line %d:  broken tar header at %llu:  %s\n", __LINE__, offset, pA->fname);
+            ok = (offset > 0);                      // a file which is not a tar is an error
+            break;
+        }
+        offset += TAR_BLOCK;
+        if ( dataSize > size - offset ) {           // offset + dataSize may overflow
+            fprintf(stderr, "***Error line %d:  tar is cut:  %s\n", __LINE__, pA->fname);
+            break;
+        }
+        if ( h[156] == 'L' || h[156] == 'x' ) {     // name of the next member
+            const char *p = (const char *)map + offset;
+            free(longName);
+            longName = NULL;
+            if ( h[156] == 'L' ) {
+                longName = malloc(dataSize + 1);
+                if ( longName ) {
+                    memcpy(longName, p, dataSize);
+                    longName[dataSize] = '\0';
+                }
+            }
+            for ( unsigned long long i=0; h[156] == 'x' && i < dataSize; ) {   // pax records "len key=value\n"
+                unsigned long long recLen = strtoull(p + i, NULL, 10);
+                const char *key = memchr(p + i, ' ', (size_t)(dataSize - i));
+                if ( recLen == 0 || key == NULL || recLen > dataSize - i || key + 6 >= p + i + recLen ) {
+                    break;
+                }
+                if ( strncmp(key + 1, "path=", 5) == 0 ) {
+                    size_t len = p + i + recLen - 1 - (key + 6);
+                    free(longName);                 // the last path= is used
+                    if ( (longName = malloc(len + 1)) != NULL ) {
+                        memcpy(longName, key + 6, len);
+                        longName[len] = '\0';
+                    }
+                }
+                i += recLen;
+            }
+        } else if ( h[156] == '0' || h[156] == '\0' || h[156] == '7' ) {   // regular file
+            if ( longName ) {
+                ok = archiveAddMember(pA, longName, strlen(longName), offset, dataSize, dataSize, ARCHIVE_STORED);
+            } else {
+                int len = 0;
+                if ( memcmp(h + 257, "ustar", 5) == 0 && h[345] ) {     // prefix
+                    len = (int)strnlen((const char *)h + 345, 155);
+                    memcpy(name, h + 345, len);
+                    name[len++] = '/';
+                }
+                memcpy(name + len, h, strnlen((const char *)h, 100));
+                len += (int)strnlen((const char *)h, 100);
+                ok = archiveAddMember(pA, name, len, offset, dataSize, dataSize, ARCHIVE_STORED);
+            }
+            free(longName);
+            longName = NULL;
+        }
+        offset += (dataSize + TAR_BLOCK-1) / TAR_BLOCK * TAR_BLOCK;
+    }
+    free(longName);
+    return ok;
+}
+
+static int archiveReadZip(struct archive *pA) {
+    const unsigned char *map = pA->map.map;
+    unsigned long long size = pA->map.size;
+    unsigned long long eocd, entries, p;
+    if ( size < 22 ) {
+        return false;
+    }
+    for ( eocd = size - 22; eocd > 0 && getU32le(map + eocd) != 0x06054b50 && size - eocd < 22 + 65535; eocd-- ) {
+        // search the end of central directory from the end (after it, only the comment)
+    }
+    if ( getU32le(map + eocd) != 0x06054b50 ) {
+        fprintf(stderr, "***Error line %d:  not a zip archive:  %s\n", __LINE__, pA->fname);
+        return false;
+    }
+    entries = getU16le(map + eocd + 10);
+    p = getU32le(map + eocd + 16);
+    if ( eocd >= 20 && getU32le(map + eocd - 20) == 0x07064b50 ) {         // zip64
+        unsigned long long eocd64 = getU64le(map + eocd - 20 + 8);
+        if ( size >= 56 && eocd64 <= size - 56 && getU32le(map + eocd64) == 0x06064b50 ) {
+            entries = getU64le(map + eocd64 + 32);
+            p = getU64le(map + eocd64 + 48);
+        }
+    }
+    for ( unsigned long long i=0; i<entries; i++ ) {
+        unsigned long long packedSize, memberSize, local;
+        unsigned int nameLen, extraLen;
+        const unsigned char *pName;
+        if ( size < 46 || p > size - 46 || getU32le(map + p) != 0x02014b50 ) {
+            fprintf(stderr, "***Error line %d:  broken zip central directory:  %s\n", __LINE__, pA->fname);
+            return false;
+        }
+        packedSize = getU32le(map + p + 20);
+        memberSize = getU32le(map + p + 24);
+        nameLen = getU16le(map + p + 28);
+        extraLen = getU16le(map + p + 30);
+        local = getU32le(map + p + 42);
+        pName = map + p + 46;
+        if ( nameLen + extraLen > size - 46 - p ) {
+            return false;
+        }
+        for ( const unsigned char *e = pName + nameLen, *end = pName + nameLen + extraLen; end - e >= 4; e += 4 + getU16le(e + 2) ) {
+            const unsigned char *v = e + 4;
+            const unsigned char *fieldEnd = v + getU16le(e + 2);
+            if ( fieldEnd > end ) {
+                fprintf(stderr, "***Error line %d:  broken zip extra field:  %s\n", __LINE__, pA->fname);
+                return false;
+            }
+            if ( getU16le(e) == 0x0001 ) {          // zip64 extra:  only the fields which are 0xffffffff
+                if ( memberSize == 0xffffffff && fieldEnd - v >= 8 ) {
+                    memberSize = getU64le(v);
+                    v += 8;
+                }
+                if ( packedSize == 0xffffffff && fieldEnd - v >= 8 ) {
+                    packedSize = getU64le(v);
+                    v += 8;
+                }
+                if ( local == 0xffffffff && fieldEnd - v >= 8 ) {
+                    local = getU64le(v);
+                }
+            }
+        }
+        if ( nameLen && pName[nameLen-1] != '/' ) {     // not a directory
+            int method = getU16le(map + p + 10);
+            if ( size < 30 || local > size - 30 || getU32le(map + local) != 0x04034b50 ) {
+                fprintf(stderr, "***Error line %d:  broken zip member:  %s\n", __LINE__, pA->fname);
+                return false;
+            }
+            if ( method != ARCHIVE_STORED && method != ARCHIVE_DEFLATE ) {
+                fprintf(stderr, "***Error line %d:  zip method %d is not supported:  %s!%.*s\n", __LINE__, method, pA->fname, nameLen, pName);
+            } else if ( !archiveAddMember(pA, (const char *)pName, nameLen, local + 30 + getU16le(map + local + 26) + getU16le(map + local + 28),
+                                          packedSize, memberSize, method) ) {
+                return false;
+            }
+        }
+        p += 46 + nameLen + extraLen + getU16le(map + p + 32);
+    }
+    return true;
+}
+
+static struct archive *spSortArchive;               // for compareMemberName() (qsort() does not have a context)
+static int compareMemberName(const void *a, const void *b) {
+    return strcmp(spSortArchive->names + spSortArchive->member[*(const int *)a].name,
+                  spSortArchive->names + spSortArchive->member[*(const int *)b].name);
+}
+
+static int isArchiveName(const char *fname, size_t len) {
+    return len > 4 && (strncasecmp(fname + len - 4, ".tar", 4) == 0 || strncasecmp(fname + len - 4, ".zip", 4) == 0);
+}
+
+/*
+    open the archive and make the index of the members.  the archive which is already opened is used again.
+    return: NULL if error
+*/
+static struct archive *archiveOpen(const char *fname, size_t len) {
+    struct archive *pA;
+    int ok;
+    for ( pA = spArchives; pA; pA = pA->pNext ) {
+        if ( strlen(pA->fname) == len && strncmp(pA->fname, fname, len) == 0 ) {
+            return pA;
+        }
+    }
+    if ( (pA = calloc(1, sizeof(struct archive))) == NULL || (pA->fname = malloc(len + 1)) == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        free(pA);
+        return NULL;
+    }
+    memcpy(pA->fname, fname, len);
+    pA->fname[len] = '\0';
+    if ( !readerOpenFile(&pA->map, pA->fname, 1) || pA->map.mode != READER_MMAP ) {
+        fprintf(stderr, "***Error line %d:  archive can not be mapped:  %s\n", __LINE__, pA->fname);
+        readerClose(&pA->map);
+        free(pA->fname);
+        free(pA);
+        return NULL;
+    }
+    ok = strncasecmp(pA->fname + len - 4, ".zip", 4) == 0 ? archiveReadZip(pA): archiveReadTar(pA);
+    if ( ok && (pA->sorted = malloc(sizeof(int) * (pA->members + 1))) != NULL ) {
+        for ( int i=0; i<pA->members; i++ ) {
+            pA->sorted[i] = i;
+        }
+        spSortArchive = pA;
+        qsort(pA->sorted, pA->members, sizeof(int), compareMemberName);
+    }
+    pA->pNext = spArchives;                         // kept also if error, not opened again
+    spArchives = pA;
+    return pA;
+}
+
+static void freeArchives() {
+    while ( spArchives ) {
+        struct archive *pNext = spArchives->pNext;
+        readerClose(&spArchives->map);
+        free(spArchives->member);
+        free(spArchives->sorted);
+        free(spArchives->names);
+        free(spArchives->fname);
+        free(spArchives);
+        spArchives = pNext;
+    }
+}
+
+/*
+    the member of "archive!member"
+    return: NULL if the title is not a member of the opened archive
+*/
+static const struct archiveMember *archiveFindMember(const char *title, struct archive **ppA) {
+    const char *member;
+    if ( spArchives == NULL || (member = strchr(title, '!')) == NULL ) {
+        return NULL;
+    }
+    for ( struct archive *pA = spArchives; pA; pA = pA->pNext ) {
+        size_t len = strlen(pA->fname);
+        int lo = 0, hi = pA->members - 1;
+        if ( strncmp(title, pA->fname, len) != 0 || title[len] != '!' || pA->sorted == NULL ) {
+            continue;
+        }
+        member = title + len + 1;
+        while ( lo <= hi ) {                        // binary search in the name order
+            int mid = (lo + hi) / 2;
+            int cmp = strcmp(member, pA->names + pA->member[pA->sorted[mid]].name);
+            if ( cmp == 0 ) {
+                *ppA = pA;
+                return &pA->member[pA->sorted[mid]];
+            }
+            if ( cmp < 0 ) {
+                hi = mid - 1;
+            } else {
+                lo = mid + 1;
+            }
+        }
+    }
+    return NULL;
+}
+
+/*
+    open the archive of "archive!member" (called from the book list, before counting)
+*/
+static void archiveOpenForTitle(const char *title) {
+    for ( const char *p = strchr(title, '!'); p; p = strchr(p + 1, '!') ) {
+        if ( isArchiveName(title, p - title) && archiveOpen(title, p - title) ) {
+            return;
+        }
+    }
+}
+
+/*
+    the member is a span of the mapped archive
+*/
+static int readerOpenMember(struct bookReader *pR, struct archive *pA, const struct archiveMember *pM, char *fname) {
+    memset(pR, 0, sizeof(*pR));
+    pR->mode = READER_MMAP;
+    pR->borrowed = true;
+    pR->map = pA->map.map + pM->offset;
+    pR->size = pM->packedSize;
+    if ( pM->method == ARCHIVE_DEFLATE ) {
+        if ( !readerPipeOpen(pR, FORMAT_DEFLATE, fname) ) {
+            readerClose(pR);
+            return false;
+        }
+        return true;
+    }
+    return readerOpenFormat(pR, fname);             // a stored .gz member is also decompressed
+}
+
+/*
+    size and last modified time of the file
+    pMtime: [out] last modified time (nano seconds or 100 nano seconds, only for the comparison).  NULL: not needed
+    return: file size in bytes.  0 if unknown (e.g. pipe, not found)
+*/
+static unsigned long long getFileInfo(char *fname, unsigned long long *pMtime) {
+    struct archive *pA;
+    const struct archiveMember *pM = archiveFindMember(fname, &pA);
+    if ( pM ) {
+        getFileInfo(pA->fname, pMtime);             // a member is changed with the archive
+        return pM->size;
+    }
+    if ( pMtime ) {
+        *pMtime = 0;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    wchar_t WCfname[512];
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    MultiByteToWideChar(CP_UTF8, 0, fname, -1, WCfname, sizeof(WCfname)/sizeof(WCfname[0]));    // convert UTF-8 string to wchar_t
+    if ( GetFileAttributesExW(WCfname, GetFileExInfoStandard, &attr) ) {
+        if ( pMtime ) {
+            *pMtime = ((unsigned long long)attr.ftLastWriteTime.dwHighDateTime << 32) | attr.ftLastWriteTime.dwLowDateTime;
+        }
+        return ((unsigned long long)attr.nFileSizeHigh << 32) | attr.nFileSizeLow;
+    }
+#else
+    struct stat st;
+    if ( stat(fname, &st) == 0 && S_ISREG(st.st_mode) ) {
+        if ( pMtime ) {
+#   if defined(__APPLE__)
+            *pMtime = (unsigned long long)st.st_mtimespec.tv_sec * 1000000000ull + st.st_mtimespec.tv_nsec;
+#   else
+            *pMtime = (unsigned long long)st.st_mtim.tv_sec * 1000000000ull + st.st_mtim.tv_nsec;
+#   endif
+        }
+        return st.st_size;
+    }
+#endif
+    return 0;
+}
+
+/*
+    little endian binary file I/O
+*/
+static void fputU32le(unsigned int v, FILE *fp) {
+    for ( int i=0; i<4; i++ ) {
+        fputc((v >> (8*i)) & 0xff, fp);
+    }
+}
+static void fputU64le(unsigned long long v, FILE *fp) {
+    for ( int i=0; i<8; i++ ) {
+        fputc((int)((v >> (8*i)) & 0xff), fp);
+    }
+}
+static int fseekU64(FILE *fp, unsigned long long offset) {
+#if defined(_WIN32) || defined(_WIN64)
+    return _fseeki64(fp, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+static void putU64le(unsigned char *p, unsigned long long v) {
+    for ( int i=0; i<8; i++ ) {
+        p[i] = (unsigned char)(v >> (8*i));
+    }
+}
+static int fgetU32le(unsigned int *pV, FILE *fp) {
+    unsigned char b[4];
+    if ( fread(b, 1, sizeof(b), fp) != sizeof(b) ) {
+        return false;
+    }
+    *pV = b[0] | (b[1] << 8) | (b[2] << 16) | ((unsigned int)b[3] << 24);
+    return true;
+}
+static int fgetU64le(unsigned long long *pV, FILE *fp) {
+    unsigned char b[8];
+    if ( fread(b, 1, sizeof(b), fp) != sizeof(b) ) {
+        return false;
+    }
+    *pV = 0;
+    for ( int i=7; i>=0; i-- ) {
+        *pV = (*pV << 8) | b[i];
+    }
+    return true;
+}
+
+/*
+    seconds from a fixed point.  only the difference has the meaning.
+*/
+static double elapsedSecond() {
+#if defined(_WIN32) || defined(_WIN64)
+    return GetTickCount64() / 1000.;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+/*
+    cpu seconds of the process (every thread, user and system)
+*/
+static double cpuSecond() {
+#if defined(_WIN32) || defined(_WIN64)
+    FILETIME create, exit, kernel, user;
+    ULARGE_INTEGER k, u;
+    if ( !GetProcessTimes(GetCurrentProcess(), &create, &exit, &kernel, &user) ) {
+        return 0.;
+    }
+    k.LowPart = kernel.dwLowDateTime;
+    k.HighPart = kernel.dwHighDateTime;
+    u.LowPart = user.dwLowDateTime;
+    u.HighPart = user.dwHighDateTime;
+    return (k.QuadPart + u.QuadPart) / 1e7;         // 100 nano seconds
+#else
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+/*
+    peak resident set size of the process in KB
+*/
+static unsigned long long peakRssKb() {
+#if defined(_WIN32) || defined(_WIN64)
+    PROCESS_MEMORY_COUNTERS pmc;
+    return K32GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)) ? pmc.PeakWorkingSetSize / 1024: 0;
+#else
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+#   if defined(__APPLE__)
+    return ru.ru_maxrss / 1024;                     // bytes
+#   else
+    return ru.ru_maxrss;                            // KB
+#   endif
+#endif
+}
+
+/*
+    Run statistics (--stats, --stats-json FILE)
+    Without --stats nothing is measured.  The counting loop is never measured:  a stage, a book, a report section
+    and a read call are measured, not a byte.
+    wall, cpu:  the main thread is in one stage at a time.  A nested stage (e.g. the count and the report in the
+                book list of the stream mode) is not in the outer stage.  cpu is of the process, with the threads.
+    busy:       seconds in the functions called by the threads (-j N), added up.
+*/
+#define STATS_OTHER         0                       // options, tables, free
+#define STATS_LIST          1                       // step03 (step06 of merge):  the book list
+#define STATS_CACHE         2                       // step04, step40:  hlfcCache.bin
+#define STATS_COUNT         3                       // step08:  count the books
+#define STATS_OPTIMIZE      4                       // step25:  keyboard layout
+#define STATS_REPORT        5                       // step12:  the result files
+#define STATS_STAGES        6
+#define STATS_STEP10        0                       // busy:  step10_calcBookFrequency()
+#define STATS_SORTLF        1                       // busy:  sortLf()
+#define STATS_RENDER        2                       // busy:  step11 without sortLf(), step20 and step21
+#define STATS_TYPING        3                       // busy:  step20, step21
+#define STATS_BUSY          4
+#define STATS_SLOWEST       10                      // slowest books in the report
+#define STATS_BOOK_MIN      1024                    // first capacity of the books of --stats-json
+
+static const char *statsStageName[STATS_STAGES] = { "other", "book list", "cache", "count", "optimize", "report" };
+static const char *statsBusyName[STATS_BUSY] = { "step10_calcBookFrequency", "sortLf", "step11 (render)", "step20, step21 (typing)" };
+
+struct statsBook {
+    char *title;
+    unsigned long long bytes;
+    double seconds;
+};
+
+static struct runStats {
+    mutexHandle mutex;                              // busy, books and reads are added by the threads
+    int stage;                                      // current stage of the main thread
+    double stageWall;                               // start of the current stage
+    double stageCpu;
+    double wall[STATS_STAGES];
+    double cpu[STATS_STAGES];
+    double busy[STATS_BUSY];
+    unsigned long long calls[STATS_BUSY];
+    unsigned long long books;                       // books counted by step10
+    unsigned long long bytes;                       // letters counted by step10
+    unsigned long long reads;                       // read() calls of the books
+    unsigned long long readBytes;                   // bytes by read()
+    unsigned long long mappedBytes;                 // bytes of the mapped books (mmap(), stored archive members)
+    struct statsBook slowest[STATS_SLOWEST];        // slowest first
+    int numOfSlowest;
+    struct statsBook *pBook;                        // --stats-json:  every book, in the counted order
+    size_t numOfBooks;
+    size_t bookCapacity;
+} stats;
+
+static void initStats() {
+    mutexInit(&stats.mutex);
+    stats.stage = STATS_OTHER;
+    stats.stageWall = elapsedSecond();
+    stats.stageCpu = cpuSecond();
+}
+
+/*
+    the main thread enters the stage
+    return: the previous stage.  statsEnter(previous) after the nested stage
+*/
+static int statsEnter(int stage) {
+    int prev = stats.stage;
+    if ( option.stats ) {
+        double wall = elapsedSecond();
+        double cpu = cpuSecond();
+        stats.wall[prev] += wall - stats.stageWall;
+        stats.cpu[prev] += cpu - stats.stageCpu;
+        stats.stageWall = wall;
+        stats.stageCpu = cpu;
+        stats.stage = stage;
+    }
+    return prev;
+}
+
+/*
+    start time of a busy measurement.  0 without --stats
+*/
+static double statsTime() {
+    return option.stats ? elapsedSecond(): 0.;
+}
+
+/*
+    add the seconds from start to the busy time
+    return: now, the start of the next measurement
+*/
+static double statsBusy(int kind, double start) {
+    double now;
+    if ( !option.stats ) {
+        return 0.;
+    }
+    now = elapsedSecond();
+    mutexLock(&stats.mutex);
+    stats.busy[kind] += now - start;
+    stats.calls[kind]++;
+    mutexUnlock(&stats.mutex);
+    return now;
+}
+
+/*
+    a book counted by step10 from start:  the slowest books, and every book for --stats-json
+*/
+static void statsBook(const char *title, unsigned long long bytes, double start) {
+    struct statsBook book = { NULL, bytes, 0. };
+    int i;
+    if ( !option.stats ) {
+        return;
+    }
+    book.seconds = elapsedSecond() - start;
+    mutexLock(&stats.mutex);
+    stats.busy[STATS_STEP10] += book.seconds;
+    stats.calls[STATS_STEP10]++;
+    stats.books++;
+    stats.bytes += bytes;
+    for ( i=stats.numOfSlowest; i>0 && stats.slowest[i-1].seconds < book.seconds; i-- ) {
+    }
+    if ( i < STATS_SLOWEST && (book.title = strdup(title)) != NULL ) {
+        if ( stats.numOfSlowest == STATS_SLOWEST ) {
+            free(stats.slowest[--stats.numOfSlowest].title);
+        }
+        memmove(&stats.slowest[i+1], &stats.slowest[i], sizeof(book) * (stats.numOfSlowest - i));
+        stats.slowest[i] = book;
+        stats.numOfSlowest++;
+    }
+    if ( option.statsFName ) {
+        if ( stats.numOfBooks == stats.bookCapacity ) {
+            size_t capacity = stats.bookCapacity ? stats.bookCapacity*2: STATS_BOOK_MIN;
+            struct statsBook *pNew = realloc(stats.pBook, sizeof(book) * capacity);
+            if ( pNew ) {
+                stats.pBook = pNew;
+                stats.bookCapacity = capacity;
+            }
+        }
+        if ( stats.numOfBooks < stats.bookCapacity && (book.title = strdup(title)) != NULL ) {
+            stats.pBook[stats.numOfBooks++] = book;
+        }
+    }
+    mutexUnlock(&stats.mutex);
+}
+
+/*
+    the read calls of a closed reader
+*/
+static void statsReader(const struct bookReader *pR) {
+    mutexLock(&stats.mutex);
+    stats.reads += pR->reads;
+    stats.readBytes += pR->readBytes;
+    stats.mappedBytes += pR->mappedBytes;
+    mutexUnlock(&stats.mutex);
+}
+
+// ------------------------------------ Solution for the task
+/*
+    Report buffer
+    The section of a book is made in the memory, and written to the result file by fwrite().
+    So the books can be made by the threads (-j N), and the sections are written in the book order.
+*/
+#define REPORT_BUFFER_MIN   (64*1024)       // first size of a report buffer, doubled when it is full
+#define REPORT_WINDOW       64              // books made by each thread at once, then written in the book order
+#define REPORT_FILE_BUFFER  (1024*1024)     // stdio buffer of the result file:  small sections are written together
+
+struct reportBuffer {
+    char *p;                                // text (not terminated), NULL:  not allocated yet
+    size_t len;                             // length of the text
+    size_t size;                            // allocated size
+};
+
+/*
+    make the room for len more bytes (and a null), return false if no memory
+*/
+static int reportReserve(struct reportBuffer *pOut, size_t len) {
+    size_t size = MAX(pOut->size, REPORT_BUFFER_MIN);
+    char *p;
+    if ( pOut->len + len < pOut->size ) {
+        return true;
+    }
+    while ( size <= pOut->len + len ) {
+        size *= 2;
+    }
+    if ( (p = realloc(pOut->p, size)) == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        return false;
+    }
+    pOut->p = p;
+    pOut->size = size;
+    return true;
+}
+
+static void reportWrite(struct reportBuffer *pOut, const char *str, size_t len) {
+    if ( reportReserve(pOut, len) ) {
+        memcpy(pOut->p + pOut->len, str, len);
+        pOut->len += len;
+    }
+}
+
+static void reportPuts(struct reportBuffer *pOut, const char *str) {
+    reportWrite(pOut, str, strlen(str));
+}
+
+static void reportPrintf(struct reportBuffer *pOut, const char *format, ...) {
+    va_list ap;
+    int len;
+    va_start(ap, format);
+    len = vsnprintf(pOut->p ? pOut->p + pOut->len: NULL, pOut->size - pOut->len, format, ap);
+    va_end(ap);
+    if ( len >= 0 && pOut->len + len >= pOut->size ) {     // did not fit:  make it again in the larger buffer
+        if ( !reportReserve(pOut, len) ) {
+            return;
+        }
+        va_start(ap, format);
+        vsnprintf(pOut->p + pOut->len, pOut->size - pOut->len, format, ap);
+        va_end(ap);
+    }
+    if ( len > 0 ) {
+        pOut->len += len;
+    }
+}
+
+/*
+    write the text to the result file, the buffer is used again
+*/
+static void reportFlush(struct reportBuffer *pOut, FILE *fp) {
+    if ( pOut->len && fp ) {
+        fwrite(pOut->p, 1, pOut->len, fp);
+    }
+    pOut->len = 0;
+}
+
+/*
+    decimal number, without printf()
+*/
+static void reportU64(struct reportBuffer *pOut, unsigned long long v) {
+    char digits[24];
+    int n = sizeof(digits);
+    do {
+        digits[--n] = '0' + v % 10;
+        v /= 10;
+    } while ( v );
+    reportWrite(pOut, &digits[n], sizeof(digits) - n);
+}
+
+/*
+    CSV field in the double quotes, a double quote is 2 double quotes
+*/
+static void reportCsvString(struct reportBuffer *pOut, const char *str) {
+    reportPuts(pOut, "\"");
+    for ( const char *p; (p = strchr(str, '"')) != NULL; str = p + 1 ) {
+        reportWrite(pOut, str, p - str);
+        reportPuts(pOut, "\"\"");
+    }
+    reportPuts(pOut, str);
+    reportPuts(pOut, "\"");
+}
+
+/*
+    JSON string (UTF-8), the control characters are \uXXXX
+*/
+static void reportJsonString(struct reportBuffer *pOut, const char *str) {
+    reportPuts(pOut, "\"");
+    for ( ; *str; str++ ) {
+        unsigned char c = *str;
+        if ( c == '"' || c == '\\' ) {
+            char esc[2] = { '\\', c };
+            reportWrite(pOut, esc, 2);
+        } else if ( c < 0x20 ) {
+            reportPrintf(pOut, "\\u%04x", c);
+        } else {
+            reportWrite(pOut, str, 1);
+        }
+    }
+    reportPuts(pOut, "\"");
+}
+
+static void reportFree(struct reportBuffer *pOut) {
+    free(pOut->p);
+    pOut->p = NULL;
+    pOut->len = pOut->size = 0;
+}
+
+#define BARCHART_LEN_PERCENT_NULL   7       // value of strlen("00.0% ") + 1 (for null terminate)   default: 7
+#define BARCHART_BARLEN             13      // length of bar char (max bar length)                  default: 13
+#define BARCAHRT_SATURATION         12.0    // percentage of saturation (double)                    default: 12.0
+#define BARCHART_HOW_MANY_IN_LINE   3       // 3 bar char in one line                               need to be: 3
+#define BARCHART_CELL_LEN           (BARCHART_BARLEN+BARCHART_LEN_PERCENT_NULL-1)   // percent and bar of a cell
+/*
+    barChar function
+    sortLF: sort index only for the Letter Frequency Table.
+    Only the letters which are in the book are sorted (about 100 letters), the larger count first.
+    The same count is in the letter order.  The letters which are not in the book follow them in the letter order.
+    return: number of the letters which are in the book
+*/
+static int sortLf(struct letterFrequency *pLf) {
+    int letters = 0;
+    int zero = 0;
+    unsigned char absent[256];
+    for ( int c=0; c<256; c++ ) {
+        unsigned long long count = pLf->c[c];
+        int j = letters++;
+        if ( count == 0 ) {
+            absent[zero++] = c;
+            letters--;
+            continue;
+        }
+        for ( ; j>0 && pLf->c[ pLf->sortIdx[j-1] ] < count; j-- ) {     // insertion sort:  same count stays behind
+            pLf->sortIdx[j] = pLf->sortIdx[j-1];
+        }
+        pLf->sortIdx[j] = c;
+    }
+    memcpy(&pLf->sortIdx[letters], absent, zero);
+    return letters;
+}
+
+/*
+    barChart function
+    the bar of the cell:  [number of x][last mark], padded by the spaces to BARCHART_BARLEN.
+    A negative number of x (not a number) is all x, same as "%.*s" of a negative precision.
+*/
+static const char *barChart_last[4] = { "", ".", ":", "*" };
+static char barChart_glyph[BARCHART_BARLEN+1][4][BARCHART_BARLEN+1];
+static bool barChartChartLetter[256];      // true:  the letter is in the bar chart (not punctuation, space, digit)
+static const char *barChart_header =
+    " /---------------------\\   /---------------------\\   /---------------------\\\n";
+static const char *barChart_footer[3] = {
+    " \\--------+-+-+-+-+-+-*/   \\--------+-+-+-+-+-+-*/   \\--------+-+-+-+-+-+-*/\n",
+    "          0 2 4 6 8 10              0 2 4 6 8 10              0 2 4 6 8 10    \n",
+    "          % % % % % % 12%+          % % % % % % 12%+          % % % % % % 12%+\n" };
+
+static void initBarChart() {
+    for ( int n=0; n<=BARCHART_BARLEN; n++ ) {
+        for ( int last=0; last<4; last++ ) {
+            char *pGlyph = barChart_glyph[n][last];
+            memset(pGlyph, ' ', BARCHART_BARLEN);
+            memset(pGlyph, 'x', n);
+            if ( n < BARCHART_BARLEN ) {
+                pGlyph[n] = barChart_last[last][0] ? barChart_last[last][0]: ' ';
+            }
+            pGlyph[BARCHART_BARLEN] = '\0';
+        }
+    }
+    for ( int c=0; c<256; c++ ) {
+        barChartChartLetter[c] = !ispunct1250(c) && !isspace(c) && !isdigit(c);
+    }
+}
+
+/*
+    barChart function
+    "%4.1lf%% " of 100.*count/total by the integers.  printf() rounds the double, which is the nearest to the fraction,
+    so the result is the same except a tie (x.x5).  A tie, a very large total and no total are printed by snprintf().
+    return: length
+*/
+static int barChartPercent(char *pStr, int maxLen, unsigned long long count, unsigned long long total) {
+    unsigned long long tenth;
+    char digits[32];
+    int n = 0, len = 0;
+    if ( total == 0 || total >= (1ULL << 32) || count > ULLONG_MAX / 1000 || (count * 1000 % total) * 2 == total ) {
+        return MIN(snprintf(pStr, maxLen, "%4.1lf%% ", 100.*count/total), maxLen - 1);
+    }
+    tenth = count * 1000 / total + ((count * 1000 % total) * 2 > total);
+    digits[n++] = '0' + tenth % 10;
+    digits[n++] = '.';
+    do {
+        tenth /= 10;
+        digits[n++] = '0' + tenth % 10;
+    } while ( tenth >= 10 );
+    if ( n == 3 ) {
+        digits[n++] = ' ';                              // width 4
+    }
+    while ( n ) {
+        pStr[len++] = digits[--n];
+    }
+    pStr[len++] = '%';
+    pStr[len++] = ' ';
+    return len;
+}
+
+/*
+    barChart function
+    create a table content for one table:  percent and bar, BARCHART_CELL_LEN letters (not terminated)
+*/
+static int barChart(char *pStr, double saturat, unsigned long long count, unsigned long long total) {
+    int maxLen = BARCHART_BARLEN;
+    double value = 100.*count / total;
+    int numOfSmallx;    // number of Large X
+    double lastx_value;    // value of last X
+    int last;           // index of barChart_last[]
+    char percent[32];
+    int len;
+    numOfSmallx = (int)(value / saturat * maxLen);
+    lastx_value = value - (double)numOfSmallx / maxLen * saturat;
+    if ( saturat+(double)saturat/maxLen/3 < value ) {
+        numOfSmallx = maxLen - 1;
+        last = 3;
+    } else {
+        if ( lastx_value <= (double)saturat/maxLen/3. ) {
+            last = 0;
+        } else if ( (double)saturat/maxLen/3. < lastx_value && lastx_value < (double)saturat/maxLen*2./3. ) {
+            last = 1;
+        } else {
+            last = 2;
+        }
+    }
+    if ( numOfSmallx < 0 || maxLen < numOfSmallx ) {
+        numOfSmallx = maxLen;
+        last = 0;
+    }
+    if ( value==0 ) {
+        len = 7;
+        memcpy(percent, "       ", len);
+    } else {
+        len = MIN(barChartPercent(percent, sizeof(percent), count, total), BARCHART_CELL_LEN);
+    }
+    memcpy(pStr, percent, len);
+    memcpy(pStr + len, barChart_glyph[numOfSmallx][last], BARCHART_CELL_LEN - len);
+    return BARCHART_CELL_LEN;
+}
+
+/*
+    Counting kernel
+    Only the raw byte histogram is counted in the hot loop.  Every other counter is derived from it afterwards.
+    Several interleaved sub histograms are used, so that the same letter in a row does not wait for the previous
+    store (store forwarding stall).  The sub histograms are 32 bit, flushed to 64 bit before they can overflow.
+    The scatter to the counters is the cost, not the load:  a SIMD load (SSE2, AVX2) with the same scatter was slower
+    than the 64 bit load (hlfc bench), so there is one kernel for every CPU.
+*/
+#define HISTOGRAM_WAYS      8                       // number of interleaved sub histograms
+#define HISTOGRAM_BLOCK     (1u<<30)                // max bytes for the 32 bit sub histograms at once (< UINT_MAX)
+
+/*
+    add the sub histograms to the 64 bit histogram
+*/
+static void flushSubHistogram(unsigned int sub[HISTOGRAM_WAYS][256], unsigned long long hist[256]) {
+    for ( int i=0; i<256; i++ ) {
+        unsigned long long sum = 0;
+        for ( int way=0; way<HISTOGRAM_WAYS; way++ ) {
+            sum += sub[way][i];
+        }
+        hist[i] += sum;
+    }
+}
+
+/*
+    count 8 bytes in a 64 bit word into the sub histograms
+*/
+#define COUNT_WORD64(sub, w) do {                                                       \
+        unsigned long long w_ = (w);                                                    \
+        sub[0][(unsigned char)(w_      )]++;    sub[1][(unsigned char)(w_ >>  8)]++;    \
+        sub[2][(unsigned char)(w_ >> 16)]++;    sub[3][(unsigned char)(w_ >> 24)]++;    \
+        sub[4][(unsigned char)(w_ >> 32)]++;    sub[5][(unsigned char)(w_ >> 40)]++;    \
+        sub[6][(unsigned char)(w_ >> 48)]++;    sub[7][(unsigned char)(w_ >> 56)]++;    \
+    } while (0)
+
+/*
+    count each byte into the histogram
+*/
+static void countHistogram(const unsigned char *p, size_t len, unsigned long long hist[256]) {
+    while ( len ) {
+        unsigned int sub[HISTOGRAM_WAYS][256] = { 0 };
+        size_t n = MIN(len, (size_t)HISTOGRAM_BLOCK);
+        size_t i = 0;
+        for ( ; i+8<=n; i+=8 ) {
+            unsigned long long w;
+            memcpy(&w, p+i, sizeof(w));                 // unaligned 8 bytes load
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+            w = __builtin_bswap64(w);                   // histogram does not depend on the order, but keep it same
+#endif
+            COUNT_WORD64(sub, w);
+        }
+        for ( ; i<n; i++ ) {
+            sub[0][p[i]]++;
+        }
+        flushSubHistogram(sub, hist);
+        p += n;
+        len -= n;
+    }
+}
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#   define HISTOGRAM_X86                            // SSE2 for the ASCII run of the UTF-8 decoder
+#   include <immintrin.h>
+#endif
+
+/*
+    count CRLF in a span
+    pPrevCr:    [in/out] the last letter of the previous span was '\r'.  CRLF can be across the spans.
+*/
+static unsigned long long countCrLf(const unsigned char *p, size_t len, bool *pPrevCr) {
+    unsigned long long crlf = 0;
+    const unsigned char *end = p + len;
+    if ( len == 0 ) {
+        return 0;
+    }
+    if ( *pPrevCr && *p == '\n' ) {
+        crlf++;
+    }
+    while ( (p = memchr(p, '\r', end - p)) != NULL && p+1 < end ) {
+        if ( p[1] == '\n' ) {
+            crlf++;
+        }
+        p++;
+    }
+    *pPrevCr = (end[-1] == '\r');
+    return crlf;
+}
+
+/*
+    UTF-8 books
+    A UTF-8 book is decoded to CP1250 before the count, so all the counters (histogram, n-gram, words) are the same
+    as for the CP1250 book.  an invalid sequence is CP1250_OTHER, same as a letter which is not in CP1250 (see Codepage).
+    BOM is not a letter.
+    ASCII is copied by 16 bytes at once (SSE2), other sequences are validated and decoded one by one:  no overlong,
+    no surrogate, max U+10FFFF.  A sequence cut at the end of a span is kept for the next span.
+    Encoding of a book (--encoding auto):  BOM, or the sample from the first non-ASCII byte is valid UTF-8.
+    The ASCII only part does not decide it, it is the same in both encodings.
+*/
+#define UTF8_NONE           (-1)                    // no letter (BOM)
+#define UTF8_INVALID        (-2)                    // invalid sequence
+#define ENCODING_SAMPLE     4096                    // bytes to be validated for the encoding
+#define DECODE_BLOCK        (1024*1024)             // decoded letters (UTF-8, ISO-8859-2, CP852) counted at once
+
+static unsigned char utf8Letter2[0x800];            // U+0080-U+07FF (2 bytes) to CP1250, made by initUtf8()
+
+struct utf8Decoder {
+    unsigned char pending[4];                       // a sequence cut at the end of the span
+    int pendingLen;
+    unsigned long long invalid;                     // count of the invalid sequences
+};
+
+static void initUtf8() {
+    for ( int cp=0; cp<0x800; cp++ ) {
+        utf8Letter2[cp] = unicodeToCp1250(cp);
+    }
+}
+
+/*
+    CP1250 letter of a 3 or 4 bytes sequence (U+0800 or larger), only the punctuation of CP1250 (– “ ” „ … € ...)
+*/
+static int utf8LetterHigh(unsigned int cp) {
+    return cp == 0xfeff ? UTF8_NONE: unicodeToCp1250(cp);        // BOM is not a letter
+}
+
+/*
+    decode a sequence
+    pLetter:    [out] CP1250 letter, UTF8_NONE or UTF8_INVALID
+    return:     bytes of the sequence.  an invalid sequence is its valid top part (at least 1 byte).
+                0:  the sequence is cut at the end, needs the next bytes
+*/
+static size_t decodeUtf8Letter(const unsigned char *p, size_t len, int *pLetter) {
+    unsigned int c = p[0];
+    unsigned int cp;
+    size_t need;
+    if ( c < 0x80 ) {
+        *pLetter = c;
+        return 1;
+    }
+    if ( c < 0xc2 || c > 0xf4 ) {                   // not a top byte, or overlong 2 bytes, or larger than U+10FFFF
+        *pLetter = UTF8_INVALID;
+        return 1;
+    }
+    need = c < 0xe0 ? 2: (c < 0xf0 ? 3: 4);
+    cp = c & (0x7f >> need);
+    for ( size_t i=1; i<need; i++ ) {
+        unsigned int lo = (i == 1 && c == 0xe0) ? 0xa0: ((i == 1 && c == 0xf0) ? 0x90: 0x80);  // overlong
+        unsigned int hi = (i == 1 && c == 0xed) ? 0x9f: ((i == 1 && c == 0xf4) ? 0x8f: 0xbf);  // surrogate, > U+10FFFF
+        if ( i == len ) {
+            return 0;
+        }
+        if ( p[i] < lo || p[i] > hi ) {
+            *pLetter = UTF8_INVALID;
+            return i;
+        }
+        cp = (cp << 6) | (p[i] & 0x3f);
+    }
+    *pLetter = cp < 0x800 ? utf8Letter2[cp]: utf8LetterHigh(cp);
+    return need;
+}
+
+/*
+    length of the ASCII bytes at the top
+*/
+static size_t asciiLength(const unsigned char *p, size_t len) {
+    size_t i = 0;
+#if defined(HISTOGRAM_X86) && defined(__SSE2__)
+    for ( ; i+16<=len; i+=16 ) {
+        int mask = _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)(p+i)));
+        if ( mask ) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+#else
+    for ( ; i+8<=len; i+=8 ) {
+        unsigned long long w;
+        memcpy(&w, p+i, sizeof(w));
+        if ( w & 0x8080808080808080ull ) {
+            break;
+        }
+    }
+#endif
+    while ( i < len && p[i] < 0x80 ) {
+        i++;
+    }
+    return i;
+}
+
+/*
+    decode UTF-8 to CP1250
+    Input:  p, len:     bytes of the book
+            outSize:    size of out[], 16 or larger
+    Output: out:        CP1250 letters
+            pUsed:      bytes of p[] used.  the sequence cut at the end is in pD->pending (used)
+    return: count of the letters in out[]
+*/
+static size_t decodeUtf8(struct utf8Decoder *pD, const unsigned char *p, size_t len, unsigned char *out, size_t outSize, size_t *pUsed) {
+    size_t i = 0;
+    size_t o = 0;
+    int letter;
+    while ( pD->pendingLen && i < len ) {           // the sequence from the previous span
+        size_t n;
+        pD->pending[pD->pendingLen++] = p[i++];
+        if ( (n = decodeUtf8Letter(pD->pending, pD->pendingLen, &letter)) == 0 ) {
+            continue;
+        }
+        i -= pD->pendingLen - n;                    // the bytes after an invalid sequence are decoded again
+        pD->pendingLen = 0;
+        if ( letter == UTF8_INVALID ) {
+            pD->invalid++;
+            letter = CP1250_OTHER;
+        }
+        if ( letter != UTF8_NONE ) {
+            out[o++] = letter;
+        }
+    }
+    while ( i < len && o < outSize ) {
+        size_t n;
+#if defined(HISTOGRAM_X86) && defined(__SSE2__)
+        while ( i+16 <= len && o+16 <= outSize ) {  // ASCII:  16 bytes are copied, the letters until non-ASCII are used
+            __m128i v = _mm_loadu_si128((const __m128i *)(p+i));
+            int mask = _mm_movemask_epi8(v);
+            _mm_storeu_si128((__m128i *)(out+o), v);
+            if ( mask ) {
+                n = __builtin_ctz(mask);
+                i += n;
+                o += n;
+                break;
+            }
+            i += 16;
+            o += 16;
+        }
+#endif
+        n = MIN(asciiLength(p+i, len-i), outSize-o);
+        memcpy(out+o, p+i, n);
+        i += n;
+        o += n;
+        if ( i == len || o == outSize ) {
+            break;
+        }
+        if ( (n = decodeUtf8Letter(p+i, len-i, &letter)) == 0 ) {
+            memcpy(pD->pending, p+i, len-i);        // cut at the end of the span
+            pD->pendingLen = (int)(len-i);
+            i = len;
+            break;
+        }
+        if ( letter == UTF8_INVALID ) {
+            pD->invalid++;
+            letter = CP1250_OTHER;
+        }
+        if ( letter != UTF8_NONE ) {
+            out[o++] = letter;
+        }
+        i += n;
+    }
+    *pUsed = i;
+    return o;
+}
+
+/*
+    convert a single byte codepage to CP1250
+    return: count of the letters in out[] (same as the bytes used)
+*/
+static size_t decodeCodepage(const unsigned char toCp1250[256], const unsigned char *p, size_t len, unsigned char *out, size_t outSize, size_t *pUsed) {
+    size_t n = MIN(len, outSize);
+    for ( size_t i=0; i<n; i++ ) {
+        out[i] = toCp1250[p[i]];
+    }
+    *pUsed = n;
+    return n;
+}
+
+/*
+    single byte codepage of the sample, which has the most Hungarian letters
+    a Hungarian letter is 1 point, a byte which is not used in the codepage (also the control code of ISO-8859-2) is
+    -1 point.  the other letters are not counted (« » of CP1250 are Ť ť of ISO-8859-2).
+    same points:  CP1250 > ISO-8859-2 > CP852  (Hungarian letters of CP1250 and ISO-8859-2 are the same)
+*/
+static int detectCodepage(const unsigned char *p, size_t len) {
+    static const int candidate[] = { ENCODING_CP1250, ENCODING_ISO8859_2, ENCODING_CP852 };
+    int best = ENCODING_CP1250;
+    long bestScore = LONG_MIN;
+    for ( int k=0; k<sizeof(candidate)/sizeof(candidate[0]); k++ ) {
+        const struct codepage *pC = &codepage[candidate[k]];
+        long score = 0;
+        for ( size_t i=0; i<len; i++ ) {
+            unsigned int cp = p[i] < 0x80 ? 0x20: pC->unicode[p[i]-0x80];
+            unsigned char cls = cp1250Class[pC->toCp1250[p[i]]];
+            score += (cp == 0 || (cp >= 0x80 && cp < 0xa0)) ? -1: ((cls & CP1250_HUNGARIAN) ? 1: 0);
+        }
+        if ( score > bestScore ) {
+            best = candidate[k];
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+/*
+    encoding of the book from a span
+    top:    the span is the top of the book (BOM)
+    return: ENCODING_UTF8, the single byte codepage, or ENCODING_AUTO if the span has only ASCII
+*/
+static int detectEncoding(const unsigned char *p, size_t len, bool top) {
+    size_t i;
+    size_t end;
+    size_t first;
+    if ( top && len >= strlen(BOM_UTF8) && memcmp(p, BOM_UTF8, strlen(BOM_UTF8)) == 0 ) {
+        return ENCODING_UTF8;
+    }
+    if ( (i = asciiLength(p, len)) == len ) {
+        return ENCODING_AUTO;
+    }
+    for ( first = i, end = MIN(len, i + ENCODING_SAMPLE); i < end; ) {
+        int letter;
+        size_t n = decodeUtf8Letter(p+i, len-i, &letter);
+        if ( n == 0 ) {
+            break;                                  // cut at the end of the span, valid until here
+        }
+        if ( letter == UTF8_INVALID ) {
+            return detectCodepage(p + first, end - first);
+        }
+        i += n;
+    }
+    return ENCODING_UTF8;
+}
+
+/*
+    Content hash for the cache
+    sum of the mixed 8 bytes words, each word is mixed with its position in the file.  A sum does not depend on
+    the order, so the chunks counted by the threads can be added.  (chunk boundary is a multiple of 8)
+*/
+#define HASH_GOLDEN     0x9e3779b97f4a7c15ull       // golden ratio, for the position of the word
+
+struct contentHash {
+    unsigned long long sum;                         // sum of the mixed words
+    unsigned long long length;                      // bytes hashed, including tail[]
+    unsigned char tail[8];                          // the last bytes, not a complete word yet
+    int tailLen;                                    // length of tail[]
+};
+
+static unsigned long long mix64(unsigned long long x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+/*
+    offset: position of the first byte in the file.  need to be a multiple of 8
+*/
+static void hashInit(struct contentHash *pH, unsigned long long offset) {
+    memset(pH, 0, sizeof(*pH));
+    pH->length = offset;
+}
+
+static void hashUpdate(struct contentHash *pH, const unsigned char *p, size_t len) {
+    unsigned long long w;
+    while ( len && pH->tailLen ) {                  // complete the word in tail[]
+        pH->tail[pH->tailLen++] = *p++;
+        pH->length++;
+        len--;
+        if ( pH->tailLen == 8 ) {
+            memcpy(&w, pH->tail, sizeof(w));
+            pH->sum += mix64(w ^ ((pH->length/8 - 1) * HASH_GOLDEN));
+            pH->tailLen = 0;
+        }
+    }
+    for ( ; len >= 8; p+=8, len-=8 ) {
+        memcpy(&w, p, sizeof(w));
+        pH->sum += mix64(w ^ ((pH->length/8) * HASH_GOLDEN));
+        pH->length += 8;
+    }
+    if ( len ) {                                    // here tail[] is always empty
+        memcpy(pH->tail, p, len);
+        pH->tailLen = (int)len;
+        pH->length += len;
+    }
+}
+
+static unsigned long long hashFinal(struct contentHash *pH) {
+    unsigned long long h = pH->sum;
+    if ( pH->tailLen ) {
+        unsigned long long w = 0;
+        memcpy(&w, pH->tail, pH->tailLen);
+        h += mix64(w ^ ((pH->length/8) * HASH_GOLDEN) ^ 0xff);
+    }
+    return mix64(h ^ pH->length);
+}
+
+/*
+    calculate the letter frequency from the raw histogram
+    c[] is case folded by toupper1250, other counters are summed up by the character class
+*/
+static void calcLfFromHistogram(struct letterFrequency *pLf) {
+    memset(pLf->c, 0, sizeof(pLf->c));
+    pLf->totalAlphabets = pLf->totalHungarian = pLf->punctuation = pLf->digit = pLf->totalLetters = 0;
+    for ( int i=0; i<sizeof(pLf->raw)/sizeof(pLf->raw[0]); i++ ) {
+        unsigned long long n = pLf->raw[i];
+        unsigned char cls = cp1250Class[i];
+        pLf->c[cp1250Upper[i]] += n;
+        pLf->punctuation    += (cls & CP1250_PUNCT)?     n: 0;
+        pLf->digit          += (cls & CP1250_DIGIT)?     n: 0;
+        pLf->totalHungarian += (cls & CP1250_HUNGARIAN)? n: 0;
+        pLf->totalAlphabets += (cls & CP1250_ALPHA)?     n: 0;
+        pLf->totalLetters   += (cls & CP1250_SPACE)?     0: n;
+    }
+}
+
+/*
+    add the letter frequency of a book to the total
+*/
+static void addLf(struct letterFrequency *pTotal, const struct letterFrequency *pLf) {
+    for ( int i=0; i<sizeof(pLf->raw)/sizeof(pLf->raw[0]); i++ ) {
+        pTotal->raw[i] += pLf->raw[i];
+        pTotal->c[i]   += pLf->c[i];
+    }
+    pTotal->totalAlphabets += pLf->totalAlphabets;
+    pTotal->totalHungarian += pLf->totalHungarian;
+    pTotal->punctuation    += pLf->punctuation;
+    pTotal->digit          += pLf->digit;
+    pTotal->totalLetters   += pLf->totalLetters;
+}
+
+/*
+    N-gram counting (--ngram)
+    counted in the same pass as the histogram, from the same span (countHistogramNgram).
+    Class:      the 2 bytes before a byte, from one table by the 16 bits of them (ngramClass[]):  not a letter before,
+                '\r' before (NGRAM_CLASS_CR), or the case folded letter before (ngramByte[].row) with the letter index
+                of the byte before it.  A byte costs 1 counter, count[class][byte], same as the histogram.
+                The histogram (sum of each column), CRLF, the bigrams and the trigrams are made from the counters at the
+                end of the span (flushNgramClass):  by the bytes of a small span, by the whole table of a large span.
+    Bigram:     case folded letter pair, a flat table.  index = (toupper1250(first) << 8) | toupper1250(second)
+    Trigram:    only the letters.  Each letter has an index (ngramByte[].letter, 0: not a letter, NGRAM_LETTERS-1: other letter),
+                index = 3 letter indexes in base NGRAM_LETTERS, a flat table of 50K (200KB) counters.
+                a trigram with 0 is not a trigram.
+    The counters are 32 bits, the bigrams and the trigrams are added to the n-gram of the book every NGRAM_FLUSH bytes
+    and at the end.
+    The n-gram of a book is a small hash table of the found bigrams and trigrams (NGRAM_KEY_BIGRAM, NGRAM_KEY_TRIGRAM).
+    The last 2 bytes are kept for the next span, chunk and --follow, so the result is the same as the serial count.
+    NOTE:   only the letters are counted as the bigrams and the trigrams, same as the report.
+*/
+#define NGRAM_BIGRAMS           (256*256)
+#define NGRAM_LETTERS           (1 + 26 + 9 + 1)    // not a letter, A-Z, ÁÉÍÓŐÖÚŰÜ, other letter
+#define NGRAM_ROWS              70                  // not a letter, each case folded letter of CP1250 (69)
+#define NGRAM_CLASS_CR          1                   // class of the byte after '\r'.  0: after not a letter
+#define NGRAM_CLASS_LETTER      2                   // + (row - 1) * NGRAM_LETTERS + letter index of the byte before the letter
+#define NGRAM_CLASSES           (NGRAM_CLASS_LETTER + (NGRAM_ROWS-1) * NGRAM_LETTERS)
+#define NGRAM_WALK_MAX          (256*1024)          // a smaller span is flushed by its bytes, a larger by the whole table
+#define NGRAM_TRIGRAMS          (NGRAM_LETTERS*NGRAM_LETTERS*NGRAM_LETTERS)
+#define NGRAM_FLUSH             (UINT_MAX / 2)      // 32 bits counters are added to 64 bits counters before this bytes
+#define NGRAM_KEY_BIGRAM        (2u << 24)          // key of the hash table = kind | index
+#define NGRAM_KEY_TRIGRAM       (3u << 24)
+#define NGRAM_KEY_INDEX         ((1u << 24) - 1)
+#define NGRAM_TRIGRAM_INDEX(a,b,c) ((ngramByte[a].letter * NGRAM_LETTERS + ngramByte[b].letter) * NGRAM_LETTERS + ngramByte[c].letter)
+
+static struct {                                     // the tables of each byte
+    unsigned char letter;                           // letter index for the trigram.  0: not a letter
+    unsigned char row;                              // case folded letter.  0: not a letter
+} ngramByte[256];
+static unsigned char ngramIdxLetter[NGRAM_LETTERS]; // uppercase letter of each letter index
+static unsigned char ngramRowLetter[NGRAM_ROWS];    // uppercase letter of each row.  0: not a letter
+static unsigned int ngramClass[65536];              // class * 256 of the 2 bytes before:  [byte[-2] | (byte[-1] << 8)]
+
+struct ngramCounter {                               // a counting thread has one
+    unsigned int count[NGRAM_CLASSES*256];          // [class of the 2 bytes before][byte].  0 after each span
+    unsigned int bigram[NGRAM_BIGRAMS];
+    unsigned int trigram[NGRAM_TRIGRAMS];
+    unsigned long long pending;                     // bytes in the 32 bits counters
+    struct ngramFrequency *pTarget;                 // the counters are added to here
+    int poolSlot;                                   // index in the counter pool.  -1: not in the pool
+};
+
+struct ngramEntry {
+    unsigned int key;                               // NGRAM_KEY_BIGRAM or NGRAM_KEY_TRIGRAM | index
+    unsigned long long count;                       // 0: empty entry
+};
+
+struct ngramFrequency {
+    struct ngramEntry *entry;                       // hash table of the bigrams and the trigrams
+    unsigned int size;                              // size of the hash table (power of 2)
+    unsigned int entries;                           // number of the n-grams in the hash table
+    unsigned int last;                              // last 2 bytes counted:  (byte[-2] << 8) | byte[-1]
+};
+
+/*
+    make the letter index:  the hungarian alphabet has an index, the other letters are NGRAM_LETTERS-1 (other letter)
+*/
+static void initNgram() {
+    const char *hungarian = "ABCDEFGHIJKLMNOPQRSTUVWXYZ" HUNGARIAN_UPPERLETTERS;
+    int rows = 1;
+    memset(ngramByte, 0, sizeof(ngramByte));
+    for ( int c=0; c<256; c++ ) {                   // the row of the uppercase letter, the lowercase letter is the same row
+        int upper = toupper1250(c);
+        if ( isalpha1250(c) && ngramByte[upper].row == 0 && rows < NGRAM_ROWS ) {
+            ngramRowLetter[rows] = (unsigned char)upper;
+            ngramByte[upper].row = rows++;
+        }
+        ngramByte[c].row = isalpha1250(c) ? ngramByte[upper].row: 0;
+    }
+    for ( int i=0; hungarian[i]; i++ ) {
+        ngramIdxLetter[i+1] = (unsigned char)hungarian[i];
+        ngramByte[(unsigned char)hungarian[i]].letter = i+1;
+    }
+    ngramIdxLetter[NGRAM_LETTERS-1] = '?';
+    for ( int c=0; c<256; c++ ) {
+        int idx = ngramByte[toupper1250(c)].letter; // lowercase letter is the same index
+        ngramByte[c].letter = idx ? idx: (isalpha1250(c) ? NGRAM_LETTERS-1: 0);
+    }
+    for ( int b1=0; b1<256; b1++ ) {                // the class of the 2 bytes before
+        for ( int b2=0; b2<256; b2++ ) {
+            unsigned int class = b1 == '\r' ? NGRAM_CLASS_CR: ngramByte[b1].row == 0 ? 0
+                               : NGRAM_CLASS_LETTER + (ngramByte[b1].row - 1) * NGRAM_LETTERS + ngramByte[b2].letter;
+            ngramClass[b2 | (b1 << 8)] = class * 256;
+        }
+    }
+}
+
+static struct ngramFrequency *newNgram() {
+    struct ngramFrequency *pN = calloc(1, sizeof(struct ngramFrequency));
+    if ( pN == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+    }
+    return pN;
+}
+
+static void clearNgram(struct ngramFrequency *pN) {
+    free(pN->entry);
+    memset(pN, 0, sizeof(*pN));
+}
+
+static void freeNgram(struct ngramFrequency *pN) {
+    if ( pN ) {
+        free(pN->entry);
+        free(pN);
+    }
+}
+
+/*
+    counter pool:  the counters are used again for the next book (a new counter costs more than a small book)
+    a slot is taken by atomicFetchAdd() of the busy flag:  0 -> 1 is the owner.
+*/
+#define NGRAM_POOL              64
+static struct ngramCounter *spNgramPool[NGRAM_POOL];
+static volatile long ngramPoolBusy[NGRAM_POOL];
+
+static struct ngramCounter *takeNgramCounter(struct ngramFrequency *pTarget) {
+    struct ngramCounter *pC = NULL;
+    for ( int i=0; i<NGRAM_POOL && pC == NULL; i++ ) {
+        if ( atomicFetchAdd(&ngramPoolBusy[i], 1) != 0 ) {
+            atomicFetchAdd(&ngramPoolBusy[i], -1);  // used by the other thread
+            continue;
+        }
+        if ( spNgramPool[i] == NULL && (spNgramPool[i] = calloc(1, sizeof(struct ngramCounter))) == NULL ) {
+            atomicFetchAdd(&ngramPoolBusy[i], -1);
+            break;
+        }
+        pC = spNgramPool[i];
+        pC->poolSlot = i;
+    }
+    if ( pC == NULL && (pC = calloc(1, sizeof(struct ngramCounter))) != NULL ) {
+        pC->poolSlot = -1;                          // the pool is full
+    }
+    if ( pC ) {
+        pC->pTarget = pTarget;
+    }
+    return pC;
+}
+
+/*
+    return the counter to the pool.  the counters have to be flushed (all 0).
+*/
+static void giveNgramCounter(struct ngramCounter *pC) {
+    if ( pC == NULL ) {
+        return;
+    } else if ( pC->poolSlot < 0 ) {
+        free(pC);
+    } else {
+        atomicFetchAdd(&ngramPoolBusy[pC->poolSlot], -1);
+    }
+}
+
+static void freeNgramPool() {
+    for ( int i=0; i<NGRAM_POOL; i++ ) {
+        free(spNgramPool[i]);
+        spNgramPool[i] = NULL;
+    }
+}
+
+static inline unsigned int ngramHash(unsigned int key) {
+    key *= 2654435761u;
+    return key ^ (key >> 16);                       // the low bits are used, from the high bits too
+}
+
+/*
+    add an n-gram to the hash table
+*/
+static void addNgramEntry(struct ngramFrequency *pN, unsigned int key, unsigned long long count) {
+    unsigned int mask;
+    unsigned int h;
+    if ( (pN->entries+1) * 2 > pN->size ) {         // keep the load factor under 50%
+        struct ngramEntry *pOld = pN->entry;
+        unsigned int oldSize = pN->size;
+        unsigned int newSize = oldSize ? oldSize*2: 1024;
+        struct ngramEntry *pNew = calloc(newSize, sizeof(struct ngramEntry));
+        if ( pNew == NULL ) {
+            fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+            return;
+        }
+        pN->entry = pNew;
+        pN->size = newSize;
+        pN->entries = 0;
+        for ( unsigned int i=0; i<oldSize; i++ ) {
+            if ( pOld[i].count ) {
+                addNgramEntry(pN, pOld[i].key, pOld[i].count);
+            }
+        }
+        free(pOld);
+    }
+    mask = pN->size - 1;
+    for ( h = ngramHash(key) & mask; pN->entry[h].count && pN->entry[h].key != key; h = (h+1) & mask ) {
+        ;
+    }
+    if ( pN->entry[h].count == 0 ) {
+        pN->entry[h].key = key;
+        pN->entries++;
+    }
+    pN->entry[h].count += count;
+}
+
+static unsigned long long findNgramEntry(const struct ngramFrequency *pN, unsigned int key) {
+    unsigned int mask = pN->size - 1;
+    if ( pN->size == 0 ) {
+        return 0;
+    }
+    for ( unsigned int h = ngramHash(key) & mask; pN->entry[h].count; h = (h+1) & mask ) {
+        if ( pN->entry[h].key == key ) {
+            return pN->entry[h].count;
+        }
+    }
+    return 0;
+}
+
+/*
+    add the 32 bits counters to the n-gram (pTarget), then clear them
+*/
+static void flushNgramCounter(struct ngramCounter *pC) {
+    struct ngramFrequency *pN = pC->pTarget;
+    if ( pC->pending == 0 ) {
+        return;
+    }
+    for ( int i=0; i<NGRAM_BIGRAMS; i++ ) {
+        if ( pC->bigram[i] ) {
+            addNgramEntry(pN, NGRAM_KEY_BIGRAM | i, pC->bigram[i]);
+        }
+    }
+    for ( int a=1; a<NGRAM_LETTERS; a++ ) {         // only 3 letters
+        for ( int b=1; b<NGRAM_LETTERS; b++ ) {
+            for ( int c=1, i=(a*NGRAM_LETTERS + b)*NGRAM_LETTERS + 1; c<NGRAM_LETTERS; c++, i++ ) {
+                if ( pC->trigram[i] ) {
+                    addNgramEntry(pN, NGRAM_KEY_TRIGRAM | i, pC->trigram[i]);
+                }
+            }
+        }
+    }
+    memset(pC->bigram, 0, sizeof(pC->bigram));
+    memset(pC->trigram, 0, sizeof(pC->trigram));
+    pC->pending = 0;
+}
+
+/*
+    add a counter of a class to the histogram, the bigrams and the trigrams
+    return: count of CRLF
+*/
+static unsigned long long addNgramClass(struct ngramCounter *pC, unsigned long long hist[256], unsigned int class,
+                                        unsigned int c, unsigned int n) {
+    hist[c] += n;
+    if ( class >= NGRAM_CLASS_LETTER && ngramByte[c].row ) {                    // a letter after a letter
+        unsigned int row = (class - NGRAM_CLASS_LETTER) / NGRAM_LETTERS + 1;
+        unsigned int letter2 = (class - NGRAM_CLASS_LETTER) % NGRAM_LETTERS;   // 0:  not a trigram
+        pC->bigram[(ngramRowLetter[row] << 8) | cp1250Upper[c]] += n;
+        pC->trigram[(letter2 * NGRAM_LETTERS + ngramByte[ngramRowLetter[row]].letter) * NGRAM_LETTERS + ngramByte[c].letter] += n;
+    }
+    return (class == NGRAM_CLASS_CR && c == '\n') ? n: 0;
+}
+
+/*
+    add the counters of the classes to the histogram, the bigrams and the trigrams, then clear them
+    a small span:  only the counters of its bytes.  a large span:  every counter
+    Input:  p, len: the span counted, last:  the 2 bytes before it, (byte[-2] << 8) | byte[-1]
+    return: count of CRLF
+*/
+static unsigned long long flushNgramClass(struct ngramCounter *pC, const unsigned char *p, size_t len, unsigned int last,
+                                          unsigned long long hist[256]) {
+    unsigned long long crlf = 0;
+    if ( len < NGRAM_WALK_MAX ) {
+        for ( size_t i=0; i<len; i++ ) {
+            unsigned int b2 = i >= 2 ? p[i-2]: (i == 1 ? last & 0xff: (last >> 8) & 0xff);
+            unsigned int b1 = i >= 1 ? p[i-1]: last & 0xff;
+            unsigned int *pCount = &pC->count[ngramClass[b2 | (b1 << 8)] + p[i]];
+            if ( *pCount ) {
+                crlf += addNgramClass(pC, hist, ngramClass[b2 | (b1 << 8)] / 256, p[i], *pCount);
+                *pCount = 0;
+            }
+        }
+        return crlf;
+    }
+    for ( unsigned int class=0; class<NGRAM_CLASSES; class++ ) {
+        const unsigned int *pCount = &pC->count[class * 256];
+        for ( int c=0; c<256; c++ ) {
+            if ( pCount[c] ) {
+                crlf += addNgramClass(pC, hist, class, c, pCount[c]);
+            }
+        }
+    }
+    memset(pC->count, 0, sizeof(pC->count));
+    return crlf;
+}
+
+/*
+    count a byte into the class of the 2 bytes before it
+    window: the 2 bytes before it in the low 16 bits, byte[-2] | (byte[-1] << 8)
+*/
+#define COUNT_NGRAM_BYTE(window, c) (count[ngramClass[(window) & 0xffff] + (unsigned char)(c)]++)
+
+/*
+    count each byte into the histogram, with the bigrams and the trigrams (--ngram) in the same pass
+    Input:  pLast:  last 2 bytes before the span (the last byte is the prevCr of countCrLf())
+    Output: hist:   histogram (added)
+            pLast:  last 2 bytes of the span
+    return: count of CRLF, same as countCrLf()
+*/
+static unsigned long long countHistogramNgram(const unsigned char *p, size_t len, unsigned long long hist[256],
+                                struct ngramCounter *pC, unsigned int *pLast) {
+    unsigned int *count = pC->count;
+    unsigned int last = *pLast;
+    unsigned long long crlf = 0;
+    while ( len ) {
+        size_t n = MIN(len, MIN((size_t)HISTOGRAM_BLOCK, NGRAM_FLUSH - pC->pending));
+        unsigned long long window = ((last >> 8) & 0xff) | ((last & 0xff) << 8);
+        size_t i = 0;
+        for ( ; i+8<=n; i+=8 ) {
+            unsigned long long w, x;
+            memcpy(&w, p+i, sizeof(w));                 // unaligned 8 bytes load
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+            w = __builtin_bswap64(w);                   // the first byte is the lowest
+#endif
+            x = (w << 16) | window;                     // the 2 bytes before each of the first 6 bytes
+            COUNT_NGRAM_BYTE(x,       x >> 16);
+            COUNT_NGRAM_BYTE(x >>  8, x >> 24);
+            COUNT_NGRAM_BYTE(x >> 16, x >> 32);
+            COUNT_NGRAM_BYTE(x >> 24, x >> 40);
+            COUNT_NGRAM_BYTE(x >> 32, x >> 48);
+            COUNT_NGRAM_BYTE(x >> 40, x >> 56);
+            COUNT_NGRAM_BYTE(w >> 32, w >> 48);
+            COUNT_NGRAM_BYTE(w >> 40, w >> 56);
+            window = w >> 48;
+        }
+        for ( ; i<n; i++ ) {
+            COUNT_NGRAM_BYTE(window, p[i]);
+            window = (window >> 8) | (p[i] << 8);
+        }
+        crlf += flushNgramClass(pC, p, n, last, hist);
+        last = ((window & 0xff) << 8) | (window >> 8);
+        if ( (pC->pending += n) >= NGRAM_FLUSH ) {
+            flushNgramCounter(pC);
+        }
+        p += n;
+        len -= n;
+    }
+    *pLast = last;
+    return crlf;
+}
+
+/*
+    count the bigrams and the trigrams of a span, without the histogram
+*/
+static void countNgram(struct ngramCounter *pC, const unsigned char *p, size_t len, unsigned int *pLast) {
+    unsigned long long hist[256] = { 0 };
+    countHistogramNgram(p, len, hist, pC, pLast);
+}
+
+static void addNgram(struct ngramFrequency *pTotal, const struct ngramFrequency *pN) {
+    for ( unsigned int i=0; i<pN->size; i++ ) {
+        if ( pN->entry[i].count ) {
+            addNgramEntry(pTotal, pN->entry[i].key, pN->entry[i].count);
+        }
+    }
+}
+
+/*
+    n-gram of every books, in the book list order
+*/
+static void sumNgram(struct ngramFrequency *pTotal, struct bookFrequency *pBf, int books) {
+    for ( int i=0; i<books; i++ ) {
+        if ( pBf[i].pNgram ) {
+            addNgram(pTotal, pBf[i].pNgram);
+        }
+    }
+}
+
+/*
+    Word statistics (--words)
+    A word is the letters of isalpha1250(), folded to the lowercase.  (so "don't" is 2 words)
+    The words are counted in an open addressing hash table, the letters of the words are in a bump arena
+    (blocks from WORD_ARENA_FIRST, twice larger up to WORD_ARENA_BLOCK), so a new word does not need malloc().
+    A small book needs only a small table and a small block.  The word in progress is kept in
+    the table for the next span, chunk and --follow.
+    The memory of all the tables is limited by option.wordsMemory.  If a new word can not be stored,
+    it is counted only in the tokens and the letters (average word length), and in unstored.
+    A word longer than WORD_MAX_LEN letters is stored by the first WORD_MAX_LEN letters.
+*/
+#define WORD_MAX_LEN            64
+#define WORD_ARENA_FIRST        (4*1024)            // first block of the arena
+#define WORD_ARENA_BLOCK        (256*1024)          // max block of the arena
+#define WORD_TABLE_MIN          64
+#define WORD_FNV_OFFSET         2166136261u         // FNV-1a
+#define WORD_FNV_PRIME          16777619u
+
+static unsigned char cp1250Lower[256];              // tolower() for CP1250, made by initWords()
+static volatile long wordMemoryKB;                  // memory of all the word tables [KB]
+
+struct wordEntry {
+    const unsigned char *key;                       // letters in the arena.  NULL: empty entry
+    unsigned int hash;
+    unsigned int len;
+    unsigned long long count;
+};
+
+struct wordArenaBlock {
+    struct wordArenaBlock *pNext;
+    size_t used;
+    size_t size;
+    unsigned char data[];
+};
+
+struct wordFrequency {
+    struct wordEntry *entry;                        // hash table
+    unsigned int size;                              // size of the hash table (power of 2)
+    unsigned int entries;                           // number of the different words = vocabulary
+    struct wordArenaBlock *pArena;                  // the newest block first
+    size_t memory;                                  // bytes of the table and the arena
+    unsigned long long tokens;                      // count of the words
+    unsigned long long letters;                     // count of the letters in the words
+    unsigned long long unstored;                    // count of the words which were not stored (memory limit)
+    unsigned char word[WORD_MAX_LEN];               // word in progress (lowercase)
+    unsigned long long wordLetters;                 // letters of the word in progress.  0: not in a word
+    unsigned int wordHash;                          // hash of the word in progress
+};
+
+static void initWords() {
+    for ( int c=0; c<256; c++ ) {
+        cp1250Lower[c] = c;
+    }
+    for ( int c=255; c>=0; c-- ) {                  // Š(8a) and š(9a):  the lowercase is the larger code
+        if ( toupper1250(c) != c ) {
+            cp1250Lower[toupper1250(c)] = c;
+        }
+    }
+}
+
+/*
+    reserve the memory for the word tables
+    return: false if over option.wordsMemory
+*/
+static int reserveWordMemory(struct wordFrequency *pW, size_t bytes) {
+    long kb = (long)((bytes + 1023) / 1024);
+    if ( atomicFetchAdd(&wordMemoryKB, kb) + kb > (long)option.wordsMemory * 1024 ) {
+        atomicFetchAdd(&wordMemoryKB, -kb);
+        return false;
+    }
+    pW->memory += (size_t)kb * 1024;
+    return true;
+}
+
+static struct wordFrequency *newWords() {
+    struct wordFrequency *pW = calloc(1, sizeof(struct wordFrequency));
+    if ( pW == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+    }
+    return pW;
+}
+
+static void clearWords(struct wordFrequency *pW) {
+    while ( pW->pArena ) {
+        struct wordArenaBlock *pNext = pW->pArena->pNext;
+        free(pW->pArena);
+        pW->pArena = pNext;
+    }
+    free(pW->entry);
+    atomicFetchAdd(&wordMemoryKB, -(long)(pW->memory / 1024));
+    memset(pW, 0, sizeof(*pW));
+}
+
+static void freeWords(struct wordFrequency *pW) {
+    if ( pW ) {
+        clearWords(pW);
+        free(pW);
+    }
+}
+
+static const unsigned char *wordArenaCopy(struct wordFrequency *pW, const unsigned char *word, unsigned int len) {
+    unsigned char *pKey;
+    if ( pW->pArena == NULL || pW->pArena->used + len > pW->pArena->size ) {
+        struct wordArenaBlock *pBlock;
+        size_t size = pW->pArena ? MIN(pW->pArena->size*2, WORD_ARENA_BLOCK): WORD_ARENA_FIRST;
+        if ( !reserveWordMemory(pW, sizeof(struct wordArenaBlock) + size) ) {
+            return NULL;
+        }
+        if ( (pBlock = malloc(sizeof(struct wordArenaBlock) + size)) == NULL ) {
+            return NULL;
+        }
+        pBlock->pNext = pW->pArena;
+        pBlock->used = 0;
+        pBlock->size = size;
+        pW->pArena = pBlock;
+    }
+    pKey = &pW->pArena->data[pW->pArena->used];
+    memcpy(pKey, word, len);
+    pW->pArena->used += len;
+    return pKey;
+}
+
+static int growWordTable(struct wordFrequency *pW) {
+    unsigned int newSize = pW->size ? pW->size*2: WORD_TABLE_MIN;
+    struct wordEntry *pNew;
+    if ( !reserveWordMemory(pW, sizeof(struct wordEntry) * (size_t)newSize) ) {
+        return false;
+    }
+    if ( (pNew = calloc(newSize, sizeof(struct wordEntry))) == NULL ) {
+        return false;
+    }
+    for ( unsigned int i=0; i<pW->size; i++ ) {     // the keys stay in the arena
+        if ( pW->entry[i].key ) {
+            unsigned int h = pW->entry[i].hash & (newSize-1);
+            while ( pNew[h].key ) {
+                h = (h+1) & (newSize-1);
+            }
+            pNew[h] = pW->entry[i];
+        }
+    }
+    if ( pW->entry ) {
+        free(pW->entry);
+        atomicFetchAdd(&wordMemoryKB, -(long)(sizeof(struct wordEntry) * (size_t)pW->size / 1024));
+        pW->memory -= sizeof(struct wordEntry) * (size_t)pW->size / 1024 * 1024;
+    }
+    pW->entry = pNew;
+    pW->size = newSize;
+    return true;
+}
+
+/*
+    add a word to the table
+    return: false if the word can not be stored
+*/
+static int addWord(struct wordFrequency *pW, const unsigned char *word, unsigned int len, unsigned int hash, unsigned long long count) {
+    unsigned int h;
+    if ( (pW->entries+1) * 10 > pW->size * 7 ) {
+        growWordTable(pW);                          // over the memory limit: the table stays, up to 90%
+    }
+    if ( pW->size == 0 ) {
+        pW->unstored += count;
+        return false;
+    }
+    for ( h = hash & (pW->size-1); pW->entry[h].key; h = (h+1) & (pW->size-1) ) {
+        if ( pW->entry[h].hash == hash && pW->entry[h].len == len && memcmp(pW->entry[h].key, word, len) == 0 ) {
+            pW->entry[h].count += count;            // known words are always counted
+            return true;
+        }
+    }
+    if ( (pW->entries+1) * 10 > pW->size * 9 || (pW->entry[h].key = wordArenaCopy(pW, word, len)) == NULL ) {
+        pW->unstored += count;
+        return false;
+    }
+    pW->entry[h].hash = hash;
+    pW->entry[h].len = len;
+    pW->entry[h].count = count;
+    pW->entries++;
+    return true;
+}
+
+static void endWord(struct wordFrequency *pW) {
+    pW->tokens++;
+    pW->letters += pW->wordLetters;
+    addWord(pW, pW->word, (unsigned int)MIN(pW->wordLetters, WORD_MAX_LEN), pW->wordHash, 1);
+    pW->wordLetters = 0;
+}
+
+/*
+    count the words of a span.  the word at the end of the span is kept for the next span.
+*/
+static void countWords(struct wordFrequency *pW, const unsigned char *p, size_t len) {
+    const unsigned char *end = p + len;
+    for ( ; p < end; p++ ) {
+        if ( cp1250Class[*p] & CP1250_ALPHA ) {
+            if ( pW->wordLetters == 0 ) {
+                pW->wordHash = WORD_FNV_OFFSET;
+            }
+            if ( pW->wordLetters < WORD_MAX_LEN ) {
+                unsigned char c = cp1250Lower[*p];
+                pW->word[pW->wordLetters] = c;
+                pW->wordHash = (pW->wordHash ^ c) * WORD_FNV_PRIME;
+            }
+            pW->wordLetters++;
+        } else if ( pW->wordLetters ) {
+            endWord(pW);
+        }
+    }
+}
+
+/*
+    count the words of a chunk.  a chunk has the words which start in it.
+    Input:  skipFirst:  the letter before the chunk is a letter (the first word is in the previous chunk)
+            spanEnd:    end of the span.  the last word is read until its end, in the next chunk.
+*/
+static void countWordsInChunk(struct wordFrequency *pW, const unsigned char *p, size_t len, const unsigned char *spanEnd, bool skipFirst) {
+    const unsigned char *end = p + len;
+    const unsigned char *q = end;
+    if ( skipFirst ) {
+        while ( p < end && (cp1250Class[*p] & CP1250_ALPHA) ) {
+            p++;
+        }
+    }
+    countWords(pW, p, end - p);
+    if ( pW->wordLetters ) {
+        while ( q < spanEnd && (cp1250Class[*q] & CP1250_ALPHA) ) {
+            q++;
+        }
+        countWords(pW, end, q - end);
+        if ( q < spanEnd ) {
+            endWord(pW);
+        }
+    }
+}
+
+/*
+    add the words of a table to the other table.  (the word in progress is not added)
+*/
+static void addWords(struct wordFrequency *pTotal, const struct wordFrequency *pW) {
+    for ( unsigned int i=0; i<pW->size; i++ ) {
+        if ( pW->entry[i].key ) {
+            addWord(pTotal, pW->entry[i].key, pW->entry[i].len, pW->entry[i].hash, pW->entry[i].count);
+        }
+    }
+    pTotal->tokens += pW->tokens;
+    pTotal->letters += pW->letters;
+    pTotal->unstored += pW->unstored;
+}
+
+/*
+    words of every books, in the book list order
+    the first book is not copied, the grand total is made by adding every book
+    the words are added to the grand total (stream mode adds every batch), clearWords() makes it empty
+*/
+static void sumWords(struct totalFrequency *pGt, struct bookFrequency *pBf, int books) {
+    for ( int i=0; i<books; i++ ) {
+        if ( pBf[i].pWords ) {
+            addWords(pGt->pWords, pBf[i].pWords);
+        }
+    }
+    pGt->lf.lettersPerWord = pGt->pWords->tokens ? (double)pGt->pWords->letters / pGt->pWords->tokens: 0.;
+}
+
+/*
+    Book list ingestion
+    The book titles are read in one pass from the sources of the command line, or from BOOKLIST without a source.
+        book list file  --list FILE, "-" is stdin.  one title in a line, '#' is a comment
+        file            the file is a book
+        directory       every file in the directory and its sub directories, in the name order
+        glob pattern    every file (or directory) which matches the pattern, e.g. "*.txt"
+    Each title is given to addBook() when it is found, the number of the books is not needed in advance.
+    The titles are in a bump arena (blocks of TITLE_ARENA_BLOCK), not malloc() for each title.
+    Stream mode (without --cache, --follow, --optimize):  every pT->batch books are counted and printed by
+    pT->flush(), then the table is used again for the next books.  So the memory does not depend on the number
+    of the books.  Other mode:  the table becomes larger, the books are counted after all the titles are read.
+    --compact:  see packBookTable()
+*/
+#define TITLE_ARENA_BLOCK   (64*1024)               // size of a block of the title arena
+#define BOOK_BATCH          1024                    // stream mode:  books counted and printed at once
+#define COMPACT_BATCH       4                       // --compact:  books for each thread, counted and printed at once
+#define LINE_BUFFER_MIN     512                     // first size of the line buffer, it becomes larger for a long line
+#if defined(_WIN32) || defined(_WIN64)
+#   define PATH_SEPARATOR   "\\"
+#else
+#   define PATH_SEPARATOR   "/"
+#endif
+
+struct titleArenaBlock {
+    struct titleArenaBlock *pNext;
+    size_t used;
+    size_t size;
+    char data[];
+};
+
+struct packedBook {                                 // --compact --optimize:  a counted book, see packBookTable()
+    char *bookTitle;
+    unsigned long long bytes;
+    double lettersPerWord;
+    struct wordFrequency *pWords;                   // --words:  the words of the book are kept to be printed
+    unsigned short distinct;                        // number of the different bytes
+    unsigned short spills;                          // number of the 64 bits counters
+    unsigned char data[];                           // byte[distinct], u32 count[distinct], u64 spill[spills] (memcpy)
+};
+
+struct bookTable {
+    struct bookFrequency *pBf;                      // books in the table
+    int books;                                      // number of the books in the table
+    int capacity;                                   // number of the bookFrequency in pBf
+    bool stream;                                    // true: count and print every batch books, then use the table again
+    int batch;                                      // stream mode:  books counted at once
+    void (*flush)(struct bookTable *pT);            // stream mode:  count and print (or pack) the books in the table
+    struct titleArenaBlock *pArena;                 // the titles of the books (and the packed books)
+    struct packedBook **ppPacked;                   // --compact --optimize:  the counted books, in the book list order
+    int packed;                                     // number of the packed books
+    int packedCapacity;
+    unsigned long long titles;                      // --shard:  titles of every shard, the position in the book list
+};
+
+/*
+    Initialize Letter Frequency table for a book.
+    Input:  pointer of totalFrequency.  NULL: no total
+            pointer of the top of bookFrequency table[]
+            books:  number of books
+    Ouput:  TotalFrequeny Table
+            bookFrequeny Table
+*/
+static void step02_initializeLf(struct totalFrequency *pGt, struct bookFrequency *pBf, int books) {
+    if ( pGt ) {
+        memset(pGt, 0, sizeof(*pGt));
+        for (int i=0; i<sizeof(pGt->lf.sortIdx)/sizeof(pGt->lf.sortIdx[0]); i++) {
+            pGt->lf.sortIdx[i] = i;             // initialize sort index
+        }
+    }
+    memset(pBf, 0, sizeof(struct bookFrequency)*books);
+    for (int i=0; i<books; i++) {
+        for (int j=0; j<sizeof(pBf->lf.sortIdx)/sizeof(pBf->lf.sortIdx[0]); j++) {
+            pBf[i].lf.sortIdx[j] = j;       // initialize sort index
+        }
+        pBf[i].encoding = option.encoding;
+    }
+}
+
+/*
+    allocate from the arena.  align:  power of 2
+*/
+static void *arenaAlloc(struct bookTable *pT, size_t len, size_t align) {
+    struct titleArenaBlock *pB = pT->pArena;
+    size_t used = pB ? (pB->used + align-1) & ~(align-1): 0;
+    if ( pB == NULL || used + len > pB->size ) {
+        size_t size = MAX(TITLE_ARENA_BLOCK, len);
+        if ( (pB = malloc(sizeof(struct titleArenaBlock) + size)) == NULL ) {
+            return NULL;
+        }
+        pB->pNext = pT->pArena;
+        pB->size = size;
+        pT->pArena = pB;
+        used = 0;                                   // malloc() is aligned
+    }
+    pB->used = used + len;
+    return pB->data + used;
+}
+
+/*
+    copy the title to the arena
+*/
+static char *titleArenaCopy(struct bookTable *pT, const char *title) {
+    size_t len = strlen(title) + 1;
+    char *p = arenaAlloc(pT, len, 1);
+    if ( p ) {
+        memcpy(p, title, len);
+    }
+    return p;
+}
+
+/*
+    free the title arena.  keepOne:  the newest block is kept and used again
+*/
+static void titleArenaFree(struct bookTable *pT, bool keepOne) {
+    struct titleArenaBlock *pB = pT->pArena;
+    if ( keepOne && pB ) {
+        pB->used = 0;
+        pB = pB->pNext;
+        pT->pArena->pNext = NULL;
+    } else {
+        pT->pArena = NULL;
+    }
+    while ( pB ) {
+        struct titleArenaBlock *pNext = pB->pNext;
+        free(pB);
+        pB = pNext;
+    }
+}
+
+/*
+    add a book to the table.  stream mode:  the full table is counted and printed before.
+    return: false if no memory
+*/
+static int addBook(struct bookTable *pT, const char *title) {
+    struct bookFrequency *pBf;
+    struct ngramFrequency *pNgram;
+    struct wordFrequency *pWords;
+    struct sampleFrequency *pSample;
+    if ( option.shards > 1 && pT->titles++ % option.shards != option.shard - 1 ) {
+        return true;                                // --shard:  a book of the other shard, not opened
+    }
+    if ( pT->stream && pT->books == pT->batch ) {
+        pT->flush(pT);
+    }
+    if ( pT->books == pT->capacity ) {
+        int capacity = pT->capacity ? pT->capacity*2: (pT->stream ? pT->batch: BOOK_BATCH);
+        struct bookFrequency *pNew = realloc(pT->pBf, sizeof(struct bookFrequency)*capacity);
+        if ( pNew == NULL ) {
+            fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+            return false;
+        }
+        memset(pNew + pT->capacity, 0, sizeof(struct bookFrequency)*(capacity - pT->capacity));
+        pT->pBf = pNew;
+        pT->capacity = capacity;
+    }
+    pBf = &pT->pBf[pT->books];
+    pNgram = pBf->pNgram;                           // stream mode:  the tables of the previous book are used again
+    pWords = pBf->pWords;
+    pSample = pBf->pSample;
+    if ( strchr(title, '!') && !option.merge && !option.query ) {
+        archiveOpenForTitle(title);                 // "archive!member"
+    }
+    step02_initializeLf(NULL, pBf, 1);
+    if ( (pBf->bookTitle = titleArenaCopy(pT, title)) == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        return false;
+    }
+    if ( grandTotal.pNgram ) {
+        if ( pNgram ) {
+            clearNgram(pNgram);
+        }
+        pBf->pNgram = pNgram ? pNgram: newNgram();  // n-gram of each book (NULL: no memory, not counted)
+    }
+    if ( grandTotal.pWords ) {
+        if ( pWords ) {
+            clearWords(pWords);
+        }
+        pBf->pWords = pWords ? pWords: newWords();  // words of each book (NULL: no memory, not counted)
+    }
+    if ( option.sample > 0. ) {
+        pBf->pSample = pSample ? pSample: malloc(sizeof(struct sampleFrequency));   // NULL: no memory, counted fully
+        if ( pBf->pSample ) {
+            memset(pBf->pSample, 0, sizeof(struct sampleFrequency));
+        }
+    }
+    pT->books++;
+    return true;
+}
+
+/*
+    read a line of any length.  the buffer becomes larger for a long line.
+    return: false at the end of the file
+*/
+static int readLine(FILE *spIn, char **ppBuf, size_t *pSize) {
+    size_t len = 0;
+    if ( *ppBuf == NULL ) {
+        if ( (*ppBuf = malloc(LINE_BUFFER_MIN)) == NULL ) {
+            return false;
+        }
+        *pSize = LINE_BUFFER_MIN;
+    }
+    while ( fgets(*ppBuf + len, (int)MIN(*pSize - len, INT_MAX), spIn) ) {
+        char *pNew;
+        len += strlen(*ppBuf + len);
+        if ( len && (*ppBuf)[len-1] == '\n' ) {
+            return true;
+        }
+        if ( len + 1 < *pSize ) {
+            continue;                               // the last line without '\n', fgets() returns NULL next time
+        }
+        if ( (pNew = realloc(*ppBuf, *pSize*2)) == NULL ) {
+            return true;                            // no memory, the line is cut
+        }
+        *ppBuf = pNew;
+        *pSize *= 2;
+    }
+    return len > 0;
+}
+
+/*
+    add every member of the archive as "archive!member", in the archive order
+    return: number of the books
+*/
+static int readBookArchive(char *name, struct bookTable *pT) {
+    struct archive *pA = archiveOpen(name, strlen(name));
+    char *title = NULL;
+    size_t size = 0;
+    int books = 0;
+    if ( pA == NULL ) {
+        return 0;
+    }
+    for ( int i=0; i<pA->members; i++ ) {
+        const char *member = pA->names + pA->member[i].name;
+        size_t len = strlen(name) + 1 + strlen(member) + 1;
+        if ( len > size ) {
+            char *pNew = realloc(title, len);
+            if ( pNew == NULL ) {
+                fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+                break;
+            }
+            title = pNew;
+            size = len;
+        }
+        sprintf(title, "%s!%s", name, member);
+        if ( !addBook(pT, title) ) {
+            break;
+        }
+        books++;
+    }
+    free(title);
+    return books;
+}
+
+/*
+    add a file.  an archive (.tar, .zip) is all its members.
+    return: number of the books
+*/
+static int readBookFile(char *name, struct bookTable *pT) {
+    if ( isArchiveName(name, strlen(name)) ) {
+        return readBookArchive(name, pT);
+    }
+    return addBook(pT, name) ? 1: 0;                // the file which can not be read is reported when it is counted
+}
+
+/*
+    read the book title from the book list.
+    Input:  inFName:    file name of the book list.  "-" is stdin
+            pT:         table of the books
+    return: number of the books in the book list
+*/
+static int readBookListFile(char *inFName, struct bookTable *pT) {
+    FILE *spIn = strcmp(inFName, "-") == 0 ? stdin: fopen(inFName, "r");
+    char *linebuf = NULL;
+    size_t size = 0;
+    int books = 0;
+
+    if ( spIn == NULL ) {
+        fprintf(stderr, "***Error line %d:  file read open error:  %s\n", __LINE__, inFName);
+        return 0;
+    }
+    for (int i=0; readLine(spIn, &linebuf, &size); i++) {
+        char *trimLine = trim(linebuf);
+        if ( i == 0 && strncmp(trimLine, BOM_UTF8, strlen(BOM_UTF8)) == 0 ) {
+            trimLine = ltrim(trimLine + strlen(BOM_UTF8));
+        }
+        if ( *trimLine != '\0' && *trimLine!=COMMENTSYMBOL ) {
+            if ( isArchiveName(trimLine, strlen(trimLine)) ) {
+                books += readBookArchive(trimLine, pT);
+            } else if ( !addBook(pT, trimLine) ) {
+                break;
+            } else {
+                books++;
+            }
+        }
+    }
+    free(linebuf);
+    if ( spIn != stdin ) {
+        fclose(spIn);
+    }
+    return books;
+}
+
+/*
+    the files of this program are not the books in a directory
+*/
+static int isProgramFile(const char *name) {
+    return name[0] == '.' || strcmp(name, BOOKLIST) == 0 || strcmp(name, CACHEFILE) == 0
+        || strncmp(name, PROGNAME "Part", strlen(PROGNAME "Part")) == 0                 // partial result of --shard
+        || (strncmp(name, BENCH_DIR, strlen(BENCH_DIR)) == 0 && name[strlen(BENCH_DIR)] == '.')   // hlfc bench
+        || (strlen(name) > strlen(INDEX_EXT) && strcmp(name + strlen(name) - strlen(INDEX_EXT), INDEX_EXT) == 0)  // --index
+        || strncmp(name, PROGNAME "Result.", strlen(PROGNAME "Result.")) == 0;  // every --format, with ".tmp" of --follow
+}
+
+static int compareTitle(const void *a, const void *b) {
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/*
+    add every file in the directory and its sub directories, in the name order
+    a symbolic link to a directory is not followed (no loop)
+    return: number of the books
+*/
+static int readBookDir(char *dir, struct bookTable *pT) {
+    char **names = NULL;                            // names in this directory
+    int numOfNames = 0, capacity = 0;
+    int books = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    WIN32_FIND_DATAW find;
+    wchar_t WCpattern[512];
+    char *pattern = malloc(strlen(dir) + 3);
+    HANDLE h;
+    if ( pattern == NULL ) {
+        return 0;
+    }
+    sprintf(pattern, "%s" PATH_SEPARATOR "*", dir);
+    MultiByteToWideChar(CP_UTF8, 0, pattern, -1, WCpattern, sizeof(WCpattern)/sizeof(WCpattern[0]));   // convert UTF-8 string to wchar_t
+    h = FindFirstFileW(WCpattern, &find);
+    free(pattern);
+    if ( h == INVALID_HANDLE_VALUE ) {
+        fprintf(stderr, "***Error line %d:  directory read error:  %s\n", __LINE__, dir);
+        return 0;
+    }
+    do {
+        char name[MAX_PATH*3];                      // a UTF-16 unit is at most 3 bytes in UTF-8
+        WideCharToMultiByte(CP_UTF8, 0, find.cFileName, -1, name, sizeof(name), NULL, NULL);
+        if ( (find.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) && (find.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ) {
+            continue;
+        }
+#else
+    DIR *pDir = opendir(dir);
+    struct dirent *pEnt;
+    if ( pDir == NULL ) {
+        fprintf(stderr, "***Error line %d:  directory read error:  %s\n", __LINE__, dir);
+        return 0;
+    }
+    while ( (pEnt = readdir(pDir)) != NULL ) {
+        char *name = pEnt->d_name;
+#endif
+        char *path;
+        if ( isProgramFile(name) ) {                // also "." and ".."
+            continue;
+        }
+        if ( numOfNames == capacity ) {
+            char **pNew = realloc(names, sizeof(char *) * (capacity = capacity ? capacity*2: 64));
+            if ( pNew == NULL ) {
+                break;
+            }
+            names = pNew;
+        }
+        if ( (path = malloc(strlen(dir) + strlen(name) + 2)) == NULL ) {
+            break;
+        }
+        sprintf(path, "%s" PATH_SEPARATOR "%s", dir, name);
+        names[numOfNames++] = path;
+#if defined(_WIN32) || defined(_WIN64)
+    } while ( FindNextFileW(h, &find) );
+    FindClose(h);
+#else
+    }
+    closedir(pDir);
+#endif
+    qsort(names, numOfNames, sizeof(names[0]), compareTitle);
+    for ( int i=0; i<numOfNames; i++ ) {
+#if defined(_WIN32) || defined(_WIN64)
+        DWORD attr = getFileAttributesUtf8(names[i]);
+        bool isDir = attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY);
+        bool isFile = attr != INVALID_FILE_ATTRIBUTES && !isDir;
+#else
+        struct stat st;
+        bool isDir = lstat(names[i], &st) == 0 && S_ISDIR(st.st_mode);
+        bool isFile = !isDir && stat(names[i], &st) == 0 && S_ISREG(st.st_mode);
+#endif
+        if ( isDir ) {
+            books += readBookDir(names[i], pT);
+        } else if ( isFile ) {
+            books += readBookFile(names[i], pT);
+        }
+        free(names[i]);
+    }
+    free(names);
+    return books;
+}
+
+/*
+    add a file, a directory or the files of a glob pattern
+    return: number of the books
+*/
+static int readBookSource(char *name, struct bookTable *pT) {
+    int books = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    DWORD attr;
+    if ( strpbrk(name, "*?") ) {
+        WIN32_FIND_DATAW find;
+        wchar_t WCname[512];
+        HANDLE h;
+        int dirLen = 0;                             // the directory of the pattern
+        MultiByteToWideChar(CP_UTF8, 0, name, -1, WCname, sizeof(WCname)/sizeof(WCname[0]));    // convert UTF-8 string to wchar_t
+        h = FindFirstFileW(WCname, &find);
+        for ( int i=0; name[i]; i++ ) {
+            if ( name[i] == '\\' || name[i] == '/' ) {
+                dirLen = i + 1;
+            }
+        }
+        if ( h == INVALID_HANDLE_VALUE ) {
+            fprintf(stderr, "***Error line %d:  no file matches:  %s\n", __LINE__, name);
+            return 0;
+        }
+        do {
+            char fileName[MAX_PATH*3];              // a UTF-16 unit is at most 3 bytes in UTF-8
+            char *path;
+            WideCharToMultiByte(CP_UTF8, 0, find.cFileName, -1, fileName, sizeof(fileName), NULL, NULL);
+            if ( (path = malloc(dirLen + strlen(fileName) + 1)) == NULL ) {
+                break;
+            }
+            sprintf(path, "%.*s%s", dirLen, name, fileName);
+            if ( strcmp(fileName, ".") && strcmp(fileName, "..") ) {
+                books += readBookSource(path, pT);
+            }
+            free(path);
+        } while ( FindNextFileW(h, &find) );
+        FindClose(h);
+        return books;
+    }
+    attr = getFileAttributesUtf8(name);
+    if ( attr != INVALID_FILE_ATTRIBUTES && (attr & FILE_ATTRIBUTE_DIRECTORY) ) {
+        return readBookDir(name, pT);
+    }
+#else
+    struct stat st;
+    if ( strpbrk(name, "*?[") && stat(name, &st) != 0 ) {  // a file name can have '[' too
+        glob_t g;
+        if ( glob(name, 0, NULL, &g) != 0 ) {
+            fprintf(stderr, "***Error line %d:  no file matches:  %s\n", __LINE__, name);
+            return 0;
+        }
+        for ( size_t i=0; i<g.gl_pathc; i++ ) {
+            books += readBookSource(g.gl_pathv[i], pT);
+        }
+        globfree(&g);
+        return books;
+    }
+    if ( stat(name, &st) == 0 && S_ISDIR(st.st_mode) ) {
+        return readBookDir(name, pT);
+    }
+#endif
+    return readBookFile(name, pT);
+}
+
+/*
+    read the book titles from all the sources (BOOKLIST without a source)
+    Input:  pT:     table of the books.  pT->stream and pT->flush are set by the caller
+    return: number of the books
+*/
+static int step03_readBookList(struct bookTable *pT) {
+    grandTotal.books = 0;
+    if ( option.numOfSources == 0 ) {
+        grandTotal.books = readBookListFile(BOOKLIST, pT);
+    }
+    for ( int i=0; i<option.numOfSources; i++ ) {
+        if ( option.sources[i].list ) {
+            grandTotal.books += readBookListFile(option.sources[i].name, pT);
+        } else {
+            grandTotal.books += readBookSource(option.sources[i].name, pT);
+        }
+    }
+    if ( option.shards > 1 ) {                      // the titles of the other shards are not the books of this process
+        grandTotal.books = (int)(pT->titles / option.shards + (option.shard - 1 < (int)(pT->titles % option.shards)));
+    }
+    return grandTotal.books;
+}
+
+/*
+    memory free for 03_readBookList
+*/
+static void terminate03_readBookList(struct bookTable *pT) {
+    for ( int i=0; i<pT->capacity; i++ ) {
+        freeNgram(pT->pBf[i].pNgram);
+        freeWords(pT->pBf[i].pWords);
+        free(pT->pBf[i].pSample);
+    }
+    for ( int i=0; i<pT->packed; i++ ) {
+        freeWords(pT->ppPacked[i]->pWords);
+    }
+    free(pT->ppPacked);
+    free(pT->pBf);
+    titleArenaFree(pT, false);
+    memset(pT, 0, sizeof(*pT));
+    freeArchives();                                 // the members are read until the end (also --follow)
+}
+
+/*
+    Chunk parallel counting
+    a large span is split into byte range chunks, counted by the threads, then added to the histogram of the book.
+    Each chunk knows the letter before it, so CRLF across the chunks is counted only once.  The result is the same
+    as the serial count.
+*/
+#define CHUNK_PARALLEL_MIN      (16*1024*1024)      // smaller span is counted by one thread
+#define CHUNK_ALIGN             4096                // chunk boundary (page size)
+#define CHUNK_BOOK_MIN          (64*1024*1024)      // -j N: larger book is counted by chunks with N threads
+
+struct chunkWorker {
+    threadHandle thread;
+    const unsigned char *p;                         // top of the chunk
+    size_t len;                                     // length of the chunk
+    bool prevCr;                                    // the letter before the chunk was '\r'
+    unsigned long long raw[256];                    // histogram of the chunk
+    unsigned long long crlf;                        // count of CRLF in the chunk
+    struct contentHash *pHash;                      // NULL: no hash
+    struct contentHash hash;                        // content hash of the chunk
+    struct ngramCounter *pNgram;                    // --ngram:  n-gram counters of the chunk.  NULL: no n-gram
+    unsigned int last;                              // --ngram:  the 2 letters before the chunk
+    struct wordFrequency *pWords;                   // --words:  words of the chunk.  NULL: no word statistics
+    const unsigned char *spanEnd;                   // --words:  the last word of the chunk is read until here
+    bool inWord;                                    // --words:  the chunk starts in a word of the previous chunk
+};
+
+static void *chunkWorkerMain(void *arg) {
+    struct chunkWorker *pW = arg;
+    if ( pW->pNgram ) {
+        pW->crlf = countHistogramNgram(pW->p, pW->len, pW->raw, pW->pNgram, &pW->last);
+    } else {
+        countHistogram(pW->p, pW->len, pW->raw);
+        pW->crlf = countCrLf(pW->p, pW->len, &pW->prevCr);
+    }
+    if ( pW->pHash ) {
+        hashUpdate(&pW->hash, pW->p, pW->len);
+    }
+    if ( pW->pWords ) {
+        countWordsInChunk(pW->pWords, pW->p, pW->len, pW->spanEnd, pW->inWord);
+    }
+    return NULL;
+}
+
+/*
+    count a span by the threads
+    Input:  p, len: span
+            prevCr: the letter before the span was '\r'
+            jobs:   number of threads (including this thread)
+    Output: raw:    histogram (added)
+            pHash:  content hash (updated).  NULL: no hash
+            pNgram: n-gram counters (added), pLast: the 2 letters before/after the span.  NULL: no n-gram
+            pWords: words (added).  NULL: no word statistics
+    return: count of CRLF
+*/
+static unsigned long long countSpanParallel(const unsigned char *p, size_t len, bool prevCr, int jobs, unsigned long long raw[256],
+                                    struct contentHash *pHash, struct ngramCounter *pNgram, unsigned int *pLast,
+                                    struct wordFrequency *pWords) {
+    struct chunkWorker *pWorker;
+    unsigned long long crlf = 0;
+    size_t chunkLen;
+    size_t pos = 0;
+
+    jobs = (int)MIN((size_t)jobs, len / (CHUNK_PARALLEL_MIN / 4));  // at least 4MB for a chunk
+    if ( jobs <= 1 || (pHash && pHash->tailLen) || (pWorker = calloc(jobs, sizeof(struct chunkWorker))) == NULL ) {
+        if ( pNgram ) {
+            crlf = countHistogramNgram(p, len, raw, pNgram, pLast);
+        } else {
+            countHistogram(p, len, raw);
+            crlf = countCrLf(p, len, &prevCr);
+        }
+        if ( pHash ) {
+            hashUpdate(pHash, p, len);
+        }
+        if ( pWords ) {
+            countWords(pWords, p, len);
+        }
+        return crlf;
+    }
+    chunkLen = (len / jobs + CHUNK_ALIGN - 1) & ~(size_t)(CHUNK_ALIGN - 1);
+    for ( int i=0; i<jobs; i++ ) {
+        pWorker[i].p = p + pos;
+        pWorker[i].len = MIN(chunkLen, len - pos);
+        pWorker[i].prevCr = (pos == 0) ? prevCr: (p[pos-1] == '\r');
+        pWorker[i].pHash = pHash;
+        if ( pHash ) {
+            hashInit(&pWorker[i].hash, pHash->length + pos);
+        }
+        if ( pNgram ) {                             // chunk[0] uses the counters of the caller, the others have their own n-gram
+            struct ngramFrequency *pChunkNgram = (i == 0) ? NULL: newNgram();
+            pWorker[i].pNgram = (i == 0) ? pNgram: (pChunkNgram ? takeNgramCounter(pChunkNgram): NULL);
+            if ( i > 0 && pWorker[i].pNgram == NULL ) {
+                freeNgram(pChunkNgram);
+            }
+            pWorker[i].last = (pos == 0) ? *pLast: (p[pos-2] << 8) | p[pos-1];
+        }
+        if ( pWords ) {                             // chunk[0] uses the words of the caller (with the word in progress)
+            pWorker[i].pWords = (i == 0) ? pWords: newWords();
+            pWorker[i].spanEnd = p + len;
+            pWorker[i].inWord = (i > 0) && (cp1250Class[p[pos-1]] & CP1250_ALPHA);
+        }
+        pos += pWorker[i].len;
+    }
+    for ( int i=1; i<jobs; i++ ) {                  // chunk[0] is counted by this thread
+        if ( pWorker[i].len && !threadCreate(&pWorker[i].thread, chunkWorkerMain, &pWorker[i]) ) {
+            chunkWorkerMain(&pWorker[i]);           // no thread, count by this thread
+        }
+    }
+    chunkWorkerMain(&pWorker[0]);
+    for ( int i=0; i<jobs; i++ ) {                  // reduce in the chunk order
+        if ( pWorker[i].thread ) {
+            threadJoin(pWorker[i].thread);
+        }
+        for ( int c=0; c<256; c++ ) {
+            raw[c] += pWorker[i].raw[c];
+        }
+        crlf += pWorker[i].crlf;
+        if ( pHash && pWorker[i].len ) {
+            unsigned long long sum = pHash->sum;
+            *pHash = pWorker[i].hash;               // tail and length of the last chunk
+            pHash->sum += sum;
+        }
+        if ( pNgram && i > 0 && pWorker[i].pNgram == NULL ) {     // no memory for the counters, count it here
+            countNgram(pNgram, pWorker[i].p, pWorker[i].len, &pWorker[i].last);
+        } else if ( pNgram && i > 0 ) {
+            flushNgramCounter(pWorker[i].pNgram);
+            addNgram(pNgram->pTarget, pWorker[i].pNgram->pTarget);
+            freeNgram(pWorker[i].pNgram->pTarget);
+            giveNgramCounter(pWorker[i].pNgram);
+        }
+        if ( pWords && i > 0 && pWorker[i].pWords == NULL ) {  // no memory for the words, count it here
+            countWordsInChunk(pWords, pWorker[i].p, pWorker[i].len, p + len, cp1250Class[pWorker[i].p[-1]] & CP1250_ALPHA);
+        } else if ( pWords && i > 0 ) {
+            struct wordFrequency *pChunk = pWorker[i].pWords;
+            addWords(pWords, pChunk);
+            if ( pChunk->wordLetters ) {            // the word at the end of the span, for the next span
+                memcpy(pWords->word, pChunk->word, sizeof(pWords->word));
+                pWords->wordLetters = pChunk->wordLetters;
+                pWords->wordHash = pChunk->wordHash;
+            }
+            freeWords(pChunk);
+        }
+    }
+    if ( pNgram ) {
+        *pLast = (p[len-2] << 8) | p[len-1];
+    }
+    free(pWorker);
+    return crlf;
+}
+
+/*
+    forget the count of the book, to count it again from the top
+*/
+static void resetBookFrequency(struct bookFrequency *pBf) {
+    memset(pBf->lf.raw, 0, sizeof(pBf->lf.raw));
+    pBf->offset = pBf->bytes = 0;
+    pBf->encoding = option.encoding;                // the new content may have the other encoding
+    if ( pBf->pNgram ) {
+        clearNgram(pBf->pNgram);
+    }
+    if ( pBf->pWords ) {
+        clearWords(pBf->pWords);
+    }
+}
+
+/*
+    count the CP1250 letters of a span:  histogram, CRLF, content hash, n-gram and words
+    pPrevCr:    [in/out] the last letter of the previous span was '\r'
+    return: count of CRLF
+*/
+static unsigned long long countLetters(struct bookFrequency *pBf, const unsigned char *span, size_t len, bool *pPrevCr, int jobs,
+                                       struct contentHash *pHash, struct ngramCounter *pNgram) {
+    unsigned long long crlf;
+    if ( jobs > 1 && len >= CHUNK_PARALLEL_MIN ) {                              // count each byte by the threads
+        crlf = countSpanParallel(span, len, *pPrevCr, jobs, pBf->lf.raw, pHash,
+                                 pNgram, pBf->pNgram ? &pBf->pNgram->last: NULL, pBf->pWords);
+        *pPrevCr = (span[len-1] == '\r');
+        return crlf;
+    }
+    if ( pNgram ) {                                                             // count each byte, CRLF, the bigrams and trigrams
+        crlf = countHistogramNgram(span, len, pBf->lf.raw, pNgram, &pBf->pNgram->last);
+        *pPrevCr = len ? span[len-1] == '\r': *pPrevCr;
+    } else {
+        countHistogram(span, len, pBf->lf.raw);                                 // count each byte
+        crlf = countCrLf(span, len, pPrevCr);
+    }
+    if ( pHash ) {
+        hashUpdate(pHash, span, len);
+    }
+    if ( pBf->pWords ) {
+        countWords(pBf->pWords, span, len);                                     // count the words
+    }
+    return crlf;
+}
+
+/*
+    state of a book between the spans:  step10, and the context of the library (hlfc.h)
+*/
+struct spanCounter {
+    bool prevCr;                                    // the last letter of the previous span was '\r'
+    unsigned long long crlf;                        // count of CRLF
+    unsigned long long letters;                     // letters counted, CRLF is 2 letters here
+    unsigned long long used;                        // bytes of the file used.  (UTF-8:  not the cut sequence at the end)
+    struct utf8Decoder decoder;                     // UTF-8 book
+    unsigned char *decoded;                         // UTF-8, ISO-8859-2, CP852 book:  the decoded letters
+    size_t decodedSize;
+};
+
+/*
+    count a span of the book.  The encoding is decided by the first non-ASCII bytes of the book.
+    A UTF-8, ISO-8859-2 or CP852 span is converted to CP1250 by blocks.  The content hash is of the bytes of the file.
+    return: false if no memory
+*/
+static int countSpan(struct bookFrequency *pBf, struct spanCounter *pS, const unsigned char *span, size_t len, int jobs,
+                     struct contentHash *pHash, struct ngramCounter *pNgram) {
+    if ( pBf->encoding == ENCODING_AUTO ) {
+        pBf->encoding = detectEncoding(span, len, pBf->offset == 0 && pS->used == 0);
+    }
+    if ( pBf->encoding == ENCODING_AUTO || pBf->encoding == ENCODING_CP1250 ) {
+        pS->crlf += countLetters(pBf, span, len, &pS->prevCr, jobs, pHash, pNgram);
+        pS->letters += len;
+        pS->used += len;
+        return true;
+    }
+    if ( pS->decodedSize < MIN(len, DECODE_BLOCK) ) {   // a small book has a small buffer
+        size_t size = MAX(MIN(len, DECODE_BLOCK), 16);
+        unsigned char *pNew = realloc(pS->decoded, size);
+        if ( pNew == NULL ) {
+            fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+            return false;
+        }
+        pS->decoded = pNew;
+        pS->decodedSize = size;
+    }
+    if ( pHash ) {
+        hashUpdate(pHash, span, len);
+    }
+    while ( len ) {
+        size_t n;
+        size_t letters = pBf->encoding == ENCODING_UTF8 ? decodeUtf8(&pS->decoder, span, len, pS->decoded, pS->decodedSize, &n)
+                            : decodeCodepage(codepage[pBf->encoding].toCp1250, span, len, pS->decoded, pS->decodedSize, &n);
+        if ( letters ) {
+            pS->crlf += countLetters(pBf, pS->decoded, letters, &pS->prevCr, jobs, NULL, pNgram);
+        }
+        pS->letters += letters;
+        pS->used += n;
+        span += n;
+        len -= n;
+    }
+    return true;
+}
+
+/*
+    Sampling (--sample TOL)
+    A large book is estimated from the blocks (--sample-block KB) at random positions, not read fully.  The blocks are
+    taken by a random permutation (samplePermute(), the indexes over the blocks are skipped), so each block is read once.
+    A stride would have the same period as a book with the repeated parts.  The block 0 is the first, for the BOM and
+    the encoding.
+    A block is a cluster of letters:  the percent of a letter is the ratio of the sums of the blocks, the variance is
+    from the differences between the blocks (ratio estimator, with the finite population correction 1 - m/M).
+        y = x - p*n         x: the letter in a block, n: the alphabets in a block, p: the percent (ratio)
+        Var(Y) = M^2 (1 - m/M) / (m (m-1)) * (sum(y^2) - sum(y)^2 / m),     Var(p) = Var(Y) / alphabets^2
+    Var(Y) is kept as the coefficients of p^0, p^1, p^2, so the variance of the grand total is the sum of the books.
+    The book stops when the 95% confidence interval of every letter in the bar chart is within +-TOL percent, and the top
+    --sample-top letters are in the same order as the previous check.  The counts are scaled to the file size.
+    A small book (SAMPLE_BOOK_BLOCKS), a compressed book and a book read by read() are counted fully.
+    NOTE:   the letters across the boundary of a block (CRLF, a UTF-8 sequence) are not counted.
+*/
+#define SAMPLE_Z            1.96                    // 95% confidence interval
+#define SAMPLE_MIN_BLOCKS   16                      // blocks before the first check
+#define SAMPLE_CHECK        8                       // blocks between the checks
+#define SAMPLE_BOOK_BLOCKS  64                      // a smaller book is counted fully
+#define SAMPLE_SEED         0x68666353616d706cull   // the same file size, the same blocks
+
+struct sampleSums {                                 // sums of the sampled blocks of a book
+    unsigned long long raw[256];                    // histogram of the blocks
+    double x[256];                                  // sum of x:    count of each letter (lf.c[]) in a block
+    double xx[256];                                 // sum of x^2
+    double xn[256];                                 // sum of x*n,  n: alphabets in a block
+    double n;                                       // sum of n
+    double nn;                                      // sum of n^2
+};
+
+/*
+    a bijection of [0, 2^bits):  odd multiplier, xorshift and addition in each round
+*/
+static unsigned long long samplePermute(unsigned long long k, int bits, unsigned long long seed) {
+    unsigned long long mask = (1ull << bits) - 1;
+    for ( int round=0; round<3; round++ ) {
+        seed = mix64(seed);
+        k = (k * (seed | 1)) & mask;
+        k ^= k >> (bits/2 + 1);
+        k = (k + (seed >> 32)) & mask;
+    }
+    return k;
+}
+
+static void sampleAddBlock(struct sampleSums *pSum, const unsigned long long raw[256]) {
+    double x[256] = { 0. };
+    double n = 0.;
+    for ( int i=0; i<256; i++ ) {
+        pSum->raw[i] += raw[i];
+        x[cp1250Upper[i]] += (double)raw[i];
+        n += (cp1250Class[i] & CP1250_ALPHA) ? (double)raw[i]: 0.;
+    }
+    for ( int c=0; c<256; c++ ) {
+        pSum->x[c]  += x[c];
+        pSum->xx[c] += x[c] * x[c];
+        pSum->xn[c] += x[c] * n;
+    }
+    pSum->n  += n;
+    pSum->nn += n * n;
+}
+
+/*
+    coefficients of Var(Y) of each letter, m of the blocks are sampled
+*/
+static void sampleVariance(struct sampleFrequency *pS, const struct sampleSums *pSum, unsigned long long m, unsigned long long blocks) {
+    double w = m > 1 ? (double)blocks * blocks * (1. - (double)m / blocks) / ((double)m * (m - 1)): 0.;
+    for ( int c=0; c<256; c++ ) {
+        pS->var[0][c] = w * (pSum->xx[c] - pSum->x[c] * pSum->x[c] / m);
+        pS->var[1][c] = w * 2. * (pSum->x[c] * pSum->n / m - pSum->xn[c]);
+        pS->var[2][c] = w * (pSum->nn - pSum->n * pSum->n / m);
+    }
+}
+
+/*
+    half width of the confidence interval of the percent of a letter
+    p:  the ratio of the letter to the alphabets.  alphabets:  the estimated alphabets
+    return: percent
+*/
+static double sampleHalfWidth(const struct sampleFrequency *pS, int c, double p, double alphabets) {
+    double v = pS->var[0][c] + pS->var[1][c] * p + pS->var[2][c] * p * p;
+    return v > 0. && alphabets > 0. ? 100. * SAMPLE_Z * sqrt(v) / alphabets: 0.;
+}
+
+/*
+    the book can stop:  every letter of the bar chart is within the tolerance, the top letters are the same as before
+    top, pTops: [in/out] the top letters of the previous check
+*/
+static bool sampleStable(struct sampleFrequency *pS, const struct sampleSums *pSum, unsigned long long m, unsigned long long blocks,
+                         unsigned char top[256], int *pTops) {
+    unsigned char rank[256];
+    bool ranked[256] = { false };
+    int ranks = 0;
+    bool stable = true;
+    double alphabets = pSum->n * blocks / m;
+    sampleVariance(pS, pSum, m, blocks);
+    for ( int c=0; c<256; c++ ) {
+        if ( barChartChartLetter[c] && pSum->x[c] > 0. && pSum->n > 0. ) {
+            stable = stable && sampleHalfWidth(pS, c, pSum->x[c] / pSum->n, alphabets) <= option.sample;
+        }
+    }
+    while ( ranks < option.sampleTop ) {                            // the largest first
+        int best = -1;
+        for ( int c=0; c<256; c++ ) {
+            if ( barChartChartLetter[c] && pSum->x[c] > 0. && !ranked[c] && (best < 0 || pSum->x[c] > pSum->x[best]) ) {
+                best = c;
+            }
+        }
+        if ( best < 0 ) {
+            break;
+        }
+        ranked[best] = true;
+        rank[ranks++] = best;
+    }
+    stable = stable && ranks == *pTops && memcmp(rank, top, ranks) == 0;
+    memcpy(top, rank, ranks);
+    *pTops = ranks;
+    return stable;
+}
+
+/*
+    estimate the book from the blocks of the mapped file (--sample)
+    return: count of the letters (estimated).  0: not sampled, the book has to be counted fully
+*/
+static unsigned long long sampleBook(struct bookFrequency *pBf, struct bookReader *pR) {
+    unsigned long long blockSize = (unsigned long long)option.sampleBlock * 1024;
+    unsigned long long blocks = (pR->size + blockSize - 1) / blockSize;
+    unsigned long long seed = SAMPLE_SEED ^ pR->size;
+    int bits = 1;
+    unsigned long long m = 0, letters = 0, sampledBytes = 0, invalid = 0;
+    struct spanCounter sc = { false, 0, 0, 0, { { 0 }, 0, 0 }, NULL, 0 };
+    struct sampleSums *pSum = calloc(1, sizeof(struct sampleSums));
+    unsigned char top[256];
+    int tops = 0;
+    double scale;
+    if ( pSum == NULL ) {
+        return 0;
+    }
+    while ( (1ull << bits) < blocks ) {
+        bits++;
+    }
+    for ( unsigned long long k=0; m<blocks; k++ ) {
+        unsigned long long block = samplePermute(k, bits, seed) ^ samplePermute(0, bits, seed);   // k = 0:  the block 0
+        if ( block >= blocks ) {
+            continue;
+        }
+        unsigned long long offset = block * blockSize;
+        const unsigned char *p = pR->map + offset;
+        size_t len = (size_t)MIN(blockSize, pR->size - offset);
+        sampledBytes += len;
+        if ( offset && (pBf->encoding == ENCODING_AUTO || pBf->encoding == ENCODING_UTF8) ) {
+            for ( int i=0; i<3 && len && (*p & 0xc0) == 0x80; i++ ) {        // the rest of a UTF-8 sequence
+                p++;
+                len--;
+            }
+        }
+        memset(pBf->lf.raw, 0, sizeof(pBf->lf.raw));
+        invalid += sc.decoder.invalid;
+        memset(&sc.decoder, 0, sizeof(sc.decoder));
+        sc.prevCr = false;
+        sc.crlf = sc.letters = 0;
+        sc.used = offset;                                           // the top of the book is only in the block 0
+        if ( !countSpan(pBf, &sc, p, len, 1, NULL, NULL) ) {
+            memset(pBf->lf.raw, 0, sizeof(pBf->lf.raw));
+            free(sc.decoded);
+            free(pSum);
+            return 0;
+        }
+        pBf->lf.raw['\r'] -= sc.crlf;                               // CRLF is one newline
+        letters += sc.letters - sc.crlf;
+        sampleAddBlock(pSum, pBf->lf.raw);
+        m++;
+        if ( m >= SAMPLE_MIN_BLOCKS && (m - SAMPLE_MIN_BLOCKS) % SAMPLE_CHECK == 0 && sampleStable(pBf->pSample, pSum, m, blocks, top, &tops) ) {
+            break;
+        }
+    }
+    invalid += sc.decoder.invalid;
+    if ( invalid ) {
+        fprintf(stderr, "***Warning:  %llu invalid UTF-8 sequences in the sampled blocks, counted as other letters:  %s\n", invalid, pBf->bookTitle);
+    }
+    sampleVariance(pBf->pSample, pSum, m, blocks);
+    scale = (double)pR->size / sampledBytes;
+    for ( int i=0; i<256; i++ ) {
+        pBf->lf.raw[i] = (unsigned long long)llround(pSum->raw[i] * scale);   // scaled to the file size
+    }
+    pBf->pSample->books = 1;
+    pBf->pSample->blocks = blocks;
+    pBf->pSample->sampledBlocks = m;
+    pBf->pSample->bytes = pR->size;
+    pBf->pSample->sampledBytes = sampledBytes;
+    pR->mappedBytes += sampledBytes;                                // --stats
+    free(sc.decoded);
+    free(pSum);
+    letters = (unsigned long long)llround(letters * scale);
+    calcLfFromHistogram(&pBf->lf);
+    pBf->offset = pR->size;
+    pBf->bytes += letters;
+    return letters;
+}
+
+/*
+    add the sampled book to the sum of the books (the grand total)
+*/
+static void addSample(struct sampleFrequency *pTotal, const struct sampleFrequency *pS) {
+    if ( pS->books == 0 ) {
+        return;
+    }
+    pTotal->books         += pS->books;
+    pTotal->blocks        += pS->blocks;
+    pTotal->sampledBlocks += pS->sampledBlocks;
+    pTotal->bytes         += pS->bytes;
+    pTotal->sampledBytes  += pS->sampledBytes;
+    for ( int k=0; k<3; k++ ) {
+        for ( int c=0; c<256; c++ ) {
+            pTotal->var[k][c] += pS->var[k][c];
+        }
+    }
+}
+
+/*
+    Positional index (--index):  BOOK.hlfcidx, next to the book
+    step10 writes the cumulative histogram (raw[256], CRLF is one newline) at every --index-block KB of the file, and at
+    the end of the book.  The letters of a byte range [from, to) are the difference of 2 positions.  A position is the
+    checkpoint before it and the scan of the bytes from the checkpoint (less than a block).  Larger block:  smaller
+    index (2 KB for each block), longer scan of the query.
+    File:   INDEX_MAGIC, version(u32), encoding(u32), block(u64), size(u64), mtime(u64), checkpoints(u64)
+            then the checkpoints, raw[256] (u64) each:  checkpoint i is the position MIN((i+1)*block, size)
+    A UTF-8 letter is in the block where its sequence ends, so a scan starts from the lead byte of a cut sequence.
+    A compressed book and an archive member have no index.  Only a book counted from the top has a new index
+    (not the cached books of --cache, not the appended bytes of --follow).
+*/
+#define INDEX_MAGIC         "HLFCINDX"
+#define INDEX_VERSION       1
+#define INDEX_HEADER        (8+4+4+8+8+8+8)         // file offset of the first checkpoint
+
+struct bookIndex {
+    FILE *fp;
+    char fname[FILENAME_MAX];
+    int encoding;                                   // encoding of the book.  ENCODING_AUTO:  only ASCII
+    unsigned long long block;                       // bytes between the checkpoints
+    unsigned long long size;                        // file size of the book
+    unsigned long long mtime;                       // last modified time of the book, when it is counted
+    unsigned long long checkpoints;
+};
+
+static void indexWriteHeader(struct bookIndex *pI) {
+    fwrite(INDEX_MAGIC, 1, sizeof(INDEX_MAGIC)-1, pI->fp);
+    fputU32le(INDEX_VERSION, pI->fp);
+    fputU32le((unsigned int)pI->encoding, pI->fp);
+    fputU64le(pI->block, pI->fp);
+    fputU64le(pI->size, pI->fp);
+    fputU64le(pI->mtime, pI->fp);
+    fputU64le(pI->checkpoints, pI->fp);
+}
+
+/*
+    start the index of the book, written to "BOOK.hlfcidx.tmp" until indexClose()
+    return: false if the index is not written
+*/
+static int indexOpen(struct bookIndex *pI, char *bookTitle) {
+    char tmpFName[FILENAME_MAX + 8];
+    memset(pI, 0, sizeof(*pI));
+    pI->block = (unsigned long long)option.indexBlock * 1024;
+    pI->size = getFileInfo(bookTitle, &pI->mtime);
+    snprintf(pI->fname, sizeof(pI->fname), "%s%s", bookTitle, INDEX_EXT);
+    snprintf(tmpFName, sizeof(tmpFName), "%s.tmp", pI->fname);
+    if ( (pI->fp = fopenUtf8(tmpFName, "wb")) == NULL ) {
+        fprintf(stderr, "***Error line %d:  file write open error:  %s\n", __LINE__, tmpFName);
+        return false;
+    }
+    indexWriteHeader(pI);                           // checkpoints are written by indexClose()
+    return true;
+}
+
+static int indexCheckpoint(struct bookIndex *pI, const unsigned long long raw[256], unsigned long long crlf) {
+    unsigned char buf[256*8];
+    for ( int c=0; c<256; c++ ) {
+        putU64le(&buf[c*8], raw[c] - (c == '\r' ? crlf: 0));   // CRLF is one newline
+    }
+    pI->checkpoints++;
+    return fwrite(buf, 1, sizeof(buf), pI->fp) == sizeof(buf);
+}
+
+/*
+    countSpan() by the blocks of the index, a checkpoint at the end of each block
+*/
+static int indexSpan(struct bookIndex *pI, struct bookFrequency *pBf, struct spanCounter *pS, const unsigned char *span, size_t len,
+                     int jobs, struct contentHash *pHash, struct ngramCounter *pNgram) {
+    while ( len ) {
+        size_t n = (size_t)MIN(len, pI->block - pS->used % pI->block);
+        if ( !countSpan(pBf, pS, span, n, jobs, pHash, pNgram) ) {
+            return false;
+        }
+        span += n;
+        len -= n;
+        if ( pS->used % pI->block == 0 && !indexCheckpoint(pI, pBf->lf.raw, pS->crlf) ) {
+            fprintf(stderr, "***Error line %d:  file write error:  %s.tmp\n", __LINE__, pI->fname);
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    the last checkpoint (the end of the book) and the header, then "BOOK.hlfcidx.tmp" is renamed
+    ok:     false:  the book is not counted to the end, the index is removed
+*/
+static void indexClose(struct bookIndex *pI, struct bookFrequency *pBf, struct spanCounter *pS, bool ok) {
+    char tmpFName[FILENAME_MAX + 8];
+    snprintf(tmpFName, sizeof(tmpFName), "%s.tmp", pI->fname);
+    if ( ok && pS->used % pI->block ) {
+        ok = indexCheckpoint(pI, pBf->lf.raw, pS->crlf);
+    }
+    pI->size = pS->used;                            // the counted bytes.  a changed book has the other mtime
+    pI->encoding = pBf->encoding;
+    if ( ok && fseekU64(pI->fp, 0) ) {
+        indexWriteHeader(pI);
+    }
+    if ( fclose(pI->fp) != 0 || !ok ) {
+        fprintf(stderr, "***Error line %d:  file write error:  %s\n", __LINE__, tmpFName);
+        remove(tmpFName);
+        return;
+    }
+    remove(pI->fname);                              // rename() of Windows does not overwrite
+    if ( rename(tmpFName, pI->fname) != 0 ) {
+        fprintf(stderr, "***Error line %d:  file rename error:  %s\n", __LINE__, pI->fname);
+    }
+}
+
+/*
+    open the index of the book for hlfc query
+    return: false if no index, or the book is changed after the index
+*/
+static int indexOpenRead(struct bookIndex *pI, char *bookTitle) {
+    char magic[sizeof(INDEX_MAGIC)-1];
+    unsigned int version, encoding;
+    unsigned long long size, mtime = 0;
+    memset(pI, 0, sizeof(*pI));
+    snprintf(pI->fname, sizeof(pI->fname), "%s%s", bookTitle, INDEX_EXT);
+    if ( (pI->fp = fopenUtf8(pI->fname, "rb")) == NULL ) {
+        fprintf(stderr, "***Error line %d:  no index, count the book with --index:  %s\n", __LINE__, bookTitle);
+        return false;
+    }
+    if ( fread(magic, 1, sizeof(magic), pI->fp) != sizeof(magic) || memcmp(magic, INDEX_MAGIC, sizeof(magic)) != 0
+      || !fgetU32le(&version, pI->fp) || version != INDEX_VERSION || !fgetU32le(&encoding, pI->fp) || encoding >= ENCODINGS
+      || !fgetU64le(&pI->block, pI->fp) || pI->block == 0 || !fgetU64le(&pI->size, pI->fp) || !fgetU64le(&pI->mtime, pI->fp)
+      || !fgetU64le(&pI->checkpoints, pI->fp) || pI->checkpoints != (pI->size + pI->block - 1) / pI->block ) {
+        fprintf(stderr, "***Error line %d:  not an index of this version:  %s\n", __LINE__, pI->fname);
+        fclose(pI->fp);
+        return false;
+    }
+    pI->encoding = (encoding == ENCODING_AUTO) ? ENCODING_CP1250: (int)encoding;   // only ASCII
+    size = getFileInfo(bookTitle, &mtime);
+    if ( size != pI->size || mtime != pI->mtime ) {
+        fprintf(stderr, "***Error line %d:  the book is changed after the index, count it again with --index:  %s\n", __LINE__, bookTitle);
+        fclose(pI->fp);
+        return false;
+    }
+    return true;
+}
+
+/*
+    histogram of the bytes [0, x) of the book:  the checkpoint before x, and the bytes from the checkpoint to x
+    pR:     the book, for the bytes after the checkpoint
+*/
+static int indexPosition(struct bookIndex *pI, struct bookReader *pR, unsigned long long x, unsigned long long raw[256]) {
+    unsigned long long k = MIN(x, pI->size) / pI->block;        // checkpoint k-1 is the position k*block
+    unsigned long long from = k * pI->block;
+    unsigned long long pos;
+    struct bookFrequency bf;
+    struct spanCounter sc = { false, 0, 0, 0, { { 0 }, 0, 0 }, NULL, 0 };
+    const unsigned char *span;
+    size_t len;
+    bool first = true;
+    int ok = true;
+    memset(raw, 0, sizeof(bf.lf.raw));
+    x = MIN(x, pI->size);
+    if ( x == pI->size && pI->checkpoints ) {
+        k = pI->checkpoints;                        // the end of the book
+        from = x;
+    }
+    if ( k ) {
+        ok = fseekU64(pI->fp, INDEX_HEADER + (k-1) * sizeof(bf.lf.raw));
+        for ( int c=0; ok && c<256; c++ ) {
+            ok = fgetU64le(&raw[c], pI->fp);
+        }
+        if ( !ok ) {
+            fprintf(stderr, "***Error line %d:  file read error:  %s\n", __LINE__, pI->fname);
+            return false;
+        }
+    }
+    if ( x == from ) {
+        return true;
+    }
+    memset(&bf, 0, sizeof(bf));
+    bf.encoding = pI->encoding;
+    pos = from >= 4 ? from - 4: 0;                  // the byte before, and a UTF-8 sequence cut by the checkpoint
+    if ( !readerSeek(pR, pos) ) {
+        fprintf(stderr, "***Error line %d:  file seek error:  %s\n", __LINE__, pI->fname);
+        return false;
+    }
+    while ( ok && pos < x && (len = readerNext(pR, &span)) > 0 ) {
+        len = (size_t)MIN(len, x - pos);
+        pos += len;
+        if ( first ) {
+            size_t head = (size_t)(from - (pos - len)); // bytes before the checkpoint
+            size_t top = head;
+            if ( bf.encoding == ENCODING_UTF8 ) {
+                while ( top > 0 && head - top < 3 && (span[top-1] & 0xc0) == 0x80 ) {
+                    top--;
+                }
+                if ( top == 0 || span[top-1] < 0xc0 || top-1 + (span[top-1] >= 0xf0 ? 4: span[top-1] >= 0xe0 ? 3: 2) <= head ) {
+                    top = head;                     // no sequence is cut by the checkpoint
+                } else {
+                    top--;                          // the lead byte:  the letter is counted after the checkpoint
+                }
+            }
+            sc.prevCr = top > 0 && span[top-1] == '\r';
+            span += top;
+            len -= top;
+            first = false;
+        }
+        ok = countSpan(&bf, &sc, span, len, 1, NULL, NULL);
+    }
+    free(sc.decoded);
+    bf.lf.raw['\r'] -= sc.crlf;
+    for ( int c=0; c<256; c++ ) {
+        raw[c] += bf.lf.raw[c];
+    }
+    return ok;
+}
+
+/*
+    calculate the letter frequeny for a book
+    jobs:   number of threads to count this book.  a large book is split into chunks
+    The count is added to the letter frequency of the book, from pBf->offset.  (0: from the top of the book)
+    A compressed book is decompressed by the reader.  --follow counts it again from the top when it is changed.
+    A UTF-8, ISO-8859-2 or CP852 book is converted to CP1250 by blocks.  The content hash is of the bytes of the file.
+    --sample:  a large mapped book is estimated by sampleBook(), from the top of the book
+    --index:   a book counted from the top has the checkpoints in BOOK.hlfcidx (not a compressed book, an archive member)
+    return: count of the letters counted this time
+*/
+static unsigned long long step10_calcBookFrequency(struct bookFrequency *pBf, int jobs) {
+    struct bookReader reader;
+    const unsigned char *span;
+    size_t len;
+    struct spanCounter sc = { false, 0, 0, 0, { { 0 }, 0, 0 }, NULL, 0 };
+    unsigned long long cc=0; // character count including newline
+    struct contentHash hash; // content hash for the cache
+    bool hashing;                                       // the hash is only for the whole book
+    bool skipFirst;                                     // the first letter is the last counted letter, only for CRLF
+    struct ngramCounter *pNgram = NULL;                 // --ngram:  n-gram counters of this book
+    double start = statsTime();                         // --stats:  seconds of this book
+    struct bookIndex index;                             // --index:  the checkpoints of this book
+    bool indexing;
+    bool counted = true;
+
+    hashInit(&hash, 0);
+    if ( pBf->pNgram && (pNgram = takeNgramCounter(pBf->pNgram)) == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        return 0;
+    }
+    if ( !readerOpen(&reader, pBf->bookTitle) ) {                               //  (not the content.  only the fine name)
+        fprintf(stderr, "***Error line %d:  file read open error:  %s\n", __LINE__, pBf->bookTitle);
+        giveNgramCounter(pNgram);
+        return 0;
+    }
+    if ( reader.pPipe && pBf->offset ) {
+        resetBookFrequency(pBf);                        // a compressed book is counted again from the top
+    }
+    if ( pBf->pSample && pBf->offset == 0 && reader.mode == READER_MMAP && reader.pPipe == NULL
+      && reader.size >= (unsigned long long)option.sampleBlock * 1024 * SAMPLE_BOOK_BLOCKS && (cc = sampleBook(pBf, &reader)) > 0 ) {
+        readerClose(&reader);
+        giveNgramCounter(pNgram);
+        statsBook(pBf->bookTitle, cc, start);
+        return cc;
+    }
+    hashing = option.cache && pBf->offset == 0;
+    skipFirst = pBf->offset > 0;
+    if ( skipFirst && !readerSeek(&reader, pBf->offset-1) ) {
+        fprintf(stderr, "***Error line %d:  file seek error:  %s\n", __LINE__, pBf->bookTitle);
+        readerClose(&reader);
+        giveNgramCounter(pNgram);
+        return 0;
+    }
+    indexing = option.index && pBf->offset == 0 && reader.pPipe == NULL && !reader.borrowed && indexOpen(&index, pBf->bookTitle);
+    while ( (len=readerNext(&reader, &span)) > 0 ) {
+        if ( skipFirst ) {
+            sc.prevCr = (span[0] == '\r');
+            span++;
+            len--;
+            skipFirst = false;
+        }
+        if ( !(indexing ? indexSpan(&index, pBf, &sc, span, len, jobs, hashing ? &hash: NULL, pNgram)
+                        : countSpan(pBf, &sc, span, len, jobs, hashing ? &hash: NULL, pNgram)) ) {
+            counted = false;
+            break;
+        }
+    }
+    if ( indexing ) {
+        indexClose(&index, pBf, &sc, counted);
+    }
+    if ( pNgram ) {
+        flushNgramCounter(pNgram);                                              // to the n-gram of the book
+        giveNgramCounter(pNgram);
+    }
+    pBf->offset += reader.pPipe ? getFileInfo(pBf->bookTitle, NULL): sc.used - sc.decoder.pendingLen;   // --follow:  bytes of the file
+    readerClose(&reader);
+    free(sc.decoded);
+    if ( sc.decoder.invalid ) {
+        fprintf(stderr, "***Warning:  %llu invalid UTF-8 sequences, counted as other letters:  %s\n", sc.decoder.invalid, pBf->bookTitle);
+    }
+    pBf->lf.raw['\r'] -= sc.crlf;                                               // CRLF is one newline (same as the text mode)
+    cc = sc.letters - sc.crlf;
+    calcLfFromHistogram(&pBf->lf);                                              // all counters from the histogram
+    if ( pBf->pWords && pBf->pWords->tokens ) {
+        pBf->lf.lettersPerWord = (double)pBf->pWords->letters / pBf->pWords->tokens;    // measured, the word in progress is not included
+    }
+    pBf->bytes += cc;
+    if ( hashing ) {
+        pBf->hash = hashFinal(&hash);
+    }
+    statsBook(pBf->bookTitle, cc, start);
+    return cc;
+}
+
+/*
+    Parallel book counting
+    books are taken by the worker threads, largest file first.  (the last book does not wait for a large book)
+    a very large book (CHUNK_BOOK_MIN or larger) is counted before by chunks with all the threads.
+    Each worker has a private total, added to the grand total after all the workers are finished.
+    The report is not printed here, the caller prints it in the book list order.
+*/
+struct bookPool {
+    struct bookFrequency *pBf;                      // top of the bookFrequency table[]
+    int *order;                                     // index of the book, largest file first
+    int books;                                      // number of the books
+    volatile long next;                             // next position in order[] to be taken by a worker
+};
+
+struct bookWorker {
+    threadHandle thread;
+    struct bookPool *pPool;
+    struct letterFrequency total;                   // total of the books counted by this worker
+};
+
+static struct bookFrequency *spSortBf;              // for compareBookSize() (qsort() does not have a context)
+static int compareBookSize(const void *a, const void *b) {
+    unsigned long long sizeA = spSortBf[*(const int *)a].bytes;
+    unsigned long long sizeB = spSortBf[*(const int *)b].bytes;
+    if ( sizeA != sizeB ) {
+        return sizeA < sizeB ? 1: -1;               // larger first
+    }
+    return *(const int *)a - *(const int *)b;       // same size: book list order
+}
+
+static void *bookWorkerMain(void *arg) {
+    struct bookWorker *pW = arg;
+    struct bookPool *pPool = pW->pPool;
+    long k;
+    while ( (k = atomicFetchAdd(&pPool->next, 1)) < pPool->books ) {
+        struct bookFrequency *pBf = &pPool->pBf[pPool->order[k]];
+        pBf->bytes = 0;                             // the file size was only for the order, step10 adds the counted size
+        step10_calcBookFrequency(pBf, 1);
+        addLf(&pW->total, &pBf->lf);
+    }
+    return NULL;
+}
+
+/*
+    calculate the letter frequency for all the books by the threads
+    Input:  pBf:    pointer of the top of bookFrequency table[]
+            books:  number of books
+            jobs:   number of threads
+    Ouput:  bookFrequency table, pBf[i].bytes = 0 if the book can not be read
+            pGt:    grand total
+*/
+static void step09_calcBookFrequencyParallel(struct totalFrequency *pGt, struct bookFrequency *pBf, int books, int jobs) {
+    struct bookPool pool = { pBf, NULL, 0, 0 };
+    struct bookWorker *pWorker;
+    int started = 0;
+
+    pool.order = malloc(sizeof(int)*books);
+    pWorker = calloc(jobs, sizeof(struct bookWorker));
+    if ( pool.order == NULL || pWorker == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        free(pool.order);
+        free(pWorker);
+        return;
+    }
+    for ( int i=0; i<books; i++ ) {
+        if ( pBf[i].cached ) {                      // --cache: no need to count
+            addLf(&pWorker[0].total, &pBf[i].lf);
+            continue;
+        }
+        pool.order[pool.books++] = i;
+        pBf[i].bytes = getFileInfo(pBf[i].bookTitle, NULL);    // overwritten by the counted size
+    }
+    spSortBf = pBf;
+    qsort(pool.order, pool.books, sizeof(pool.order[0]), compareBookSize);
+    for ( ; pool.next<pool.books && pBf[pool.order[pool.next]].bytes >= CHUNK_BOOK_MIN; pool.next++ ) {
+        struct bookFrequency *pBig = &pBf[pool.order[pool.next]];
+        pBig->bytes = 0;
+        step10_calcBookFrequency(pBig, jobs);           // a very large book, by chunks
+        addLf(&pWorker[0].total, &pBig->lf);
+    }
+    jobs = MIN(jobs, pool.books - (int)pool.next);
+    for ( int i=0; i<jobs; i++ ) {
+        pWorker[i].pPool = &pool;
+        if ( !threadCreate(&pWorker[i].thread, bookWorkerMain, &pWorker[i]) ) {
+            fprintf(stderr, "***Error line %d:  thread create error\n", __LINE__);
+            break;
+        }
+        started++;
+    }
+    if ( started == 0 ) {                           // no thread, count by this thread
+        pWorker[0].pPool = &pool;
+        bookWorkerMain(&pWorker[0]);
+        started = 1;
+    }
+    for ( int i=0; i<started; i++ ) {
+        if ( pWorker[i].thread ) {
+            threadJoin(pWorker[i].thread);
+        }
+        addLf(&pGt->lf, &pWorker[i].total);         // add to the grand total, always in the worker order
+    }
+    free(pWorker);
+    free(pool.order);
+}
+
+/*
+    make the cost vector of a typing method:  seconds to type each letter
+    the letter which is in regularPosition.letter (case insensitive) is regularPosition.typeSpeed,
+    the other letter is unregularPosition.typeSpeed.
+    then the typing time of a book is only a dot product of the cost vector and lf.c[]
+*/
+static void compileTypingMethod(struct typingMethod *pM) {
+    bool regular[256] = { false };
+    for ( int i=0; i<sizeof(pM->regularPosition.letter) && pM->regularPosition.letter[i]; i++ ) {
+        regular[toupper1250((unsigned char)pM->regularPosition.letter[i])] = true;
+    }
+    for ( int i=0; i<sizeof(pM->cost)/sizeof(pM->cost[0]); i++ ) {
+        pM->cost[i] = regular[toupper1250(i)] ? pM->regularPosition.typeSpeed: pM->unregularPosition.typeSpeed;
+    }
+}
+
+/*
+    letters per word for the book:  measured by --words, or the letters per word of the typing model
+*/
+static double lettersPerWordOf(struct letterFrequency *pLf, const struct typingModel *pModel) {
+    return pLf->lettersPerWord > 0. ? pLf->lettersPerWord: pModel->lettersPerWord;
+}
+
+static int speedToWpm(double speedPerLetter, double lettersPerWord) {
+    return (int)(60. / (speedPerLetter * lettersPerWord) +0.5);
+}
+
+/*
+    typing seconds of the book by each method:  pLf->typingMethod[].typingSecondForBook
+*/
+static void calcTypingSeconds(struct letterFrequency *pLf, const struct typingModel *pModel) {
+    for ( int method=0; method<pModel->methods; method++ ) {
+        double typingSecondForBook = 0.;
+        for ( int i=0; i<sizeof(pLf->c)/sizeof(pLf->c[0]); i++) {
+            typingSecondForBook += pModel->method[method].cost[i] * pLf->c[i];
+        }
+        pLf->typingMethod[method].typingSecondForBook = typingSecondForBook;
+    }
+}
+
+static void step20_calcTypingSpeed(struct reportBuffer *pOut, char *bookName, struct letterFrequency *pLf, const struct typingModel *pModel) {
+    reportPrintf(pOut, "[Typing Speed]\n");
+    calcTypingSeconds(pLf, pModel);
+    for ( int method=0; method<pModel->methods; method++ ) {
+        double typingSecondForBook = pLf->typingMethod[method].typingSecondForBook;
+        reportPrintf(pOut, "  %-10s: %7.1lf hours - %s (using %d to %dwpm)\n",
+            pModel->method[method].shortName10, typingSecondForBook/(60*60), 
+            pModel->method[method].name, 
+            speedToWpm(pModel->method[method].unregularPosition.typeSpeed, lettersPerWordOf(pLf, pModel)),
+            speedToWpm(pModel->method[method].regularPosition.typeSpeed, lettersPerWordOf(pLf, pModel)) );
+    }
+}
+
+static void step21_calcBusinessHours(struct reportBuffer *pOut, char *bookName, struct letterFrequency *pLf, const struct typingModel *pModel) {
+    int slowerIdx[MAX_TYPINGMETHOD];                // method index, the slowest first
+    double reduceSeconds[MAX_TYPINGMETHOD];         // reduced seconds than the slowest, in the order of slowerIdx[]
+    reportPrintf(pOut, "If %.lf%% of business hours need to type whole in a year,\n",
+        (double)pModel->typingHours / pModel->workingHours * 100. ) ;
+    // index sort, the slowest first.  (same time:  method order)
+    for ( int i=0; i<pModel->methods; i++ ) {
+        int j = i;
+        for ( ; j>0 && pLf->typingMethod[slowerIdx[j-1]].typingSecondForBook < pLf->typingMethod[i].typingSecondForBook; j-- ) {
+            slowerIdx[j] = slowerIdx[j-1];
+        }
+        slowerIdx[j] = i;
+    }
+    for ( int i=0; i<pModel->methods; i++ ) {
+        pLf->typingMethod[slowerIdx[i]].sortIdx = i;
+    }
+    // print
+    double lettersPerYear0 = (double)(pModel->daysInYear * pModel->typingHours) * 60 * 60 
+                           / (pLf->typingMethod[slowerIdx[0]].typingSecondForBook / pLf->totalLetters);
+    reportPrintf(pOut, "  %s is the slowest, able to type %llu words in a year.\n",
+        pModel->method[slowerIdx[0]].shortName10,
+        (unsigned long long)(lettersPerYear0 / lettersPerWordOf(pLf, pModel)) );
+    for (int i=1; i<pModel->methods; i++ ) {
+        double needSeconds = lettersPerYear0 * (pLf->typingMethod[slowerIdx[i]].typingSecondForBook) / (double)pLf->totalLetters;
+        reduceSeconds[i] = (double)(pModel->daysInYear * pModel->typingHours * 60 * 60) - needSeconds;
+        reportPrintf(pOut, "  %s reduces %5.1lf hours (%5.1lf business days %dh typing) than %s\n",
+            pModel->method[slowerIdx[i]].shortName10,
+            reduceSeconds[i]/(60*60),
+            reduceSeconds[i]/(60*60)/pModel->typingHours,
+            pModel->typingHours,
+            pModel->method[slowerIdx[0]].shortName10
+        );
+    }
+    // compare with the next slower method
+    for (int i=2; i<pModel->methods; i++ ) {
+        reportPrintf(pOut, "  %s reduces %5.1lf hours (%5.1lf business days %dh typing) than %s\n",
+            pModel->method[slowerIdx[i]].shortName10,
+            (reduceSeconds[i]-reduceSeconds[i-1])/(60*60),
+            (reduceSeconds[i]-reduceSeconds[i-1])/(60*60)/pModel->typingHours,
+            pModel->typingHours,
+            pModel->method[slowerIdx[i-1]].shortName10
+        );
+    }
+}
+
+/*
+    print the letter frequency for a book
+*/
+/*
+    letters (CP1250) of an n-gram or a word to the printable UTF-8 string
+*/
+static char *ngramToPrintable(const unsigned char *letters, int n, char *str, int maxLen) {
+    str[0] = '\0';
+    for ( int i=0; i<n; i++ ) {
+        strncat(str, toPrintableChar1250(letters[i]), maxLen - strlen(str) - 1);
+    }
+    return str;
+}
+
+/*
+    print the word statistics of a book (--words)
+*/
+struct wordRank {
+    const struct wordEntry *pE;
+};
+
+static int compareWordRank(const void *a, const void *b) {
+    const struct wordEntry *pA = ((const struct wordRank *)a)->pE;
+    const struct wordEntry *pB = ((const struct wordRank *)b)->pE;
+    int cmp;
+    if ( pA->count != pB->count ) {
+        return pA->count < pB->count ? 1: -1;       // larger first
+    }
+    cmp = memcmp(pA->key, pB->key, MIN(pA->len, pB->len));
+    return cmp ? cmp: (int)pA->len - (int)pB->len;
+}
+
+static void step14_printWords(struct reportBuffer *pOut, struct wordFrequency *pW, bool grandTotal) {
+    struct wordRank *pRank = malloc(sizeof(struct wordRank) * (pW->entries + 1));
+    int ranks = 0;
+    reportPrintf(pOut, "Words                                  : %8llu\n", pW->tokens);
+    reportPrintf(pOut, " - Vocabulary (different words)        : %8u\n", pW->entries);
+    reportPrintf(pOut, " - Average word length                 : %8.2lf letters\n", pW->tokens ? (double)pW->letters/pW->tokens: 0.);
+    if ( pW->unstored ) {
+        reportPrintf(pOut, " - Not stored words (memory limit)     : %8llu\n", pW->unstored);
+    }
+    if ( grandTotal ) {
+        reportPrintf(pOut, " - Memory for the words of all books   : %8.1lf MB (%.1lf bytes / word in this table, limit %d MB)\n",
+            wordMemoryKB / 1024., pW->entries ? (double)pW->memory / pW->entries: 0., option.wordsMemory);
+    }
+    if ( pRank == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        return;
+    }
+    for ( unsigned int i=0; i<pW->size; i++ ) {
+        if ( pW->entry[i].key ) {
+            pRank[ranks++].pE = &pW->entry[i];
+        }
+    }
+    qsort(pRank, ranks, sizeof(pRank[0]), compareWordRank);
+    for ( int i=0; i<option.wordsTop && i<ranks; i++ ) {
+        const struct wordEntry *pE = pRank[i].pE;
+        char str[WORD_MAX_LEN*4+1];
+        reportPrintf(pOut, "%s%-3d %s%*s %8llu (%4.1lf%%)", (i % 4) ? "   ": "  ", i+1,
+            ngramToPrintable(pE->key, pE->len, str, sizeof(str)), MAX(0, 12 - (int)pE->len), "",
+            pE->count, 100.*pE->count/pW->tokens);
+        if ( i % 4 == 3 || i == option.wordsTop-1 || i == ranks-1 ) {
+            reportPuts(pOut, "\n");
+        }
+    }
+    free(pRank);
+}
+
+/*
+    print the letter frequency for a book to the report buffer
+    the chart letters are put in the columns, the largest first:  row = n % lineCount, col = n / lineCount
+*/
+static int step11_printBookFrequency(struct reportBuffer *pOut, char *bookName, struct letterFrequency *pLf, struct wordFrequency *pWords,
+                              const struct typingModel *pModel) {
+    int letters;
+    int printCount;
+    int lineCount;
+    unsigned char chartLetter[256];                             // letters in the bar chart, the largest first
+    double start = statsTime();                                 // --stats:  sortLf, render and typing
+    reportPrintf(pOut, "\n---------%s\n", bookName);
+    // step 1. get the letters of the bar chart, printCount and lineCount
+    letters = sortLf(pLf);
+    start = statsBusy(STATS_SORTLF, start);
+    printCount = 0;
+    for ( int idx=0; idx<letters; idx++ ) {
+        int c = pLf->sortIdx[idx];                              // get a letter which has the biggest percentage
+        if ( barChartChartLetter[c] ) {                         // not punctuation, white space, digit numbers
+            chartLetter[printCount++] = c;
+        }
+    }
+    lineCount = (printCount + BARCHART_HOW_MANY_IN_LINE - 1)  / BARCHART_HOW_MANY_IN_LINE; 
+
+    // step 2. print the bar chart:  header, bar chart content, footer
+    if ( lineCount ) {
+        reportPuts(pOut, barChart_header);
+    }
+    for ( int row=0; row<lineCount; row++ ) {
+        char line[BARCHART_HOW_MANY_IN_LINE * (BARCHART_CELL_LEN + 16)];
+        int len = 0;
+        line[len++] = ' ';
+        for ( int col=0; col<BARCHART_HOW_MANY_IN_LINE; col++ ) {
+            int n = col * lineCount + row;
+            int c = n < printCount ? chartLetter[n]: 0;
+            const char *pLetter = toPrintableChar1250(c?c:' ');
+            if ( col!=0 ) {                                     // before the 2nd, 3rd bar chart in a line
+                memcpy(&line[len], "   ", 3);
+                len += 3;
+            }
+            line[len++] = '|';
+            while ( *pLetter ) {
+                line[len++] = *pLetter++;
+            }
+            line[len++] = '|';
+            len += barChart(&line[len], (double)BARCAHRT_SATURATION, pLf->c[c], pLf->totalAlphabets);
+            line[len++] = '|';
+            if ( c!='\0' && !isalpha1250(c) ) fprintf(stderr, "Line %7d: Found %s(%02x) -- need to implement this.\n", __LINE__, toPrintableChar1250(c), c );
+        }
+        line[len++] = '\n';
+        reportWrite(pOut, line, len);
+    }
+    for ( int row=0; row<lineCount && row<3; row++ ) {
+        reportPuts(pOut, barChart_footer[row]);
+    }
+    reportPrintf(pOut, "Total letters                          : %8llu\n", pLf->totalLetters);
+    reportPrintf(pOut, " - Punctuations    in Total letters    : %8lu (%4.1lf%%)\n", pLf->punctuation, 100.*pLf->punctuation/pLf->totalLetters);
+    reportPrintf(pOut, " - [0-9] numbers   in Total letters    : %8lu (%4.1lf%%)\n", pLf->digit, 100.*pLf->digit/pLf->totalLetters);
+    reportPrintf(pOut, " - Total Alphabets in Total letters    : %8llu (%4.1lf%%)\n", pLf->totalAlphabets, 100.*pLf->totalAlphabets/pLf->totalLetters);
+    reportPrintf(pOut, "    -  Hungarian áéíóőöúűü in Alphabets: %8llu (%4.1lf%%)\n", pLf->totalHungarian, 100.*pLf->totalHungarian/pLf->totalAlphabets);
+    if ( pWords ) {
+        step14_printWords(pOut, pWords, pWords == grandTotal.pWords);
+    }
+    start = statsBusy(STATS_RENDER, start);
+    step20_calcTypingSpeed(pOut, bookName, pLf, pModel);
+    step21_calcBusinessHours(pOut, bookName, pLf, pModel);
+    statsBusy(STATS_TYPING, start);
+    return printCount;
+}
+
+/*
+    --sample:  the sampled part, the 95% confidence interval of the percent in the bar chart
+    the interval of each letter for the top --sample-top letters.  pLf is sorted by step11.
+    pS:     a book, or sampleTotal for the grand total
+*/
+static void step18_printSample(struct reportBuffer *pOut, const struct sampleFrequency *pS, const struct letterFrequency *pLf) {
+    double maxHalfWidth = 0.;
+    int printed = 0;
+    if ( pS == &sampleTotal ) {
+        reportPrintf(pOut, "[Sampling]  %llu books estimated from %4.1lf%% of their bytes (%llu of %llu blocks of %d KB), the others counted fully\n",
+                     pS->books, 100. * pS->sampledBytes / pS->bytes, pS->sampledBlocks, pS->blocks, option.sampleBlock);
+    } else {
+        reportPrintf(pOut, "[Sampling]  estimated from %4.1lf%% of the book (%llu of %llu blocks of %d KB), the counts are scaled to the book\n",
+                     100. * pS->sampledBytes / pS->bytes, pS->sampledBlocks, pS->blocks, option.sampleBlock);
+    }
+    for ( int c=0; c<256; c++ ) {
+        if ( barChartChartLetter[c] && pLf->c[c] ) {
+            double halfWidth = sampleHalfWidth(pS, c, (double)pLf->c[c] / pLf->totalAlphabets, (double)pLf->totalAlphabets);
+            maxHalfWidth = MAX(maxHalfWidth, halfWidth);
+        }
+    }
+    reportPrintf(pOut, "  95%% confidence interval of the percent:  +-%.2lf%% max (--sample %.2lf)\n", maxHalfWidth, option.sample);
+    for ( int idx=0; idx<256 && printed<option.sampleTop; idx++ ) {
+        int c = pLf->sortIdx[idx];
+        if ( barChartChartLetter[c] && pLf->c[c] ) {
+            double p = (double)pLf->c[c] / pLf->totalAlphabets;
+            reportPrintf(pOut, "%s|%s| %5.2lf +-%.2lf%%", printed % 5 ? "   ": "  ", toPrintableChar1250(c), 100. * p,
+                         sampleHalfWidth(pS, c, p, (double)pLf->totalAlphabets));
+            if ( ++printed % 5 == 0 ) {
+                reportPuts(pOut, "\n");
+            }
+        }
+    }
+    if ( printed % 5 ) {
+        reportPuts(pOut, "\n");
+    }
+}
+
+/*
+    Machine-readable result (--format csv,json,bin)
+    The numbers of each book without the bar charts:  counters, typing seconds of each method and c[256].
+    The last line (row) is the grand total, the kind is "total".
+    CSV:    hlfcResult.csv, a header line, then a line for each book
+    JSON:   hlfcResult.jsonl, a JSON object in a line for each book
+    BIN:    hlfcResult.bin, columns of the rows.  All numbers are little endian.
+            RESULT_BIN_MAGIC, version(u32), columns(u32), rows(u64), titles offset(u64), titles bytes(u64)
+            then each column:  name(RESULT_BIN_NAME_LEN bytes, null padded), type(u32, RESULT_BIN_U64 or RESULT_BIN_F64),
+                               reserved(u32), offset(u64) of the values (rows * 8 bytes)
+            then the values of each column, and the titles (UTF-8, not terminated) at titleOffset[row], titleLength[row]
+    The rows are spooled in a temporary file, and put into the columns by closing the result.
+*/
+#define RESULT_COUNTERS     8                       // titleOffset, titleLength, bytes, totalLetters, ... totalHungarian
+#define RESULT_BIN_MAGIC    "HLFCRSLT"
+#define RESULT_BIN_VERSION  1
+#define RESULT_BIN_NAME_LEN 32                      // bytes of the column name
+#define RESULT_BIN_U64      1                       // unsigned 64 bits integer
+#define RESULT_BIN_F64      2                       // IEEE 754 double
+#define RESULT_BIN_CHUNK    4096                    // rows put into the columns at once
+
+static const char *resultCounterName[RESULT_COUNTERS] = {
+    "titleOffset", "titleLength", "bytes", "totalLetters", "punctuation", "digit", "totalAlphabets", "totalHungarian"
+};
+
+static struct resultBin {
+    FILE *spRows;                                   // spool of the rows (the values of the columns in a row)
+    FILE *spTitles;                                 // spool of the titles
+    unsigned long long rows;
+    unsigned long long titleBytes;                  // bytes of the titles
+} resultBin = { NULL, NULL, 0, 0 };
+
+static int resultColumns() {
+    return RESULT_COUNTERS + typingModel.methods + 256;
+}
+
+/*
+    counters of a book, in the order of resultCounterName[] (titleOffset and titleLength are not set)
+*/
+static void resultCounters(unsigned long long *pV, unsigned long long bytes, struct letterFrequency *pLf) {
+    pV[2] = bytes;
+    pV[3] = pLf->totalLetters;
+    pV[4] = pLf->punctuation;
+    pV[5] = pLf->digit;
+    pV[6] = pLf->totalAlphabets;
+    pV[7] = pLf->totalHungarian;
+}
+
+static void step15_printCsvHeader(struct reportBuffer *pOut) {
+    reportPuts(pOut, "kind,title");
+    for ( int i=2; i<RESULT_COUNTERS; i++ ) {
+        reportPrintf(pOut, ",%s", resultCounterName[i]);
+    }
+    for ( int method=0; method<typingModel.methods; method++ ) {
+        char name[64];
+        snprintf(name, sizeof(name), "typingSecond:%s", typingModel.method[method].shortName10);
+        reportPuts(pOut, ",");
+        reportCsvString(pOut, name);
+    }
+    for ( int c=0; c<256; c++ ) {
+        reportPrintf(pOut, ",c%02x", c);
+    }
+    reportPuts(pOut, "\n");
+}
+
+static void step15_printCsv(struct reportBuffer *pOut, char *kind, char *bookName, unsigned long long bytes, struct letterFrequency *pLf) {
+    unsigned long long v[RESULT_COUNTERS];
+    resultCounters(v, bytes, pLf);
+    calcTypingSeconds(pLf, &typingModel);
+    reportPuts(pOut, kind);
+    reportPuts(pOut, ",");
+    reportCsvString(pOut, bookName);
+    for ( int i=2; i<RESULT_COUNTERS; i++ ) {
+        reportPuts(pOut, ",");
+        reportU64(pOut, v[i]);
+    }
+    for ( int method=0; method<typingModel.methods; method++ ) {
+        reportPrintf(pOut, ",%.17g", pLf->typingMethod[method].typingSecondForBook);
+    }
+    for ( int c=0; c<256; c++ ) {
+        reportPuts(pOut, ",");
+        reportU64(pOut, pLf->c[c]);
+    }
+    reportPuts(pOut, "\n");
+}
+
+static void step15_printJson(struct reportBuffer *pOut, char *kind, char *bookName, unsigned long long bytes, struct letterFrequency *pLf) {
+    unsigned long long v[RESULT_COUNTERS];
+    resultCounters(v, bytes, pLf);
+    calcTypingSeconds(pLf, &typingModel);
+    reportPrintf(pOut, "{\"kind\":\"%s\",\"title\":", kind);
+    reportJsonString(pOut, bookName);
+    for ( int i=2; i<RESULT_COUNTERS; i++ ) {
+        reportPrintf(pOut, ",\"%s\":", resultCounterName[i]);
+        reportU64(pOut, v[i]);
+    }
+    reportPuts(pOut, ",\"typingSecond\":{");
+    for ( int method=0; method<typingModel.methods; method++ ) {
+        reportPuts(pOut, method ? ",": "");
+        reportJsonString(pOut, typingModel.method[method].shortName10);
+        reportPrintf(pOut, ":%.17g", pLf->typingMethod[method].typingSecondForBook);
+    }
+    reportPuts(pOut, "},\"c\":[");
+    for ( int c=0; c<256; c++ ) {
+        reportPuts(pOut, c ? ",": "");
+        reportU64(pOut, pLf->c[c]);
+    }
+    reportPuts(pOut, "]}\n");
+}
+
+/*
+    the row of a book to the spool of hlfcResult.bin (by one thread, in the book order)
+*/
+static void step16_spoolBinRow(char *bookName, unsigned long long bytes, struct letterFrequency *pLf) {
+    unsigned long long v[RESULT_COUNTERS];
+    unsigned char row[(RESULT_COUNTERS + MAX_TYPINGMETHOD + 256) * 8];
+    int len = 0;
+    if ( resultBin.spRows == NULL ) {
+        return;
+    }
+    resultCounters(v, bytes, pLf);
+    v[0] = resultBin.titleBytes;
+    v[1] = strlen(bookName);
+    calcTypingSeconds(pLf, &typingModel);
+    for ( int i=0; i<RESULT_COUNTERS; i++, len += 8 ) {
+        putU64le(&row[len], v[i]);
+    }
+    for ( int method=0; method<typingModel.methods; method++, len += 8 ) {
+        unsigned long long bits;
+        memcpy(&bits, &pLf->typingMethod[method].typingSecondForBook, sizeof(bits));
+        putU64le(&row[len], bits);
+    }
+    for ( int c=0; c<256; c++, len += 8 ) {
+        putU64le(&row[len], pLf->c[c]);
+    }
+    fwrite(row, 1, len, resultBin.spRows);
+    fwrite(bookName, 1, v[1], resultBin.spTitles);
+    resultBin.titleBytes += v[1];
+    resultBin.rows++;
+}
+
+/*
+    write hlfcResult.bin:  the header, the columns from the spooled rows, then the titles
+    return: false if the file is not able to write
+*/
+static int step16_writeBinResult(FILE *spOut) {
+    int columns = resultColumns();
+    unsigned long long dataOffset = 8 + 4 + 4 + 8 + 8 + 8 + (unsigned long long)columns * (RESULT_BIN_NAME_LEN + 4 + 4 + 8);
+    unsigned long long titlesOffset = dataOffset + (unsigned long long)columns * resultBin.rows * 8;
+    unsigned char *pChunk = malloc((size_t)RESULT_BIN_CHUNK * columns * 8);
+    unsigned char *pColumn = malloc(RESULT_BIN_CHUNK * 8);
+    char buf[64*1024];
+    size_t len;
+    int ok = pChunk && pColumn;
+    fwrite(RESULT_BIN_MAGIC, 1, sizeof(RESULT_BIN_MAGIC)-1, spOut);
+    fputU32le(RESULT_BIN_VERSION, spOut);
+    fputU32le(columns, spOut);
+    fputU64le(resultBin.rows, spOut);
+    fputU64le(titlesOffset, spOut);
+    fputU64le(resultBin.titleBytes, spOut);
+    for ( int k=0; k<columns; k++ ) {
+        char name[RESULT_BIN_NAME_LEN] = { 0 };
+        int type = RESULT_BIN_U64;
+        if ( k < RESULT_COUNTERS ) {
+            snprintf(name, sizeof(name), "%s", resultCounterName[k]);
+        } else if ( k < RESULT_COUNTERS + typingModel.methods ) {
+            snprintf(name, sizeof(name), "typingSecond:%s", typingModel.method[k - RESULT_COUNTERS].shortName10);
+            type = RESULT_BIN_F64;
+        } else {
+            snprintf(name, sizeof(name), "c%02x", k - RESULT_COUNTERS - typingModel.methods);
+        }
+        fwrite(name, 1, sizeof(name), spOut);
+        fputU32le(type, spOut);
+        fputU32le(0, spOut);
+        fputU64le(dataOffset + (unsigned long long)k * resultBin.rows * 8, spOut);
+    }
+    rewind(resultBin.spRows);
+    for ( unsigned long long top=0; ok && top<resultBin.rows; top+=RESULT_BIN_CHUNK ) {
+        size_t rows = (size_t)MIN(RESULT_BIN_CHUNK, resultBin.rows - top);
+        if ( fread(pChunk, (size_t)columns * 8, rows, resultBin.spRows) != rows ) {
+            ok = false;
+            break;
+        }
+        for ( int k=0; k<columns; k++ ) {       // the k-th value of each row is a part of the k-th column
+            for ( size_t r=0; r<rows; r++ ) {
+                memcpy(&pColumn[r*8], &pChunk[(r*columns + k)*8], 8);
+            }
+            ok = ok && fseekU64(spOut, dataOffset + ((unsigned long long)k * resultBin.rows + top) * 8)
+                    && fwrite(pColumn, 8, rows, spOut) == rows;
+        }
+    }
+    ok = ok && fseekU64(spOut, titlesOffset);
+    rewind(resultBin.spTitles);
+    while ( ok && (len = fread(buf, 1, sizeof(buf), resultBin.spTitles)) > 0 ) {
+        ok = fwrite(buf, 1, len, spOut) == len;
+    }
+    if ( !ok ) {
+        fprintf(stderr, "***Error line %d:  the binary result is not written\n", __LINE__);
+    }
+    free(pChunk);
+    free(pColumn);
+    return ok;
+}
+
+/*
+    Keyboard layout optimizer (--optimize)
+    which key should have áéíóőöúűü to make the typing time shortest for the books?
+    The familiar keyboard (KEYBOARD_LETTERS_JP) has some keys which the hungarian text seldom needs (OPTIMIZE_KEYS).
+    Each of them has OPTIMIZE_LAYERS slots:  the key itself, AltGr+key and dead key+key.
+    The hungarian letters and the symbols of these keys are put on the slots.  (uppercase is the same slot with Shift)
+    The cost is the same as step20_calcTypingSpeed():  sum of (count in the grand total) * (seconds of the slot),
+    a slot takes optimizeLayerStrokes[] key strokes of the fastest regular position of the typing methods (--typing-model).
+    The cost of a letter does not depend on the next letter (no bigram), so the best layout is exact by sorting:
+    the most frequent item on the fastest slot (rearrangement inequality).  Same count or same speed:  the table order.
+    The best layout becomes a new typing method "Optimized", so step20/step21 print its hours for every book.
+*/
+#define OPTIMIZE_KEYS           "@[];:^\\`"                // keys of the familiar keyboard, which the hungarian text seldom needs
+#define OPTIMIZE_LAYERS         3                           // the key, AltGr+key, dead key+key
+#define OPTIMIZE_SLOTS          (((int)sizeof(OPTIMIZE_KEYS)-1) * OPTIMIZE_LAYERS)
+static const double optimizeLayerStrokes[OPTIMIZE_LAYERS] = {
+    1.,                                                     // the key
+    1.5,                                                    // AltGr+key:  2 keys at the same time
+    2.                                                      // dead key then the key:  2 key strokes (same as the shortcut key)
+};
+static const char *optimizeLayerName[OPTIMIZE_LAYERS] = { "key", "AltGr", "dead key" };
+
+struct layoutModel {
+    int items;                                      // number of items (letter or symbol) to be put on the slots
+    unsigned char item[OPTIMIZE_SLOTS];             // CP1250 letter of each item
+    double weight[OPTIMIZE_SLOTS];                  // count of each item in the grand total.  0 for the empty item
+    double slotSpeed[OPTIMIZE_SLOTS];               // seconds to type a letter on each slot
+};
+
+static struct layoutResult {
+    bool done;
+    int slotItem[OPTIMIZE_SLOTS];                   // item index on each slot
+    struct layoutModel model;
+} layout = { false };
+
+/*
+    seconds of a key stroke:  the fastest regular position of the typing methods
+*/
+static double layoutStrokeSecond() {
+    double second = typingModel.method[0].regularPosition.typeSpeed;
+    for ( int i=1; i<typingModel.methods; i++ ) {
+        if ( typingModel.method[i].regularPosition.typeSpeed < second ) {
+            second = typingModel.method[i].regularPosition.typeSpeed;
+        }
+    }
+    return second;
+}
+
+/*
+    search the best layout for the grand total, then add it as a typing method
+    Input:  pLf:    letter frequency of the grand total
+*/
+static void step25_optimizeLayout(struct letterFrequency *pLf) {
+    struct layoutModel *pModel = &layout.model;
+    const char *keys = OPTIMIZE_KEYS;
+    const char *letters = HUNGARIAN_LOWERLETTERS;
+    const double stroke = layoutStrokeSecond();
+    int heavier[OPTIMIZE_SLOTS];                    // item index, more frequent first
+    int faster[OPTIMIZE_SLOTS];                     // slot index, faster first
+
+    if ( typingModel.methods >= MAX_TYPINGMETHOD ) {
+        fprintf(stderr, "***Error line %d:  too many typing methods to add the optimized layout\n", __LINE__);
+        return;
+    }
+    memset(pModel, 0, sizeof(*pModel));
+    for ( int i=0; letters[i]; i++ ) {              // the hungarian letters and the symbols of the keys are the items
+        pModel->item[pModel->items++] = (unsigned char)letters[i];
+    }
+    for ( int i=0; keys[i]; i++ ) {
+        pModel->item[pModel->items++] = (unsigned char)keys[i];
+    }
+    for ( int i=0; i<OPTIMIZE_SLOTS; i++ ) {
+        pModel->weight[i] = i < pModel->items ? (double)pLf->c[toupper1250(pModel->item[i])]: 0.;
+        pModel->slotSpeed[i] = stroke * optimizeLayerStrokes[i / (sizeof(OPTIMIZE_KEYS)-1)];
+    }
+    for ( int i=0; i<OPTIMIZE_SLOTS; i++ ) {        // insertion sort (stable), the tables are small
+        int j;
+        for ( j=i; j>0 && pModel->weight[heavier[j-1]] < pModel->weight[i]; j-- ) {
+            heavier[j] = heavier[j-1];
+        }
+        heavier[j] = i;
+        for ( j=i; j>0 && pModel->slotSpeed[faster[j-1]] > pModel->slotSpeed[i]; j-- ) {
+            faster[j] = faster[j-1];
+        }
+        faster[j] = i;
+    }
+    for ( int i=0; i<OPTIMIZE_SLOTS; i++ ) {
+        layout.slotItem[faster[i]] = heavier[i];
+    }
+
+    // the optimized layout as a typing method:  the familiar keyboard and the shortcut key for the other letters
+    struct typingMethod *pM = &typingModel.method[typingModel.methods++];
+    memset(pM, 0, sizeof(*pM));
+    pM->shortName10 = "Optimized";
+    pM->name = "Optimized keyboard layout (--optimize)";
+    strcpy(pM->regularPosition.letter, KEYBOARD_LETTERS_JP);
+    pM->regularPosition.typeSpeed = stroke;
+    pM->unregularPosition.typeSpeed = stroke * optimizeLayerStrokes[OPTIMIZE_LAYERS-1];
+    compileTypingMethod(pM);
+    for ( int s=0; s<OPTIMIZE_SLOTS; s++ ) {
+        if ( layout.slotItem[s] < pModel->items ) {
+            int upper = toupper1250(pModel->item[layout.slotItem[s]]);
+            for ( int i=0; i<sizeof(pM->cost)/sizeof(pM->cost[0]); i++ ) {
+                if ( toupper1250(i) == upper ) {
+                    pM->cost[i] = pModel->slotSpeed[s];
+                }
+            }
+        }
+    }
+    layout.done = true;
+}
+
+/*
+    print the optimized layout
+*/
+static void printLayout() {
+    const char *keys = OPTIMIZE_KEYS;
+    const int numOfKeys = sizeof(OPTIMIZE_KEYS)-1;
+    fprintf(spOutputFile, "  Optimized layout (--optimize)                 : %.3lf sec/key stroke\n", layout.model.slotSpeed[0]);
+    for ( int k=0; k<numOfKeys; k++ ) {
+        fprintf(spOutputFile, "    %s ", toPrintableChar1250(keys[k]));   // 1 letter, so the columns are same
+        for ( int l=0; l<OPTIMIZE_LAYERS; l++ ) {
+            int item = layout.slotItem[l*numOfKeys + k];
+            fprintf(spOutputFile, "   %s: %s", optimizeLayerName[l],
+                item < layout.model.items ? toPrintableChar1250(layout.model.item[item]): "-");
+        }
+        fprintf(spOutputFile, "\n");
+    }
+}
+
+/*
+    print the n-gram report (--ngram)
+    top K bigrams and trigrams (only letters), then the hungarian letters counted as graphemes:
+    cs dz dzs gy ly ny sz ty zs are one letter, so e.g. the S of SZ is not counted as S.
+    the graphemes are made from the counts:  DZ and ZS do not include DZS, a letter does not include its graphemes.
+    NOTE:   the overlapped form (e.g. "szs") and the long form (e.g. "ssz" = sz+sz) are not separated.
+*/
+#define NGRAM_GRAPHEMES     "A", "\xc1", "B", "C", "CS", "D", "DZ", "DZS", "E", "\xc9", "F", "G", "GY", "H", "I", "\xcd", "J", "K", "L", "LY", \
+                            "M", "N", "NY", "O", "\xd3", "\xd6", "\xd5", "P", "Q", "R", "S", "SZ", "T", "TY", "U", "\xda", "\xdc", "\xdb", "V", "W", \
+                            "X", "Y", "Z", "ZS"
+struct ngramRank {
+    unsigned int key;
+    unsigned long long count;
+};
+
+static int compareNgramRank(const void *a, const void *b) {
+    const struct ngramRank *pA = a;
+    const struct ngramRank *pB = b;
+    if ( pA->count != pB->count ) {
+        return pA->count < pB->count ? 1: -1;       // larger first
+    }
+    return pA->key < pB->key ? -1: (pA->key > pB->key);
+}
+
+/*
+    count of a grapheme (1 to 3 letters, uppercase)
+*/
+static unsigned long long ngramGraphemeCount(const struct ngramFrequency *pN, const struct letterFrequency *pLf, const unsigned char *g) {
+    int len = (int)strlen((const char *)g);
+    if ( len == 1 ) {
+        return pLf->c[g[0]];
+    } else if ( len == 2 ) {
+        return findNgramEntry(pN, NGRAM_KEY_BIGRAM | (g[0] << 8) | g[1]);
+    }
+    return findNgramEntry(pN, NGRAM_KEY_TRIGRAM | NGRAM_TRIGRAM_INDEX(g[0], g[1], g[2]));
+}
+
+static void step13_printNgram(struct ngramFrequency *pN, struct letterFrequency *pLf) {
+    const char *graphemes[] = { NGRAM_GRAPHEMES };
+    const int numOfGraphemes = sizeof(graphemes)/sizeof(graphemes[0]);
+    long long graphemeCount[sizeof(graphemes)/sizeof(graphemes[0])];
+    struct ngramRank *pBigram = malloc(sizeof(struct ngramRank) * (pN->entries + 1));
+    struct ngramRank *pTrigram = malloc(sizeof(struct ngramRank) * (pN->entries + 1));
+    struct ngramRank graphemeRank[sizeof(graphemes)/sizeof(graphemes[0])];
+    int bigrams = 0, trigrams = 0;
+    unsigned long long bigramTotal = 0, trigramTotal = 0, graphemeTotal = 0;
+
+    if ( pBigram == NULL || pTrigram == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        free(pBigram);
+        free(pTrigram);
+        return;
+    }
+    // step 1. n-grams of the letters, larger first
+    for ( unsigned int i=0; i<pN->size; i++ ) {
+        const struct ngramEntry *pE = &pN->entry[i];
+        unsigned int idx = pE->key & NGRAM_KEY_INDEX;
+        if ( pE->count == 0 ) {
+            continue;
+        } else if ( (pE->key & ~NGRAM_KEY_INDEX) == NGRAM_KEY_BIGRAM && isalpha1250(idx >> 8) && isalpha1250(idx & 0xff) ) {
+            pBigram[bigrams].key = idx;
+            pBigram[bigrams++].count = pE->count;
+            bigramTotal += pE->count;
+        } else if ( (pE->key & ~NGRAM_KEY_INDEX) == NGRAM_KEY_TRIGRAM ) {
+            pTrigram[trigrams].key = idx;
+            pTrigram[trigrams++].count = pE->count;
+            trigramTotal += pE->count;
+        }
+    }
+    qsort(pBigram, bigrams, sizeof(pBigram[0]), compareNgramRank);
+    qsort(pTrigram, trigrams, sizeof(pTrigram[0]), compareNgramRank);
+    fprintf(spOutputFile, "[N-gram]  (case folded, only letters)\n");
+    fprintf(spOutputFile, "  rank  bigram      count            trigram      count\n");
+    for ( int i=0; i<option.ngramTop && (i<bigrams || i<trigrams); i++ ) {
+        char str[32];
+        fprintf(spOutputFile, "  %4d  ", i+1);
+        if ( i < bigrams ) {
+            unsigned char letters[2] = { pBigram[i].key >> 8, pBigram[i].key & 0xff };
+            fprintf(spOutputFile, "%s    %9llu (%4.1lf%%)", ngramToPrintable(letters, 2, str, sizeof(str)),
+                pBigram[i].count, 100.*pBigram[i].count/bigramTotal);
+        } else {
+            fprintf(spOutputFile, "%26s", "");
+        }
+        if ( i < trigrams ) {
+            unsigned char letters[3] = {
+                ngramIdxLetter[pTrigram[i].key / (NGRAM_LETTERS*NGRAM_LETTERS)],
+                ngramIdxLetter[pTrigram[i].key / NGRAM_LETTERS % NGRAM_LETTERS],
+                ngramIdxLetter[pTrigram[i].key % NGRAM_LETTERS]
+            };
+            fprintf(spOutputFile, "     %s    %9llu (%4.1lf%%)", ngramToPrintable(letters, 3, str, sizeof(str)),
+                pTrigram[i].count, 100.*pTrigram[i].count/trigramTotal);
+        }
+        fprintf(spOutputFile, "\n");
+    }
+    free(pBigram);
+    free(pTrigram);
+
+    // step 2. graphemes:  the longer grapheme is taken from the shorter graphemes which are in it
+    for ( int g=0; g<numOfGraphemes; g++ ) {
+        graphemeCount[g] = (long long)ngramGraphemeCount(pN, pLf, (const unsigned char *)graphemes[g]);
+    }
+    for ( int len=3; len>1; len-- ) {               // DZS first, then the 2 letters graphemes
+        for ( int g=0; g<numOfGraphemes; g++ ) {
+            if ( strlen(graphemes[g]) != len ) {
+                continue;
+            }
+            for ( int s=0; s<numOfGraphemes; s++ ) {
+                if ( strlen(graphemes[s]) < len ) {
+                    for ( const char *p = graphemes[g]; (p = strstr(p, graphemes[s])) != NULL; p++ ) {
+                        graphemeCount[s] -= graphemeCount[g];
+                    }
+                }
+            }
+        }
+    }
+    for ( int g=0; g<numOfGraphemes; g++ ) {
+        graphemeRank[g].key = g;
+        graphemeRank[g].count = graphemeCount[g] > 0 ? graphemeCount[g]: 0;
+        graphemeTotal += graphemeRank[g].count;
+    }
+    qsort(graphemeRank, numOfGraphemes, sizeof(graphemeRank[0]), compareNgramRank);
+    fprintf(spOutputFile, "[Hungarian letters]  (cs dz dzs gy ly ny sz ty zs are one letter)\n");
+    for ( int g=0; g<numOfGraphemes; g++ ) {
+        char str[32];
+        const char *grapheme = graphemes[graphemeRank[g].key];
+        fprintf(spOutputFile, "%s  %s%*s %9llu (%4.1lf%%)", (g % 4) ? " ": "", 
+            ngramToPrintable((const unsigned char *)grapheme, (int)strlen(grapheme), str, sizeof(str)), 3 - (int)strlen(grapheme), "",
+            graphemeRank[g].count, graphemeTotal ? 100.*graphemeRank[g].count/graphemeTotal: 0.);
+        if ( g % 4 == 3 || g == numOfGraphemes-1 ) {
+            fprintf(spOutputFile, "\n");
+        }
+    }
+}
+
+static void step30_printConfiguration() {
+    fprintf(spOutputFile, "-----------------------------------------------------------------------------------\n" );
+    fprintf(spOutputFile, "[Configuration]\n" );
+    if ( typingModel.fname == NULL ) {        // built-in typing model
+        fprintf(spOutputFile, "  Typing Speed (same as familiar keyboard       : % 6.1lf [wpm] (%lf sec/letter)\n", 60./TYPINGSPEED_REGULARPOS/typingModel.lettersPerWord, TYPINGSPEED_REGULARPOS);
+        fprintf(spOutputFile, "  Typing Speed (different from familiar keyboard: % 6.1lf [wpm] (%lf sec/letter)\n", 60./TYPINGSPEED_UNREGULARPOS/typingModel.lettersPerWord, TYPINGSPEED_UNREGULARPOS);
+        fprintf(spOutputFile, "  Typing Speed (using mouse back to the keyboard: % 6.1lf [wpm] (%lf sec/letter)\n", 60./TYPINGSPEED_MOUSE/typingModel.lettersPerWord, TYPINGSPEED_MOUSE);
+    } else {
+        fprintf(spOutputFile, "  Typing model file                             : %s\n", typingModel.fname );
+        for ( int i=0; i<typingModel.methods; i++ ) {
+            fprintf(spOutputFile, "  %-10s (regular / other letters)       : % 6.1lf / % 6.1lf [wpm] (%lf / %lf sec/letter)\n",
+                typingModel.method[i].shortName10,
+                60./typingModel.method[i].regularPosition.typeSpeed/typingModel.lettersPerWord,
+                60./typingModel.method[i].unregularPosition.typeSpeed/typingModel.lettersPerWord,
+                typingModel.method[i].regularPosition.typeSpeed, typingModel.method[i].unregularPosition.typeSpeed);
+        }
+    }
+    fprintf(spOutputFile, "  Hungarian business days in a year, 2022       : % 4d   [days]\n", typingModel.daysInYear );
+    fprintf(spOutputFile, "  Business typing hours in a day                : % 4d   [hours]\n", typingModel.typingHours );
+    fprintf(spOutputFile, "  wpm:  word per minute (common sense)          : % 4d   [letters]\n", typingModel.lettersPerWord );
+    if ( grandTotal.lf.lettersPerWord > 0. ) {
+        fprintf(spOutputFile, "  wpm:  word per minute (measured by --words)   : % 6.1lf [letters]  (each book uses its own)\n", grandTotal.lf.lettersPerWord );
+    }
+    if ( layout.done ) {
+        printLayout();
+    }
+}
+
+/*
+    Histogram cache
+    the raw histogram of each book is kept in CACHEFILE, keyed by the title (path), file size, last modified time
+    and --encoding.  An unchanged book is not counted again, the letter frequency is made from the cached histogram.
+    The content hash is kept too, to check the cache by --cache-check.
+    File:   CACHE_MAGIC, version(u32), number of entries(u32), then each entry is
+            title length(u32), title(UTF-8), fileSize(u64), mtime(u64), requested encoding(u32, --encoding),
+            detected encoding(u32), hash(u64), bytes(u64), raw[256](u64)
+            all numbers are little endian
+*/
+#define CACHE_MAGIC     "HLFCCACH"
+#define CACHE_VERSION   4                           // change it when the counting rule is changed
+#define CACHE_OFF       0                           // no cache
+#define CACHE_USE       1                           // --cache:          use the cache for unchanged books
+#define CACHE_CHECK     2                           // --cache-check:    count every book again and compare with the cache
+#define CACHE_REBUILD   3                           // --cache-rebuild:  ignore the cache, count every book
+
+struct cacheEntry {
+    char *bookTitle;
+    unsigned long long fileSize;
+    unsigned long long mtime;
+    unsigned int requested;                         // --encoding of the count:  the other --encoding counts again
+    unsigned int encoding;                          // encoding of the book, detected by --encoding auto
+    unsigned long long hash;
+    unsigned long long bytes;
+    unsigned long long raw[256];
+};
+
+static struct histogramCache {
+    struct cacheEntry *pEntry;                      // sorted by the title
+    int entries;
+} cache = { 0 };
+
+static int compareCacheEntry(const void *a, const void *b) {
+    return strcmp(((const struct cacheEntry *)a)->bookTitle, ((const struct cacheEntry *)b)->bookTitle);
+}
+
+/*
+    read the cache file
+    return: number of entries
+*/
+static int readCacheFile(char *fname, struct histogramCache *pCache) {
+    FILE *spIn;
+    char magic[sizeof(CACHE_MAGIC)-1];
+    unsigned int version, entries, titleLen;
+
+    memset(pCache, 0, sizeof(*pCache));
+    if ( (spIn=fopenUtf8(fname, "rb")) == NULL ) {
+        return 0;                                   // no cache yet
+    }
+    if ( fread(magic, 1, sizeof(magic), spIn) != sizeof(magic) || memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0
+      || !fgetU32le(&version, spIn) || version != CACHE_VERSION || !fgetU32le(&entries, spIn)
+      || (pCache->pEntry = calloc(entries ? entries: 1, sizeof(struct cacheEntry))) == NULL ) {
+        fprintf(stderr, "***Error line %d:  cache file is old or broken, ignored:  %s\n", __LINE__, fname);
+        fclose(spIn);
+        return 0;
+    }
+    for ( ; pCache->entries<(int)entries; pCache->entries++ ) {
+        struct cacheEntry *pE = &pCache->pEntry[pCache->entries];
+        bool ok = fgetU32le(&titleLen, spIn) && titleLen < 65536 && (pE->bookTitle = malloc(titleLen+1)) != NULL
+               && fread(pE->bookTitle, 1, titleLen, spIn) == titleLen
+               && fgetU64le(&pE->fileSize, spIn) && fgetU64le(&pE->mtime, spIn)
+               && fgetU32le(&pE->requested, spIn) && fgetU32le(&pE->encoding, spIn) && pE->encoding < ENCODINGS
+               && fgetU64le(&pE->hash, spIn) && fgetU64le(&pE->bytes, spIn);
+        for ( int c=0; ok && c<256; c++ ) {
+            ok = fgetU64le(&pE->raw[c], spIn);
+        }
+        if ( !ok ) {
+            fprintf(stderr, "***Error line %d:  cache file is broken, the rest is ignored:  %s\n", __LINE__, fname);
+            free(pE->bookTitle);
+            break;
+        }
+        pE->bookTitle[titleLen] = '\0';
+    }
+    fclose(spIn);
+    qsort(pCache->pEntry, pCache->entries, sizeof(struct cacheEntry), compareCacheEntry);
+    return pCache->entries;
+}
+
+static struct cacheEntry *findCacheEntry(struct histogramCache *pCache, char *bookTitle) {
+    struct cacheEntry key;
+    if ( pCache->entries == 0 ) {
+        return NULL;
+    }
+    key.bookTitle = bookTitle;
+    return bsearch(&key, pCache->pEntry, pCache->entries, sizeof(struct cacheEntry), compareCacheEntry);
+}
+
+/*
+    get the letter frequency of the unchanged books from the cache
+    Input:  fname:  cache file name
+            pBf:    pointer of the top of bookFrequency table[]
+            books:  number of books
+    Ouput:  pBf[i].cached = true, and the letter frequency, if the book is not changed
+    return: number of the books from the cache
+*/
+static int step04_readCache(char *fname, struct histogramCache *pCache, struct bookFrequency *pBf, int books) {
+    int cached = 0;
+    if ( option.cache != CACHE_REBUILD ) {
+        readCacheFile(fname, pCache);
+    }
+    for ( int i=0; i<books; i++ ) {
+        struct cacheEntry *pE;
+        pBf[i].fileSize = getFileInfo(pBf[i].bookTitle, &pBf[i].mtime);     // before counting, a change while counting is found next time
+        if ( option.cache == CACHE_USE && pBf[i].mtime && !option.ngram && !option.words   // n-gram and words are not in the cache
+          && (pE = findCacheEntry(pCache, pBf[i].bookTitle)) != NULL
+          && pE->fileSize == pBf[i].fileSize && pE->mtime == pBf[i].mtime && pE->requested == option.encoding ) {
+            memcpy(pBf[i].lf.raw, pE->raw, sizeof(pBf[i].lf.raw));
+            calcLfFromHistogram(&pBf[i].lf);
+            pBf[i].bytes = pE->bytes;
+            pBf[i].offset = pE->fileSize;
+            pBf[i].hash = pE->hash;
+            pBf[i].encoding = (int)pE->encoding;
+            pBf[i].cached = true;
+            cached++;
+        }
+    }
+    return cached;
+}
+
+/*
+    write the cache file for the books in the book list
+    --cache-check:  compare the counted books with the cache, and report the wrong entries
+*/
+static void step40_writeCache(char *fname, struct histogramCache *pCache, struct bookFrequency *pBf, int books) {
+    FILE *spOut;
+    char tmpFName[512];
+    unsigned int entries = 0;
+
+    if ( option.cache == CACHE_CHECK ) {
+        int checked = 0, wrong = 0;
+        for ( int i=0; i<books; i++ ) {
+            struct cacheEntry *pE = findCacheEntry(pCache, pBf[i].bookTitle);
+            if ( pE && pE->fileSize == pBf[i].fileSize && pE->mtime == pBf[i].mtime && pE->requested == option.encoding ) {
+                checked++;
+                if ( pE->hash != pBf[i].hash || memcmp(pE->raw, pBf[i].lf.raw, sizeof(pE->raw)) != 0 ) {
+                    fprintf(stderr, "***Warning:  cache was wrong (changed without the time stamp):  %s\n", pBf[i].bookTitle);
+                    wrong++;
+                }
+            }
+        }
+        fprintf(stderr, "Cache check:  %d books checked, %d wrong\n", checked, wrong);
+    }
+    snprintf(tmpFName, sizeof(tmpFName), "%s.tmp", fname);
+    if ( (spOut=fopenUtf8(tmpFName, "wb")) == NULL ) {
+        fprintf(stderr, "***Error line %d:  file write open error:  %s\n", __LINE__, tmpFName);
+        return;
+    }
+    for ( int i=0; i<books; i++ ) {
+        entries += (pBf[i].mtime != 0);
+    }
+    fwrite(CACHE_MAGIC, 1, sizeof(CACHE_MAGIC)-1, spOut);
+    fputU32le(CACHE_VERSION, spOut);
+    fputU32le(entries, spOut);
+    for ( int i=0; i<books; i++ ) {
+        if ( pBf[i].mtime == 0 ) {                  // not a file (e.g. pipe, not found)
+            continue;
+        }
+        fputU32le((unsigned int)strlen(pBf[i].bookTitle), spOut);
+        fwrite(pBf[i].bookTitle, 1, strlen(pBf[i].bookTitle), spOut);
+        fputU64le(pBf[i].fileSize, spOut);
+        fputU64le(pBf[i].mtime, spOut);
+        fputU32le((unsigned int)option.encoding, spOut);
+        fputU32le((unsigned int)pBf[i].encoding, spOut);
+        fputU64le(pBf[i].hash, spOut);
+        fputU64le(pBf[i].bytes, spOut);
+        for ( int c=0; c<256; c++ ) {
+            fputU64le(pBf[i].lf.raw[c], spOut);
+        }
+    }
+    if ( fclose(spOut) != 0 ) {
+        fprintf(stderr, "***Error line %d:  file write error:  %s\n", __LINE__, tmpFName);
+        remove(tmpFName);
+        return;
+    }
+    remove(fname);                                  // rename() of Windows does not overwrite
+    if ( rename(tmpFName, fname) != 0 ) {
+        fprintf(stderr, "***Error line %d:  file rename error:  %s\n", __LINE__, fname);
+    }
+}
+
+/*
+    memory free for step04_readCache
+*/
+static void terminate04_readCache(struct histogramCache *pCache) {
+    for ( int i=0; i<pCache->entries; i++ ) {
+        free(pCache->pEntry[i].bookTitle);
+    }
+    free(pCache->pEntry);
+    memset(pCache, 0, sizeof(*pCache));
+}
+
+/*
+    Partial result (--shard i/N, --partial FILE) and merge (hlfc merge FILE ...)
+    A run writes the histogram of each book to the partial result file.  The merge reads the files of the shards,
+    and prints the report of every book.  The letter frequency, the typing time and the business hours are made
+    from the merged histograms, so the result is the same as the run of all the books by one process.
+    --shard i/N:    the book at the position k of the book list (0, 1, 2, ... of every source) is counted by the shard
+                    k % N + 1.  The books of the other shards are not opened.
+    File:   PARTIAL_MAGIC, version(u32), CACHE_VERSION(u32, the counting rule), shard(u32), shards(u32), books(u64),
+            then each book is
+            position(u64), title length(u32), title(UTF-8), bytes(u64), raw[256](u64)
+            then the raw[256](u64) of the grand total of the shard.  All numbers are little endian.
+    NOTE:   n-grams and words are not in the partial result, so --ngram and --words are not used with them.
+*/
+#define PARTIAL_MAGIC       "HLFCPART"
+#define PARTIAL_VERSION     1
+#define PARTIAL_FNAME       (PROGNAME "Part%dof%d.bin")     // partial result file of --shard i/N, without --partial
+#define PARTIAL_BOOKS_AT    (8+4+4+4+4)                     // file offset of books(u64), written by closing the file
+
+struct partialFile {
+    FILE *fp;
+    char *fname;
+    unsigned int shard;                             // 1 .. shards
+    unsigned int shards;
+    unsigned long long books;                       // books in the file (written:  books written)
+    unsigned long long read;                        // merge:  books already read
+    bool current;                                   // merge:  true if the following is the current book
+    bool broken;                                    // merge:  the file is not able to read
+    unsigned long long position;                    // merge:  the current book
+    char *title;
+    unsigned int titleSize;
+    unsigned long long bytes;
+    unsigned long long raw[256];
+};
+
+static struct partialFile partialOut = { NULL };
+
+/*
+    create the partial result file, the books are written by step17_writePartialBook() in the book list order
+*/
+static int step17_openPartial(char *fname) {
+    memset(&partialOut, 0, sizeof(partialOut));
+    if ( (partialOut.fp = fopenUtf8(fname, "wb")) == NULL ) {
+        fprintf(stderr, "***Error line %d:  file write open error:  %s\n", __LINE__, fname);
+        return false;
+    }
+    partialOut.fname = fname;
+    partialOut.shard = option.shard;
+    partialOut.shards = option.shards;
+    fwrite(PARTIAL_MAGIC, 1, sizeof(PARTIAL_MAGIC)-1, partialOut.fp);
+    fputU32le(PARTIAL_VERSION, partialOut.fp);
+    fputU32le(CACHE_VERSION, partialOut.fp);
+    fputU32le(partialOut.shard, partialOut.fp);
+    fputU32le(partialOut.shards, partialOut.fp);
+    fputU64le(0, partialOut.fp);                    // books:  not known yet
+    return true;
+}
+
+static void step17_writePartialBook(struct bookFrequency *pBf) {
+    unsigned char buf[8 + 256*8];
+    unsigned int len = (unsigned int)strlen(pBf->bookTitle);
+    if ( partialOut.fp == NULL ) {
+        return;
+    }
+    fputU64le(partialOut.books * partialOut.shards + partialOut.shard - 1, partialOut.fp);   // position in the book list
+    fputU32le(len, partialOut.fp);
+    fwrite(pBf->bookTitle, 1, len, partialOut.fp);
+    putU64le(buf, pBf->bytes);
+    for ( int c=0; c<256; c++ ) {
+        putU64le(&buf[8 + c*8], pBf->lf.raw[c]);
+    }
+    fwrite(buf, 1, sizeof(buf), partialOut.fp);
+    partialOut.books++;
+}
+
+static void step17_closePartial(struct letterFrequency *pGt) {
+    int ok;
+    if ( partialOut.fp == NULL ) {
+        return;
+    }
+    for ( int c=0; c<256; c++ ) {
+        fputU64le(pGt->raw[c], partialOut.fp);
+    }
+    ok = fseekU64(partialOut.fp, PARTIAL_BOOKS_AT);
+    fputU64le(partialOut.books, partialOut.fp);
+    if ( fclose(partialOut.fp) != 0 || !ok ) {
+        fprintf(stderr, "***Error line %d:  file write error:  %s\n", __LINE__, partialOut.fname);
+    }
+    partialOut.fp = NULL;
+}
+
+/*
+    read the next book of the partial result file to pP
+    return: false at the end of the books (or a broken file)
+*/
+static int readPartialBook(struct partialFile *pP) {
+    unsigned int len;
+    pP->current = false;
+    if ( pP->read == pP->books || pP->broken ) {
+        return false;
+    }
+    pP->broken = true;
+    if ( !fgetU64le(&pP->position, pP->fp) || !fgetU32le(&len, pP->fp) ) {
+        fprintf(stderr, "***Error line %d:  broken partial result:  %s\n", __LINE__, pP->fname);
+        return false;
+    }
+    if ( len + 1 > pP->titleSize ) {
+        char *pNew = realloc(pP->title, len + 1);
+        if ( pNew == NULL ) {
+            fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+            return false;
+        }
+        pP->title = pNew;
+        pP->titleSize = len + 1;
+    }
+    if ( fread(pP->title, 1, len, pP->fp) != len || !fgetU64le(&pP->bytes, pP->fp) ) {
+        fprintf(stderr, "***Error line %d:  broken partial result:  %s\n", __LINE__, pP->fname);
+        return false;
+    }
+    pP->title[len] = '\0';
+    for ( int c=0; c<256; c++ ) {
+        if ( !fgetU64le(&pP->raw[c], pP->fp) ) {
+            fprintf(stderr, "***Error line %d:  broken partial result:  %s\n", __LINE__, pP->fname);
+            return false;
+        }
+    }
+    pP->read++;
+    pP->broken = false;
+    pP->current = true;
+    return true;
+}
+
+/*
+    open a partial result file and read the header
+*/
+static int openPartial(struct partialFile *pP, char *fname) {
+    char magic[sizeof(PARTIAL_MAGIC)-1];
+    unsigned int version, rule;
+    memset(pP, 0, sizeof(*pP));
+    pP->fname = fname;
+    if ( (pP->fp = fopenUtf8(fname, "rb")) == NULL ) {
+        fprintf(stderr, "***Error line %d:  file read open error:  %s\n", __LINE__, fname);
+        return false;
+    }
+    if ( fread(magic, 1, sizeof(magic), pP->fp) != sizeof(magic) || memcmp(magic, PARTIAL_MAGIC, sizeof(magic)) != 0
+      || !fgetU32le(&version, pP->fp) || version != PARTIAL_VERSION || !fgetU32le(&rule, pP->fp)
+      || !fgetU32le(&pP->shard, pP->fp) || !fgetU32le(&pP->shards, pP->fp) || !fgetU64le(&pP->books, pP->fp) ) {
+        fprintf(stderr, "***Error line %d:  not a partial result of this version:  %s\n", __LINE__, fname);
+        return false;
+    }
+    if ( rule != CACHE_VERSION ) {
+        fprintf(stderr, "***Error line %d:  counted by the other counting rule (%u):  %s\n", __LINE__, rule, fname);
+        return false;
+    }
+    return true;
+}
+
+/*
+    hlfc merge:  read the partial result files (option.sources) to the book table, in the book list order
+    the books of the shards are merged by the position.  Each book has the letter frequency from its histogram,
+    and is added to the grand total.
+    return: number of the books, -1 if the files are wrong
+*/
+static int step06_readPartials(struct bookTable *pT) {
+    struct partialFile *pPart = calloc(MAX(1, option.numOfSources), sizeof(struct partialFile));
+    unsigned long long shardTotal[256] = { 0 };
+    int files = option.numOfSources;
+    int books = 0;
+    int ok = pPart != NULL;
+    for ( int i=0; ok && i<files; i++ ) {
+        ok = openPartial(&pPart[i], option.sources[i].name);
+        for ( int j=0; ok && j<i; j++ ) {
+            if ( pPart[j].shards != pPart[i].shards ) {
+                fprintf(stderr, "***Error line %d:  %s (shard %u/%u) is not a shard of the run of %s (shard %u/%u)\n", __LINE__,
+                    pPart[i].fname, pPart[i].shard, pPart[i].shards, pPart[j].fname, pPart[j].shard, pPart[j].shards);
+                ok = false;
+            } else if ( pPart[j].shard == pPart[i].shard ) {
+                fprintf(stderr, "***Error line %d:  shard %u/%u is given twice:  %s, %s\n", __LINE__,
+                    pPart[i].shard, pPart[i].shards, pPart[j].fname, pPart[i].fname);
+                ok = false;
+            }
+        }
+        if ( ok ) {
+            readPartialBook(&pPart[i]);                     // the first book
+        }
+    }
+    if ( ok && files && files != (int)pPart[0].shards ) {
+        fprintf(stderr, "Merge:  %d of %u shards\n", files, pPart[0].shards);
+    }
+    while ( ok ) {
+        struct bookFrequency *pBf;
+        int next = -1;
+        for ( int i=0; i<files; i++ ) {                     // the smallest position is the next book
+            if ( !pPart[i].current ) {
+                continue;
+            }
+            if ( next >= 0 && pPart[i].position == pPart[next].position ) {
+                fprintf(stderr, "***Error line %d:  the book %llu is in %s and %s\n", __LINE__, pPart[i].position, pPart[next].fname, pPart[i].fname);
+                ok = false;
+            }
+            if ( next < 0 || pPart[i].position < pPart[next].position ) {
+                next = i;
+            }
+        }
+        if ( next < 0 || !ok ) {
+            break;
+        }
+        if ( !addBook(pT, pPart[next].title) ) {
+            ok = false;
+            break;
+        }
+        pBf = &pT->pBf[pT->books - 1];
+        memcpy(pBf->lf.raw, pPart[next].raw, sizeof(pBf->lf.raw));
+        calcLfFromHistogram(&pBf->lf);
+        pBf->bytes = pBf->offset = pPart[next].bytes;
+        addLf(&grandTotal.lf, &pBf->lf);
+        books++;
+        readPartialBook(&pPart[next]);
+    }
+    for ( int i=0; ok && i<files; i++ ) {
+        ok = !pPart[i].broken;
+    }
+    for ( int i=0; ok && i<files; i++ ) {                   // the grand total of each shard is the check of the file
+        for ( int c=0; c<256; c++ ) {
+            unsigned long long v = 0;
+            ok = fgetU64le(&v, pPart[i].fp);
+            shardTotal[c] += v;
+        }
+    }
+    if ( ok && memcmp(shardTotal, grandTotal.lf.raw, sizeof(shardTotal)) != 0 ) {
+        fprintf(stderr, "***Error line %d:  the grand total of the shards is not the sum of the books\n", __LINE__);
+        ok = false;
+    }
+    for ( int i=0; pPart && i<files; i++ ) {
+        if ( pPart[i].fp ) {
+            fclose(pPart[i].fp);
+        }
+        free(pPart[i].title);
+    }
+    free(pPart);
+    return ok ? books: -1;
+}
+
+/*
+    hlfc query:  a range of the book is a book of the report, added to the grand total
+*/
+static int queryRange(struct bookTable *pT, struct bookIndex *pI, struct bookReader *pR, char *bookTitle,
+                      unsigned long long from, unsigned long long to) {
+    unsigned long long top[256], end[256];
+    char title[FILENAME_MAX + 64];
+    struct bookFrequency *pBf;
+    if ( !indexPosition(pI, pR, from, top) || !indexPosition(pI, pR, to, end) ) {
+        return false;
+    }
+    snprintf(title, sizeof(title), "%s [%llu-%llu]", bookTitle, from, to);
+    if ( !addBook(pT, title) ) {
+        return false;
+    }
+    pBf = &pT->pBf[pT->books - 1];
+    for ( int c=0; c<256; c++ ) {
+        pBf->lf.raw[c] = end[c] - top[c];
+        pBf->bytes += pBf->lf.raw[c];
+    }
+    calcLfFromHistogram(&pBf->lf);
+    pBf->offset = to - from;
+    addLf(&grandTotal.lf, &pBf->lf);
+    return true;
+}
+
+/*
+    hlfc query:  the byte ranges of the books (option.sources) by the index, in the book table
+    --range FROM:TO ...:  the ranges of each book (none:  the whole book), cut at the end of the book
+    --window KB:  a range at every --window-step KB, from the top to the end of the book
+    return: number of the ranges, -1 if an index is wrong
+*/
+static int step07_queryIndex(struct bookTable *pT) {
+    unsigned long long window = (unsigned long long)option.window * 1024;
+    unsigned long long step = option.windowStep ? (unsigned long long)option.windowStep * 1024: window;
+    int books = 0;
+    for ( int i=0; i<option.numOfSources; i++ ) {
+        char *bookTitle = option.sources[i].name;
+        struct bookIndex index;
+        struct bookReader reader;
+        int ok = true;
+        if ( !indexOpenRead(&index, bookTitle) ) {
+            return -1;
+        }
+        if ( !readerOpen(&reader, bookTitle) ) {
+            fprintf(stderr, "***Error line %d:  file read open error:  %s\n", __LINE__, bookTitle);
+            fclose(index.fp);
+            return -1;
+        }
+        if ( window ) {
+            for ( unsigned long long from = 0; ok && from < index.size; from += step ) {
+                ok = queryRange(pT, &index, &reader, bookTitle, from, MIN(from + window, index.size));
+                books += ok;
+                if ( from + window >= index.size ) {
+                    break;                          // the last window is at the end of the book
+                }
+            }
+        } else {
+            for ( int r=0; ok && r<MAX(1, option.numOfRanges); r++ ) {
+                unsigned long long from = option.numOfRanges ? option.ranges[r].from: 0;
+                unsigned long long to = option.numOfRanges ? MIN(option.ranges[r].to, index.size): index.size;
+                if ( from > to ) {
+                    fprintf(stderr, "***Warning:  the range %llu: is after the end of the book (%llu bytes):  %s\n", from, index.size, bookTitle);
+                    continue;
+                }
+                ok = queryRange(pT, &index, &reader, bookTitle, from, to);
+                books += ok;
+            }
+        }
+        readerClose(&reader);
+        fclose(index.fp);
+        if ( !ok ) {
+            return -1;
+        }
+    }
+    return books;
+}
+
+/*
+    positive number of the typing model file
+    return: false if the value is not a positive number (*pNumber is not changed)
+*/
+static int typingModelInteger(const char *value, int *pNumber) {
+    char *end;
+    long number = strtol(value, &end, 10);
+    if ( end == value || *end != '\0' || number <= 0 || number > INT_MAX ) {
+        return false;
+    }
+    *pNumber = (int)number;
+    return true;
+}
+
+static int typingModelSecond(const char *value, double *pSecond) {
+    char *end;
+    double second = strtod(value, &end);
+    if ( end == value || *end != '\0' || !(second > 0.) || second == HUGE_VAL ) {
+        return false;
+    }
+    *pSecond = second;
+    return true;
+}
+
+/*
+    read the typing model file (--typing-model FILE)
+    UTF-8 text file.  A line is "key = value", a line which starts with COMMENTSYMBOL is a comment.
+        workingHours, typingHours, daysInYear, lettersPerWord:  same as BUSINESS_* and LETTERS_PER_WORD
+        method      short name of a new method (max 10 letters).  the following keys are for this method
+        name        long name of the method
+        letters     letters on the regular position (CP1250, \xHH for a byte, \\ for \)
+        regular     seconds to type a letter in "letters"
+        unregular   seconds to type the other letter
+    The numbers need to be positive, a method needs both regular and unregular.
+    If the file has a method, the built-in methods are not used.
+    return: false if the file has an error
+*/
+static int step05_readTypingModel(char *fname, struct typingModel *pModel) {
+    FILE *spIn;
+    char linebuf[1024];
+    int lineNo = 0;
+    int methods = 0;
+    struct typingMethod *pM = NULL;
+
+    if ( (spIn=fopenUtf8(fname, "r")) == NULL ) {
+        fprintf(stderr, "***Error line %d:  file read open error:  %s\n", __LINE__, fname);
+        return false;
+    }
+    while ( fgets(linebuf, sizeof(linebuf), spIn) ) {
+        char *trimLine = trim(linebuf);
+        char *key, *value, *eq;
+        int positive = true;
+        lineNo++;
+        if ( lineNo == 1 && strncmp(trimLine, BOM_UTF8, strlen(BOM_UTF8)) == 0 ) {
+            trimLine = trim(trimLine + strlen(BOM_UTF8));
+        }
+        if ( *trimLine == '\0' || *trimLine == COMMENTSYMBOL ) {
+            continue;
+        }
+        if ( (eq = strchr(trimLine, '=')) == NULL ) {
+            fprintf(stderr, "***Error line %d:  %s(%d):  need \"key = value\"\n", __LINE__, fname, lineNo);
+            fclose(spIn);
+            return false;
+        }
+        *eq = '\0';
+        key = trim(trimLine);
+        value = trim(eq+1);
+        if ( strcmp(key, "workingHours") == 0 ) {
+            positive = typingModelInteger(value, &pModel->workingHours);
+        } else if ( strcmp(key, "typingHours") == 0 ) {
+            positive = typingModelInteger(value, &pModel->typingHours);
+        } else if ( strcmp(key, "daysInYear") == 0 ) {
+            positive = typingModelInteger(value, &pModel->daysInYear);
+        } else if ( strcmp(key, "lettersPerWord") == 0 ) {
+            positive = typingModelInteger(value, &pModel->lettersPerWord);
+        } else if ( strcmp(key, "method") == 0 ) {
+            if ( methods >= MAX_TYPINGMETHOD ) {
+                fprintf(stderr, "***Error line %d:  %s(%d):  too many methods (max %d)\n", __LINE__, fname, lineNo, MAX_TYPINGMETHOD);
+                fclose(spIn);
+                return false;
+            }
+            pM = &pModel->method[methods++];
+            memset(pM, 0, sizeof(*pM));
+            pM->shortName10 = strdup(value);
+            pM->name = pM->shortName10;
+        } else if ( pM == NULL ) {
+            fprintf(stderr, "***Error line %d:  %s(%d):  need \"method\" before \"%s\"\n", __LINE__, fname, lineNo, key);
+            fclose(spIn);
+            return false;
+        } else if ( strcmp(key, "name") == 0 ) {
+            pM->name = strdup(value);
+        } else if ( strcmp(key, "letters") == 0 ) {
+            int len = 0;
+            for ( char *p = value; *p && len < sizeof(pM->regularPosition.letter)-1; p++ ) {
+                if ( p[0] == '\\' && p[1] == '\\' ) {
+                    p++;
+                } else if ( p[0] == '\\' && p[1] == 'x' && isxdigit((unsigned char)p[2]) && isxdigit((unsigned char)p[3]) ) {
+                    char hex[3] = { p[2], p[3], '\0' };
+                    pM->regularPosition.letter[len++] = (char)strtol(hex, NULL, 16);
+                    p += 3;
+                    continue;
+                }
+                pM->regularPosition.letter[len++] = *p;
+            }
+        } else if ( strcmp(key, "regular") == 0 ) {
+            positive = typingModelSecond(value, &pM->regularPosition.typeSpeed);
+        } else if ( strcmp(key, "unregular") == 0 ) {
+            positive = typingModelSecond(value, &pM->unregularPosition.typeSpeed);
+        } else {
+            fprintf(stderr, "***Error line %d:  %s(%d):  unknown key \"%s\"\n", __LINE__, fname, lineNo, key);
+            fclose(spIn);
+            return false;
+        }
+        if ( !positive ) {
+            fprintf(stderr, "***Error line %d:  %s(%d):  \"%s\" needs a positive number:  %s\n", __LINE__, fname, lineNo, key, value);
+            fclose(spIn);
+            return false;
+        }
+    }
+    fclose(spIn);
+    for ( int i=0; i<methods; i++ ) {
+        if ( pModel->method[i].regularPosition.typeSpeed <= 0. || pModel->method[i].unregularPosition.typeSpeed <= 0. ) {
+            fprintf(stderr, "***Error line %d:  %s:  method \"%s\" needs \"regular\" and \"unregular\"\n", __LINE__, fname, pModel->method[i].shortName10);
+            return false;
+        }
+    }
+    if ( methods ) {
+        pModel->methods = methods;
+    }
+    pModel->fname = fname;
+    return true;
+}
+
+/*
+    the built-in typing model, or the typing model file, and the cost vector of each method
+    return: false if the typing model file is wrong
+*/
+static int loadTypingModel(struct typingModel *pModel, const char *fname) {
+    memset(pModel, 0, sizeof(*pModel));
+    pModel->workingHours = BUSINESS_WORKINGHOURS;
+    pModel->typingHours = BUSINESS_TYPINGHOURS;
+    pModel->daysInYear = BUSINESS_DAYS_IN_YEAR;
+    pModel->lettersPerWord = LETTERS_PER_WORD;
+    pModel->methods = sizeof(builtinTypingMethod)/sizeof(builtinTypingMethod[0]);
+    memcpy(pModel->method, builtinTypingMethod, sizeof(builtinTypingMethod));
+    if ( fname && !step05_readTypingModel((char *)fname, pModel) ) {
+        return false;
+    }
+    for ( int i=0; i<pModel->methods; i++ ) {
+        compileTypingMethod(&pModel->method[i]);    // cost vector of each typing method
+    }
+    return true;
+}
+
+/*
+    write the result file
+    Input:  fname:  result file name
+            pBf:    pointer of the top of bookFrequency table[]
+            books:  number of books
+    return: false if the file is not able to write
+*/
+static FILE *spResultFile[RESULT_FORMATS];          // file of each --format.  [RESULT_TEXT] is spOutputFile
+static unsigned long long sResultBytes;             // bytes of the printed books, for the grand total line
+
+/*
+    file name of the format:  ".txt" of the result file name is the extension of the format
+    e.g. hlfcResult.txt.tmp -> hlfcResult.csv.tmp
+*/
+static void resultFormatFName(char *dst, int size, const char *fname, int format) {
+    const char *p = strstr(fname, resultFormat[RESULT_TEXT].ext);
+    int len = p ? (int)(p - fname): (int)strlen(fname);
+    snprintf(dst, size, "%.*s%s%s", len, fname, resultFormat[format].ext, p ? p + strlen(resultFormat[RESULT_TEXT].ext): "");
+}
+
+/*
+    close the files of every --format, and the spools of hlfcResult.bin
+*/
+static void closeResultFiles() {
+    for ( int format=0; format<RESULT_FORMATS; format++ ) {
+        if ( spResultFile[format] ) {
+            fclose(spResultFile[format]);
+            spResultFile[format] = NULL;
+        }
+    }
+    spOutputFile = NULL;
+    if ( partialOut.fp ) {                          // not completed
+        fclose(partialOut.fp);
+        partialOut.fp = NULL;
+    }
+    if ( resultBin.spRows ) {
+        fclose(resultBin.spRows);
+        resultBin.spRows = NULL;
+    }
+    if ( resultBin.spTitles ) {
+        fclose(resultBin.spTitles);
+        resultBin.spTitles = NULL;
+    }
+}
+
+static int step12_openResult(char *fname) {
+    sResultBytes = 0;
+    for ( int format=0; format<RESULT_FORMATS; format++ ) {
+        char formatFName[FILENAME_MAX];
+        spResultFile[format] = NULL;
+        if ( !(option.formats & (1 << format)) ) {
+            continue;
+        }
+        resultFormatFName(formatFName, sizeof(formatFName), fname, format);
+        if ( (spResultFile[format]=fopen(formatFName, format == RESULT_BIN ? "wb": "w")) == NULL ) {
+            fprintf(stderr, "***Error line %d: file open error: %s\n", __LINE__, formatFName);
+            closeResultFiles();
+            return false;
+        }
+        setvbuf(spResultFile[format], NULL, _IOFBF, REPORT_FILE_BUFFER);  // the sections of the small books are written together
+    }
+    spOutputFile = spResultFile[RESULT_TEXT];
+    if ( spOutputFile ) {
+        fprintf(spOutputFile, "%s", BOM_UTF8);          // write BOM header to the UTF-8 file.
+    }
+    if ( spResultFile[RESULT_CSV] ) {
+        struct reportBuffer out = { NULL, 0, 0 };
+        step15_printCsvHeader(&out);
+        reportFlush(&out, spResultFile[RESULT_CSV]);
+        reportFree(&out);
+    }
+    if ( option.partialFName && !step17_openPartial(option.partialFName) ) {
+        closeResultFiles();
+        return false;
+    }
+    if ( spResultFile[RESULT_BIN] ) {
+        resultBin.rows = resultBin.titleBytes = 0;
+        if ( (resultBin.spRows = tmpfile()) == NULL || (resultBin.spTitles = tmpfile()) == NULL ) {
+            fprintf(stderr, "***Error line %d:  temporary file open error\n", __LINE__);
+            closeResultFiles();
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+    print the books:  -j N makes the sections of the books by the threads, REPORT_WINDOW books for each thread
+    at once in the report buffers (a buffer for each --format).  Then the buffers are written in the book order.
+*/
+struct reportPool {
+    struct bookFrequency *pBf;                      // the first book of the window
+    struct reportBuffer *pOut;                      // report buffers of each book in the window:  [book][format]
+    int books;                                      // number of the books in the window
+    volatile long next;                             // next book to be taken by a worker
+};
+
+static void *reportWorkerMain(void *arg) {
+    struct reportPool *pPool = arg;
+    long i;
+    while ( (i = atomicFetchAdd(&pPool->next, 1)) < pPool->books ) {
+        struct bookFrequency *pBf = &pPool->pBf[i];
+        struct reportBuffer *pOut = &pPool->pOut[i * RESULT_FORMATS];
+        if ( pBf->bytes == 0 ) {
+            continue;
+        }
+        if ( spResultFile[RESULT_TEXT] ) {
+            // print letter frequency for a book (if you do not need it then you can comment out the following line)
+            step11_printBookFrequency(&pOut[RESULT_TEXT], pBf->bookTitle, &pBf->lf, pBf->pWords, &typingModel);
+            if ( pBf->pSample && pBf->pSample->books ) {
+                step18_printSample(&pOut[RESULT_TEXT], pBf->pSample, &pBf->lf);    // --sample:  the error bounds
+            }
+        }
+        if ( spResultFile[RESULT_CSV] ) {
+            step15_printCsv(&pOut[RESULT_CSV], "book", pBf->bookTitle, pBf->bytes, &pBf->lf);
+        }
+        if ( spResultFile[RESULT_JSON] ) {
+            step15_printJson(&pOut[RESULT_JSON], "book", pBf->bookTitle, pBf->bytes, &pBf->lf);
+        }
+    }
+    return NULL;
+}
+
+static void step12_printBooks(struct bookFrequency *pBf, int books) {
+    int jobs = MAX(1, MIN(option.jobs, books));
+    int window = jobs > 1 ? REPORT_WINDOW * jobs: 1;
+    struct reportBuffer *pOut = calloc((size_t)window * RESULT_FORMATS, sizeof(struct reportBuffer));
+    threadHandle *pThread = calloc(jobs, sizeof(threadHandle));
+    if ( pOut == NULL || pThread == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        free(pOut);
+        free(pThread);
+        return;
+    }
+    int stage = statsEnter(STATS_REPORT);
+    for ( int top=0; top<books; top+=window ) {
+        struct reportPool pool = { &pBf[top], pOut, MIN(window, books - top), 0 };
+        int started = 0;
+        for ( int i=1; i<jobs && i<pool.books; i++ ) {             // this thread is a worker too
+            if ( !threadCreate(&pThread[started], reportWorkerMain, &pool) ) {
+                fprintf(stderr, "***Error line %d:  thread create error\n", __LINE__);
+                break;
+            }
+            started++;
+        }
+        reportWorkerMain(&pool);
+        for ( int i=0; i<started; i++ ) {
+            threadJoin(pThread[i]);
+        }
+        for ( int i=0; i<pool.books; i++ ) {                       // in the book order
+            for ( int format=0; format<RESULT_FORMATS; format++ ) {
+                reportFlush(&pOut[i * RESULT_FORMATS + format], spResultFile[format]);
+            }
+            step17_writePartialBook(&pBf[top + i]);                // every book, the position is the order
+            if ( pBf[top + i].bytes ) {
+                step16_spoolBinRow(pBf[top + i].bookTitle, pBf[top + i].bytes, &pBf[top + i].lf);
+                sResultBytes += pBf[top + i].bytes;
+            }
+            if ( pBf[top + i].pSample ) {
+                addSample(&sampleTotal, pBf[top + i].pSample);    // --sample:  the error bounds of the grand total
+            }
+        }
+    }
+    statsEnter(stage);
+    for ( int i=0; i<window * RESULT_FORMATS; i++ ) {
+        reportFree(&pOut[i]);
+    }
+    free(pThread);
+    free(pOut);
+}
+
+static void step12_closeResult(int books) {
+    struct reportBuffer out = { NULL, 0, 0 };
+    int stage = statsEnter(STATS_REPORT);
+    if ( books ) {
+        if ( spOutputFile ) {
+            // pint letter frequency from every books
+            step11_printBookFrequency(&out, "[Grand Total]", &grandTotal.lf, grandTotal.pWords, &typingModel);
+            if ( sampleTotal.books ) {
+                step18_printSample(&out, &sampleTotal, &grandTotal.lf);
+            }
+            reportFlush(&out, spOutputFile);
+            if ( grandTotal.pNgram ) {
+                step13_printNgram(grandTotal.pNgram, &grandTotal.lf);      // bigrams, trigrams and graphemes
+            }
+        }
+        if ( spResultFile[RESULT_CSV] ) {
+            step15_printCsv(&out, "total", "[Grand Total]", sResultBytes, &grandTotal.lf);
+            reportFlush(&out, spResultFile[RESULT_CSV]);
+        }
+        if ( spResultFile[RESULT_JSON] ) {
+            step15_printJson(&out, "total", "[Grand Total]", sResultBytes, &grandTotal.lf);
+            reportFlush(&out, spResultFile[RESULT_JSON]);
+        }
+        step16_spoolBinRow("[Grand Total]", sResultBytes, &grandTotal.lf);
+    }
+    reportFree(&out);
+    if ( spOutputFile ) {
+        step30_printConfiguration();
+    }
+    if ( spResultFile[RESULT_BIN] ) {
+        step16_writeBinResult(spResultFile[RESULT_BIN]);
+    }
+    step17_closePartial(&grandTotal.lf);
+    closeResultFiles();
+    statsEnter(stage);
+}
+
+static int step12_writeResult(char *fname, struct bookFrequency *pBf, int books) {
+    if ( !step12_openResult(fname) ) {
+        return false;
+    }
+    step12_printBooks(pBf, books);
+    step12_closeResult(books);
+    return true;
+}
+
+/*
+    count the books, and add them to the grand total
+    Input:  pBf:    pointer of the top of bookFrequency table[]
+            books:  number of books
+*/
+static void step08_countBooks(struct bookFrequency *pBf, int books) {
+    int stage = statsEnter(STATS_COUNT);
+    if ( option.jobs > 1 ) {
+        step09_calcBookFrequencyParallel(&grandTotal, pBf, books, option.jobs);
+    }
+    for (int i=0; i<books && option.jobs <= 1; i++) {
+        if ( !pBf[i].cached ) {
+            step10_calcBookFrequency(&pBf[i], 1);       // calculate letter frequency for a book
+        }
+        addLf(&grandTotal.lf, &pBf[i].lf);              // add to the grand total
+    }
+    if ( grandTotal.pNgram ) {
+        sumNgram(grandTotal.pNgram, pBf, books);        // n-gram of the grand total
+    }
+    if ( grandTotal.pWords ) {
+        sumWords(&grandTotal, pBf, books);              // words of the grand total
+    }
+    statsEnter(stage);
+}
+
+/*
+    stream mode:  count and print the books in the table, then the table is used for the next books
+*/
+static void flushBookTable(struct bookTable *pT) {
+    if ( !option.merge && !option.query ) {         // merge:  the books are counted by the shards.  query:  by the index
+        step08_countBooks(pT->pBf, pT->books);
+    }
+    step12_printBooks(pT->pBf, pT->books);
+    pT->books = 0;
+    titleArenaFree(pT, true);
+}
+
+/*
+    Compact mode (--compact)
+    Stream mode:  the table has only COMPACT_BATCH books for each thread, so the state of a book is used again
+    soon after step11_printBookFrequency().
+    --optimize:  every book is printed after the optimizer.  So the counted book is packed in the arena and the
+    table is used again.  A packed book has only the bytes which are in the book, with 32 bits counters.  A counter
+    which does not fit in 32 bits is UINT_MAX, and the count is in the 64 bits spill counters (in the byte order).
+    A book has about 100 different bytes, so a packed book is about 10 times smaller than bookFrequency.
+    The histogram of the counting kernel is also 32 bits, spilled to the 64 bits histogram (flushSubHistogram).
+*/
+static struct packedBook *packBook(struct bookTable *pT, struct bookFrequency *pBf) {
+    struct packedBook *pP;
+    unsigned char *pByte, *pCount, *pSpill;
+    int distinct = 0, spills = 0;
+    for ( int c=0; c<256; c++ ) {
+        distinct += (pBf->lf.raw[c] != 0);
+        spills += (pBf->lf.raw[c] >= UINT_MAX);
+    }
+    if ( (pP = arenaAlloc(pT, sizeof(struct packedBook) + distinct*(1+4) + spills*8, 8)) == NULL ) {
+        return NULL;
+    }
+    pP->bookTitle = pBf->bookTitle;
+    pP->bytes = pBf->bytes;
+    pP->lettersPerWord = pBf->lf.lettersPerWord;
+    pP->pWords = pBf->pWords;
+    pP->distinct = (unsigned short)distinct;
+    pP->spills = (unsigned short)spills;
+    pByte = pP->data;
+    pCount = pByte + distinct;
+    pSpill = pCount + distinct*4;
+    for ( int c=0; c<256; c++ ) {
+        if ( pBf->lf.raw[c] ) {
+            unsigned int count = (unsigned int)MIN(pBf->lf.raw[c], UINT_MAX);
+            *pByte++ = (unsigned char)c;
+            memcpy(pCount, &count, 4);
+            pCount += 4;
+            if ( count == UINT_MAX ) {
+                memcpy(pSpill, &pBf->lf.raw[c], 8);
+                pSpill += 8;
+            }
+        }
+    }
+    return pP;
+}
+
+static void unpackBook(const struct packedBook *pP, struct bookFrequency *pBf) {
+    const unsigned char *pCount = pP->data + pP->distinct;
+    const unsigned char *pSpill = pCount + pP->distinct*4;
+    step02_initializeLf(NULL, pBf, 1);
+    pBf->bookTitle = pP->bookTitle;
+    pBf->bytes = pP->bytes;
+    pBf->pWords = pP->pWords;
+    for ( int i=0; i<pP->distinct; i++ ) {
+        unsigned int count;
+        memcpy(&count, pCount + i*4, 4);
+        if ( count == UINT_MAX ) {
+            memcpy(&pBf->lf.raw[pP->data[i]], pSpill, 8);
+            pSpill += 8;
+        } else {
+            pBf->lf.raw[pP->data[i]] = count;
+        }
+    }
+    calcLfFromHistogram(&pBf->lf);
+    pBf->lf.lettersPerWord = pP->lettersPerWord;
+}
+
+/*
+    --compact --optimize:  count and pack the books in the table, then the table is used again
+*/
+static void packBookTable(struct bookTable *pT) {
+    step08_countBooks(pT->pBf, pT->books);
+    for ( int i=0; i<pT->books; i++ ) {
+        if ( pT->packed == pT->packedCapacity ) {
+            int capacity = pT->packedCapacity ? pT->packedCapacity*2: BOOK_BATCH;
+            struct packedBook **ppNew = realloc(pT->ppPacked, sizeof(struct packedBook *)*capacity);
+            if ( ppNew == NULL ) {
+                fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+                break;
+            }
+            pT->ppPacked = ppNew;
+            pT->packedCapacity = capacity;
+        }
+        if ( (pT->ppPacked[pT->packed] = packBook(pT, &pT->pBf[i])) == NULL ) {
+            fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+            break;
+        }
+        pT->packed++;
+        pT->pBf[i].pWords = NULL;                   // the words are in the packed book now
+    }
+    pT->books = 0;
+}
+
+/*
+    print the packed books, one by one
+*/
+static void step12_printPackedBooks(struct bookTable *pT) {
+    struct bookFrequency *pWork = malloc(sizeof(struct bookFrequency));
+    if ( pWork == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        return;
+    }
+    for ( int i=0; i<pT->packed; i++ ) {
+        unpackBook(pT->ppPacked[i], pWork);
+        step12_printBooks(pWork, 1);
+    }
+    free(pWork);
+}
+
+/*
+    Follow mode (--follow)
+    watch the books in the book list, count only the appended bytes, and write the result file again.
+    Linux:      inotify tells which book is changed.
+    Other OS:   the file size of every book is checked in every interval.
+    The changes in option.followInterval [ms] are put together, so many small appends make one result file.
+    A book which became smaller is counted again from the top.  (appending is expected)
+*/
+#define FOLLOW_EVENTS   (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)   // inotify events to count the book again
+
+static void sleepMs(int ms) {
+#if defined(_WIN32) || defined(_WIN64)
+    Sleep(ms);
+#else
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+/*
+    count the changed books, then write the result file
+    return: true if a book is changed
+*/
+static int followUpdate(char *resultFName, struct bookFrequency *pBf, int books, bool *pDirty) {
+    char tmpFName[512];
+    bool changed = false;
+    for ( int i=0; i<books; i++ ) {
+        unsigned long long size;
+        if ( !pDirty[i] ) {
+            continue;
+        }
+        pDirty[i] = false;
+        size = getFileInfo(pBf[i].bookTitle, NULL);
+        if ( size < pBf[i].offset ) {                   // the book became smaller, count from the top
+            resetBookFrequency(&pBf[i]);
+        }
+        if ( size != pBf[i].offset ) {
+            step10_calcBookFrequency(&pBf[i], option.jobs);
+            changed = true;
+        }
+    }
+    if ( changed ) {
+        memset(&grandTotal.lf, 0, sizeof(grandTotal.lf));
+        for ( int i=0; i<books; i++ ) {
+            addLf(&grandTotal.lf, &pBf[i].lf);
+        }
+        if ( grandTotal.pNgram ) {
+            clearNgram(grandTotal.pNgram);
+            sumNgram(grandTotal.pNgram, pBf, books);
+        }
+        if ( grandTotal.pWords ) {
+            clearWords(grandTotal.pWords);
+            sumWords(&grandTotal, pBf, books);
+        }
+        snprintf(tmpFName, sizeof(tmpFName), "%s.tmp", resultFName);
+        if ( step12_writeResult(tmpFName, pBf, books) ) {   // the reader of the result does not see a half file
+            for ( int format=0; format<RESULT_FORMATS; format++ ) {
+                char fromFName[FILENAME_MAX], toFName[FILENAME_MAX];
+                if ( option.formats & (1 << format) ) {
+                    resultFormatFName(fromFName, sizeof(fromFName), tmpFName, format);
+                    resultFormatFName(toFName, sizeof(toFName), resultFName, format);
+                    remove(toFName);                        // rename() of Windows does not overwrite
+                    rename(fromFName, toFName);
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+static void step50_followBooks(char *resultFName, struct bookFrequency *pBf, int books) {
+    bool *pDirty = calloc(books, sizeof(bool));
+    if ( pDirty == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        return;
+    }
+    fprintf(stderr, "Following %d books, every %d ms.  (Ctrl+C to stop)\n", books, option.followInterval);
+#if defined(__linux__)
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int *pWd = malloc(sizeof(int)*books);               // watch descriptor of each book.  -1: not watched
+    if ( fd >= 0 && pWd ) {
+        for ( int i=0; i<books; i++ ) {
+            pWd[i] = inotify_add_watch(fd, pBf[i].bookTitle, FOLLOW_EVENTS);
+        }
+        for (;;) {
+            char buf[64*1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+            bool unwatched = false;
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            for ( int i=0; i<books; i++ ) {             // watch again the book which was moved or deleted
+                if ( pWd[i] < 0 && (pWd[i] = inotify_add_watch(fd, pBf[i].bookTitle, FOLLOW_EVENTS)) >= 0 ) {
+                    pDirty[i] = true;
+                }
+                unwatched |= (pWd[i] < 0);
+            }
+            followUpdate(resultFName, pBf, books, pDirty);
+            if ( poll(&pfd, 1, unwatched ? option.followInterval: -1) < 0 && errno != EINTR ) {
+                break;
+            }
+            sleepMs(option.followInterval);             // put the changes in the interval together
+            ssize_t len;
+            while ( (len = read(fd, buf, sizeof(buf))) > 0 ) {
+                for ( char *p = buf; p < buf + len; ) {
+                    struct inotify_event *pEv = (struct inotify_event *)p;
+                    for ( int i=0; i<books; i++ ) {
+                        if ( pWd[i] == pEv->wd ) {
+                            pDirty[i] = true;
+                            if ( pEv->mask & (IN_IGNORED | IN_MOVE_SELF | IN_DELETE_SELF) ) {
+                                inotify_rm_watch(fd, pWd[i]);
+                                pWd[i] = -1;            // watch again in the next loop
+                            }
+                        }
+                    }
+                    p += sizeof(struct inotify_event) + pEv->len;
+                }
+            }
+        }
+        fprintf(stderr, "***Error line %d:  inotify error:  %s\n", __LINE__, strerror(errno));
+    }
+    free(pWd);
+    if ( fd >= 0 ) {
+        close(fd);
+    }
+#endif
+    for (;;) {                                          // no inotify:  check the size of every book
+        for ( int i=0; i<books; i++ ) {
+            pDirty[i] = true;
+        }
+        followUpdate(resultFName, pBf, books, pDirty);
+        sleepMs(option.followInterval);
+    }
+}
+
+/*
+    Library (hlfc.h)
+    A context is a document (or a total) counted from the chunks in the memory, by the same counting as step10:
+    countSpan() with the encoding of the document, CRLF and the UTF-8 sequence across the chunks.
+    No global is changed after hlfcInit(), so the contexts of the threads are independent.
+    The typing model of the library is its own (hlfcTypingModel), not the model of the command.
+    Only the hlfc*() functions are global, the other functions and variables are static.
+*/
+static struct typingModel hlfcTypingModel;          // hlfcInit() loads it, the contexts refer to it
+
+struct hlfcContext {
+    struct bookFrequency bf;                        // histogram of the chunks, the encoding of the document
+    struct spanCounter span;                        // CRLF and the UTF-8 decoder between the chunks
+    struct letterFrequency lf;                      // hlfcFinalize():  the counters and the typing times
+    const struct typingModel *pModel;               // typing methods of the typing times and the report
+    int encoding;                                   // encoding of hlfcNew()
+    bool dirty;                                     // updated after hlfcFinalize()
+};
+
+/*
+    the tables of the counter and the report (the command and the library)
+*/
+static void initCounterTables() {
+    initCodepage();                                     // codepage tables, UTF-8 strings of the letters
+    initBarChart();                                     // bar glyphs and the letters of the bar chart
+    initUtf8();                                         // UTF-8 to CP1250 table
+}
+
+/*
+    the tables of the counter, and the typing methods
+    return: false if the typing model file is wrong
+*/
+int hlfcInit(const char *typingModelFName) {
+    initCounterTables();
+    return loadTypingModel(&hlfcTypingModel, typingModelFName);
+}
+
+struct hlfcContext *hlfcNew(int encoding) {
+    struct hlfcContext *pC;
+    if ( encoding < 0 || encoding >= ENCODINGS || (pC = calloc(1, sizeof(struct hlfcContext))) == NULL ) {
+        return NULL;
+    }
+    pC->pModel = &hlfcTypingModel;
+    pC->encoding = encoding;
+    hlfcReset(pC);
+    return pC;
+}
+
+void hlfcReset(struct hlfcContext *pC) {
+    free(pC->span.decoded);
+    memset(&pC->span, 0, sizeof(pC->span));
+    step02_initializeLf(NULL, &pC->bf, 1);
+    pC->bf.encoding = pC->encoding;
+    hlfcFinalize(pC);                                   // zero counters
+}
+
+/*
+    count a chunk of the document
+    return: false if no memory
+*/
+int hlfcUpdate(struct hlfcContext *pC, const void *buf, size_t len) {
+    pC->dirty = true;
+    return len == 0 || countSpan(&pC->bf, &pC->span, buf, len, 1, NULL, NULL);
+}
+
+/*
+    add the counted document (or total) pSrc to pDst.  a chunk of pDst is not continued by pSrc (CRLF, UTF-8)
+*/
+int hlfcMerge(struct hlfcContext *pDst, const struct hlfcContext *pSrc) {
+    for ( int c=0; c<256; c++ ) {
+        pDst->bf.lf.raw[c] += pSrc->bf.lf.raw[c];
+    }
+    pDst->span.crlf += pSrc->span.crlf;
+    pDst->span.letters += pSrc->span.letters;
+    pDst->dirty = true;
+    return true;
+}
+
+/*
+    the counters from the histogram, and the typing time of each method
+*/
+void hlfcFinalize(struct hlfcContext *pC) {
+    memcpy(pC->lf.raw, pC->bf.lf.raw, sizeof(pC->lf.raw));
+    pC->lf.raw['\r'] -= pC->span.crlf;                  // CRLF is one newline
+    calcLfFromHistogram(&pC->lf);
+    calcTypingSeconds(&pC->lf, pC->pModel);
+    pC->dirty = false;
+}
+
+void hlfcGetCounts(struct hlfcContext *pC, struct hlfcCounts *pCounts) {
+    if ( pC->dirty ) {
+        hlfcFinalize(pC);
+    }
+    memset(pCounts, 0, sizeof(*pCounts));
+    pCounts->bytes = pC->span.letters - pC->span.crlf;
+    pCounts->totalLetters = pC->lf.totalLetters;
+    pCounts->totalAlphabets = pC->lf.totalAlphabets;
+    pCounts->totalHungarian = pC->lf.totalHungarian;
+    pCounts->punctuation = pC->lf.punctuation;
+    pCounts->digit = pC->lf.digit;
+    memcpy(pCounts->letter, pC->lf.c, sizeof(pCounts->letter));
+    pCounts->encoding = pC->bf.encoding;
+    pCounts->typingMethods = pC->pModel->methods;
+    for ( int method=0; method<pC->pModel->methods; method++ ) {
+        pCounts->typingSeconds[method] = pC->lf.typingMethod[method].typingSecondForBook;
+    }
+}
+
+/*
+    the report of the document:  the same section as a book in hlfcResult.txt (UTF-8), to the sink
+    return: false if the sink did not write it
+*/
+int hlfcReport(struct hlfcContext *pC, const char *title, hlfcWriteFunc write, void *user) {
+    struct reportBuffer out = { NULL, 0, 0 };
+    int ok;
+    if ( pC->dirty ) {
+        hlfcFinalize(pC);
+    }
+    step11_printBookFrequency(&out, (char *)title, &pC->lf, NULL, pC->pModel);
+    ok = out.p != NULL && write(user, out.p, out.len) == out.len;
+    reportFree(&out);
+    return ok;
+}
+
+void hlfcFree(struct hlfcContext *pC) {
+    if ( pC ) {
+        free(pC->span.decoded);
+        free(pC);
+    }
+}
+
+/*
+    Benchmark (hlfc bench [-j N] [--bench-mb MB] [--bench-books N] [--format LIST] [DIR])
+    The books are synthetic CP1250 text, made from a fixed seed, so every run counts the same bytes.  The letters
+    have the distribution of the [Grand Total] of the sample books (hlfcResult.txt).  Each measurement is repeated
+    for BENCH_SECOND at least.  The books are in the page cache after they are written, so the disk is not measured.
+        [Counting kernel]   the counting kernel on --bench-mb MB in the memory
+        [Distribution]      the letters of the synthetic text against the [Grand Total]
+        [Sweep]             book size sweep (--bench-mb MB of books, --bench-books at most) and book count sweep
+                            (BENCH_BOOK_SIZE books), in a new directory hlfcBench.XXXXXX in DIR (default: the temp
+                            directory).  Only the files written by the bench are removed, with the directory, also
+                            when a book is not able to write or Ctrl+C stops the bench.  For each set:
+                            step10:     step10_calcBookFrequency() of every book by this thread
+                            report:     step11_printBookFrequency() (with step20, step21) of every book, in the memory
+                            end-to-end: the book list from DIR, -j N count, --format files, the same as a run
+    Every count is checked with the bytes written by the generator.  return: false if a count is wrong
+*/
+#define BENCH_SEED          20221028ull             // the same seed makes the same books
+#define BENCH_TABLE         65536                   // letters drawn by 16 bits random numbers
+#define BENCH_UPPER         3                       // percent of the alphabets in upper case (the sample books)
+#define BENCH_SECOND        0.5                     // min seconds of a measurement
+#define BENCH_BOOK_SIZE     (16*1024)               // book size of the book count sweep
+#define BENCH_WRITE_BLOCK   (1024*1024)             // a book is made and written by blocks
+
+/*
+    letters of the synthetic books:  weight in 0.01% of the alphabets.  the alphabets are the bar chart of the
+    [Grand Total], the others are measured in the sample books.  '\n' is written as CRLF.
+*/
+static const struct benchLetter {
+    unsigned char letter;                           // CP1250.  an alphabet is lower case, BENCH_UPPER% become upper case
+    unsigned short weight;
+} benchLetter[] = {
+    { 'e', 1020 }, { 'a', 900 }, { 't', 810 }, { 'n', 630 }, { 'l', 570 }, { 's', 560 }, { 'o', 470 }, { 'i', 450 },
+    { 'k', 450 }, { 'r', 430 }, { 'm', 400 }, { 'z', 370 }, { 'g', 360 }, { 0xe1, 310 }, { 0xe9, 270 }, { 'y', 250 },
+    { 'd', 240 }, { 'h', 200 }, { 'b', 190 }, { 'v', 190 }, { 'u', 130 }, { 'j', 120 }, { 'f', 110 }, { 'c', 110 },
+    { 'p', 100 }, { 0xf6, 100 }, { 0xf3, 80 }, { 0xf5, 70 }, { 0xfc, 50 }, { 0xed, 20 }, { 0xfa, 20 }, { 'w', 10 },
+    { 0xfb, 10 }, { 'x', 1 }, { 'q', 1 },
+    { ' ', 1736 }, { '\n', 289 }, { ',', 216 }, { '.', 129 }, { '-', 41 }, { 0x96, 35 }, { ':', 17 }, { '?', 15 },
+    { '!', 12 }, { '"', 11 }, { '=', 6 }, { ';', 6 }, { 0x85, 6 }, { '_', 5 }, { '(', 5 }, { ')', 5 }, { 0x84, 3 },
+    { 0x93, 3 }, { '*', 2 }, { '1', 6 }, { '0', 1 }, { '2', 1 }, { '3', 1 }, { '4', 1 }, { '5', 1 }, { '6', 1 },
+    { '7', 1 }, { '8', 1 }, { '9', 1 },
+};
+static unsigned char benchTable[BENCH_TABLE];       // the letters, as many as the weight.  made by initBench()
+
+static void initBench() {
+    unsigned long long weight[256] = { 0 };
+    unsigned long long total = 0, sum = 0;
+    int pos = 0;
+    for ( int i=0; i<sizeof(benchLetter)/sizeof(benchLetter[0]); i++ ) {
+        int c = benchLetter[i].letter;
+        int upper = isalpha1250(c) ? benchLetter[i].weight * BENCH_UPPER / 100: 0;
+        weight[c] += benchLetter[i].weight - upper;
+        weight[toupper1250(c)] += upper;
+        total += benchLetter[i].weight;
+    }
+    for ( int c=0; c<256; c++ ) {
+        int end;
+        sum += weight[c];
+        end = (int)(sum * BENCH_TABLE / total);
+        memset(&benchTable[pos], c, end - pos);
+        pos = end;
+    }
+}
+
+static unsigned long long xorshift64(unsigned long long *pState) {
+    unsigned long long x = *pState;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *pState = x;
+}
+
+/*
+    make the synthetic text:  a letter for each 16 bits of the random number.  the newline is CRLF
+    pSeed:  [in/out] state of the random numbers
+    hist:   [in/out] the bytes are added.  the reference of the count
+*/
+static void benchGenerate(unsigned char *p, size_t len, unsigned long long *pSeed, unsigned long long hist[256]) {
+    size_t i = 0;
+    while ( i < len ) {
+        unsigned long long r = xorshift64(pSeed);
+        for ( int k=0; k<4 && i<len; k++, r>>=16 ) {
+            unsigned char c = benchTable[r & (BENCH_TABLE-1)];
+            if ( c == '\n' && i+1 < len ) {
+                p[i++] = '\r';
+                hist['\r']++;
+            } else if ( c == '\n' ) {
+                c = ' ';                                // no room for CRLF at the end of the block
+            }
+            p[i++] = c;
+            hist[c]++;
+        }
+    }
+}
+
+static volatile sig_atomic_t benchStopped;          // Ctrl+C:  the bench stops, then removes its files
+
+static void benchStop(int sig) {
+    benchStopped = 1;
+}
+
+/*
+    make a new directory hlfcBench.XXXXXX in parent (NULL: the temp directory), not an existing one
+    dir:    [out] the name of the directory
+    return: false if the directory is not able to make
+*/
+static int benchMakeDir(char *dir, int size, const char *parent) {
+#if defined(_WIN32) || defined(_WIN64)
+    char temp[MAX_PATH+1];
+    if ( parent == NULL ) {
+        DWORD len = GetTempPathA(sizeof(temp), temp);
+        if ( len == 0 || len >= sizeof(temp) ) {
+            return false;
+        }
+        temp[len-1] = '\0';                         // without the last '\\'
+        parent = temp;
+    }
+    for ( unsigned int i=0; i<100; i++ ) {
+        snprintf(dir, size, "%s" PATH_SEPARATOR "%s.%06u", parent, BENCH_DIR,
+            (unsigned int)(mix64(GetTickCount() ^ ((unsigned long long)GetCurrentProcessId() << 32)) + i) % 1000000);
+        if ( CreateDirectoryA(dir, NULL) ) {
+            return true;
+        } else if ( GetLastError() != ERROR_ALREADY_EXISTS ) {
+            return false;
+        }
+    }
+    return false;
+#else
+    if ( parent == NULL ) {
+        parent = getenv("TMPDIR") != NULL && *getenv("TMPDIR") ? getenv("TMPDIR"): "/tmp";
+    }
+    snprintf(dir, size, "%s" PATH_SEPARATOR "%s.XXXXXX", parent, BENCH_DIR);
+    return mkdtemp(dir) != NULL;
+#endif
+}
+
+static void benchRemoveDir(const char *dir) {
+#if defined(_WIN32) || defined(_WIN64)
+    RemoveDirectoryA(dir);
+#else
+    rmdir(dir);
+#endif
+}
+
+static void benchBookFName(char *fname, int size, const char *dir, int book) {
+    snprintf(fname, size, "%s" PATH_SEPARATOR "book%06d.txt", dir, book);
+}
+
+static const char *benchSizeName(char *str, int size, unsigned long long bytes) {
+    if ( bytes >= 1024*1024 && bytes % (1024*1024) == 0 ) {
+        snprintf(str, size, "%llu MB", bytes / (1024*1024));
+    } else if ( bytes >= 1024 && bytes % 1024 == 0 ) {
+        snprintf(str, size, "%llu KB", bytes / 1024);
+    } else {
+        snprintf(str, size, "%llu B", bytes);
+    }
+    return str;
+}
+
+/*
+    write the books of a set to dir.  the text of a book depends only on its size and its number
+    hist:   [out] the bytes of all the books
+    return: false if a book is not able to write
+*/
+static int step71_generateBooks(const char *dir, int books, unsigned long long bookSize, unsigned long long hist[256]) {
+    unsigned char *buf = malloc((size_t)MIN(bookSize, BENCH_WRITE_BLOCK));
+    int ok = buf != NULL;
+    memset(hist, 0, sizeof(unsigned long long)*256);
+    for ( int book=0; book<books && ok && !benchStopped; book++ ) {
+        char fname[FILENAME_MAX];
+        unsigned long long seed = mix64(BENCH_SEED ^ mix64(bookSize) ^ (unsigned long long)book) | 1;
+        FILE *fp;
+        benchBookFName(fname, sizeof(fname), dir, book);
+        if ( (fp = fopen(fname, "wb")) == NULL ) {
+            fprintf(stderr, "***Error line %d:  file open error:  %s\n", __LINE__, fname);
+            ok = false;
+            break;
+        }
+        for ( unsigned long long done=0; done<bookSize && ok; ) {
+            size_t len = (size_t)MIN(bookSize - done, BENCH_WRITE_BLOCK);
+            benchGenerate(buf, len, &seed, hist);
+            if ( fwrite(buf, 1, len, fp) != len ) {
+                fprintf(stderr, "***Error line %d:  file write error:  %s\n", __LINE__, fname);
+                ok = false;
+            }
+            done += len;
+        }
+        if ( fclose(fp) != 0 ) {
+            ok = false;
+        }
+    }
+    free(buf);
+    return ok;
+}
+
+/*
+    the counting kernel, and the distribution of the synthetic text
+    return: false if the kernel has the other count
+*/
+static int step72_benchKernels(size_t len) {
+    static struct letterFrequency lf;
+    unsigned char *buf = malloc(len);
+    unsigned long long seed = BENCH_SEED;
+    unsigned long long hist[256];
+    unsigned long long alphabetWeight = 0;
+    double maxDiff = 0.;
+    int maxLetter = 0;
+    int ok = true;
+    if ( buf == NULL ) {
+        fprintf(stderr, "***Error line %d:  memory allocation error\n", __LINE__);
+        return false;
+    }
+    memset(lf.raw, 0, sizeof(lf.raw));
+    benchGenerate(buf, len, &seed, lf.raw);
+    printf("[Counting kernel]  %.1f MB in the memory\n", len / (1024.*1024.));
+    {
+        double start, sec;
+        long long reps = 0;
+        memset(hist, 0, sizeof(hist));
+        countHistogram(buf, len, hist);
+        ok = memcmp(hist, lf.raw, sizeof(hist)) == 0;
+        start = elapsedSecond();
+        do {
+            countHistogram(buf, len, hist);
+            reps++;
+        } while ( (sec = elapsedSecond() - start) < BENCH_SECOND );
+        printf("  %9.1f MB/s  %s\n", reps * len / (1024.*1024.) / sec, ok ? "OK": "NG");
+    }
+    calcLfFromHistogram(&lf);
+    for ( int i=0; i<sizeof(benchLetter)/sizeof(benchLetter[0]); i++ ) {
+        alphabetWeight += isalpha1250(benchLetter[i].letter) ? benchLetter[i].weight: 0;
+    }
+    for ( int i=0; i<sizeof(benchLetter)/sizeof(benchLetter[0]); i++ ) {
+        int c = toupper1250(benchLetter[i].letter);
+        double diff;
+        if ( !isalpha1250(c) ) {
+            continue;
+        }
+        diff = fabs(100. * lf.c[c] / lf.totalAlphabets - 100. * benchLetter[i].weight / alphabetWeight);
+        if ( diff >= maxDiff ) {
+            maxDiff = diff;
+            maxLetter = c;
+        }
+    }
+    printf("[Distribution]  max difference from the [Grand Total]:  %.3f%% (%s)  %s\n",
+        maxDiff, toPrintableChar1250(maxLetter), maxDiff < 0.05 ? "OK": "NG");
+    printf("  Punctuations %.1f%%, [0-9] numbers %.1f%%, Hungarian %.1f%%, upper case %d%%\n",
+        100. * lf.punctuation / lf.totalLetters, 100. * lf.digit / lf.totalLetters,
+        100. * lf.totalHungarian / lf.totalAlphabets, BENCH_UPPER);
+    free(buf);
+    return ok;
+}
+
+/*
+    a set of the books:  step10, the report and end-to-end
+    return: false if a count is wrong
+*/
+static int step73_benchBooks(const char *dir, int books, unsigned long long bookSize) {
+    struct bookTable table = { NULL, 0, 0, false, 0, NULL, NULL, NULL, 0, 0, 0 };
+    struct reportBuffer out = { NULL, 0, 0 };
+    unsigned long long expected[256];
+    unsigned long long counted[256];
+    char resultFName[FILENAME_MAX];
+    char sizeName[32];
+    double mb = (double)books * bookSize / (1024.*1024.);
+    double start, sec[3] = { 1., 1., 1. };         // not 0 if a measurement is stopped by an error
+    long long reps[3] = { 0, 0, 0 };
+    int ok = step71_generateBooks(dir, books, bookSize, expected);
+    expected['\r'] = 0;                             // every '\r' is CRLF, one newline
+
+    for ( int book=0; book<books && ok; book++ ) {
+        char fname[FILENAME_MAX];
+        benchBookFName(fname, sizeof(fname), dir, book);
+        ok = addBook(&table, fname);
+    }
+    start = elapsedSecond();                        // step10:  every book by this thread
+    do {
+        memset(counted, 0, sizeof(counted));
+        for ( int i=0; i<table.books; i++ ) {
+            resetBookFrequency(&table.pBf[i]);
+            step10_calcBookFrequency(&table.pBf[i], 1);
+            for ( int c=0; c<256; c++ ) {
+                counted[c] += table.pBf[i].lf.raw[c];
+            }
+        }
+        reps[0]++;
+    } while ( (sec[0] = elapsedSecond() - start) < BENCH_SECOND && ok && !benchStopped );
+    ok &= memcmp(counted, expected, sizeof(counted)) == 0;
+    start = elapsedSecond();                        // report:  in the memory, not written
+    do {
+        for ( int i=0; i<table.books; i++ ) {
+            step11_printBookFrequency(&out, table.pBf[i].bookTitle, &table.pBf[i].lf, NULL, &typingModel);
+            out.len = 0;
+        }
+        reps[1]++;
+    } while ( (sec[1] = elapsedSecond() - start) < BENCH_SECOND && ok && !benchStopped );
+    reportFree(&out);
+    terminate03_readBookList(&table);
+
+    snprintf(resultFName, sizeof(resultFName), "%s" PATH_SEPARATOR "%s", dir, OUTPUTFILE);
+    start = elapsedSecond();                        // end-to-end:  the same as the stream mode of main()
+    do {
+        table.stream = true;
+        table.batch = BOOK_BATCH;
+        table.flush = flushBookTable;
+        step02_initializeLf(&grandTotal, NULL, 0);
+        if ( !step12_openResult(resultFName) ) {
+            ok = false;
+            break;
+        }
+        grandTotal.books = readBookSource((char *)dir, &table);
+        flushBookTable(&table);
+        step12_closeResult(grandTotal.books);
+        terminate03_readBookList(&table);
+        reps[2]++;
+    } while ( (sec[2] = elapsedSecond() - start) < BENCH_SECOND && ok && !benchStopped );
+    ok &= grandTotal.books == books && memcmp(grandTotal.lf.raw, expected, sizeof(expected)) == 0 && !benchStopped;
+
+    if ( !benchStopped ) {
+        printf("  %7d %8s %9.1f | %10.1f %10.0f | %10.0f | %10.1f %10.0f | %s\n", books,
+            benchSizeName(sizeName, sizeof(sizeName), bookSize), mb,
+            reps[0] * mb / sec[0], reps[0] * books / sec[0], reps[1] * books / sec[1],
+            reps[2] * mb / sec[2], reps[2] * books / sec[2], ok ? "OK": "NG");
+        fflush(stdout);
+    }
+    for ( int book=0; book<books; book++ ) {
+        char fname[FILENAME_MAX];
+        benchBookFName(fname, sizeof(fname), dir, book);
+        remove(fname);
+    }
+    for ( int format=0; format<RESULT_FORMATS; format++ ) {
+        char formatFName[FILENAME_MAX];
+        resultFormatFName(formatFName, sizeof(formatFName), resultFName, format);
+        remove(formatFName);
+    }
+    return ok;
+}
+
+/*
+    hlfc bench
+    return: false if a count is wrong, or the bench is stopped
+*/
+static int step70_bench() {
+    char dir[FILENAME_MAX];
+    unsigned long long total = (unsigned long long)option.benchMb * 1024*1024;
+    static const unsigned long long bookSize[] = { 4*1024, 64*1024, 1024*1024, 16*1024*1024 };
+    int ok = true;
+    initBench();
+    printf("%s bench:  -j %d, --bench-mb %d, --bench-books %d, seed %llu\n", PROGNAME, option.jobs, option.benchMb,
+        option.benchBooks, BENCH_SEED);
+    ok &= step72_benchKernels((size_t)total);
+    if ( !benchMakeDir(dir, sizeof(dir), option.numOfSources ? option.sources[0].name: NULL) ) {
+        fprintf(stderr, "***Error line %d:  directory make error:  %s\n", __LINE__, dir);
+        return false;
+    }
+    signal(SIGINT, benchStop);                      // the books are removed by step73_benchBooks(), then the directory
+    signal(SIGTERM, benchStop);
+    printf("[Sweep]  books in %s\n", dir);
+    printf("  %7s %8s %9s | %10s %10s | %10s | %10s %10s | %s\n", "books", "size", "MB", "step10", "step10", "report",
+        "end-to-end", "end-to-end", "check");
+    printf("  %7s %8s %9s | %10s %10s | %10s | %10s %10s |\n", "", "", "", "MB/s", "books/s", "books/s", "MB/s", "books/s");
+    for ( int i=0; i<sizeof(bookSize)/sizeof(bookSize[0]) && bookSize[i] <= total && !benchStopped; i++ ) {
+        int books = (int)MAX(1, MIN((unsigned long long)option.benchBooks, total / bookSize[i]));
+        ok &= step73_benchBooks(dir, books, bookSize[i]);
+    }
+    if ( total > bookSize[sizeof(bookSize)/sizeof(bookSize[0])-1] && !benchStopped ) {
+        ok &= step73_benchBooks(dir, 1, total);     // a large book:  -j N counts it by chunks in end-to-end
+    }
+    for ( int books=1; books<option.benchBooks*10 && !benchStopped; books*=10 ) {
+        ok &= step73_benchBooks(dir, MIN(books, option.benchBooks), BENCH_BOOK_SIZE);
+    }
+    benchRemoveDir(dir);
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    if ( benchStopped ) {
+        fprintf(stderr, "bench is stopped, the books are removed.\n");
+    }
+    return ok && !benchStopped;
+}
+
+/*
+    --stats:  print the run statistics to stderr, and write the JSON sidecar file (--stats-json FILE)
+*/
+static double statsMbPerSecond(unsigned long long bytes, double seconds) {
+    return seconds > 0. ? bytes / (1024.*1024.) / seconds: 0.;
+}
+
+static void step90_printStats() {
+    double wall = 0., cpu = 0., busy = 0.;
+    unsigned long long rss = peakRssKb();
+    statsEnter(STATS_OTHER);                        // the end of the current stage
+    for ( int stage=0; stage<STATS_STAGES; stage++ ) {
+        wall += stats.wall[stage];
+        cpu += stats.cpu[stage];
+    }
+    fprintf(stderr, "[Stats]  wall %.3f s, cpu %.3f s, peak RSS %llu KB, -j %d\n", wall, cpu, rss, option.jobs);
+    fprintf(stderr, "  %-26s %10s %10s\n", "stage", "wall [s]", "cpu [s]");
+    for ( int stage=0; stage<STATS_STAGES; stage++ ) {
+        fprintf(stderr, "  %-26s %10.3f %10.3f\n", statsStageName[stage], stats.wall[stage], stats.cpu[stage]);
+    }
+    fprintf(stderr, "  %-26s %10s %10s\n", "in the threads", "busy [s]", "calls");
+    for ( int kind=0; kind<STATS_BUSY; kind++ ) {
+        fprintf(stderr, "  %-26s %10.3f %10llu\n", statsBusyName[kind], stats.busy[kind], stats.calls[kind]);
+    }
+    busy = stats.busy[STATS_STEP10];
+    fprintf(stderr, "  books %llu, %.1f MB, %.1f MB/s in step10, %.0f books/s\n", stats.books,
+        stats.bytes / (1024.*1024.), statsMbPerSecond(stats.bytes, busy), busy > 0. ? stats.books / busy: 0.);
+    fprintf(stderr, "  read() %llu calls, %.1f MB (%.1f KB/call), mapped %.1f MB\n", stats.reads, stats.readBytes / (1024.*1024.),
+        stats.reads ? stats.readBytes / 1024. / stats.reads: 0., stats.mappedBytes / (1024.*1024.));
+    if ( stats.numOfSlowest ) {
+        fprintf(stderr, "  %-12s %14s %10s  %s\n", "slowest [ms]", "bytes", "MB/s", "book");
+        for ( int i=0; i<stats.numOfSlowest; i++ ) {
+            struct statsBook *pB = &stats.slowest[i];
+            fprintf(stderr, "  %12.3f %14llu %10.1f  %s\n", pB->seconds * 1000., pB->bytes, statsMbPerSecond(pB->bytes, pB->seconds), pB->title);
+        }
+    }
+    if ( option.statsFName ) {
+        struct reportBuffer out = { NULL, 0, 0 };
+        FILE *fp = fopen(option.statsFName, "w");
+        if ( fp == NULL ) {
+            fprintf(stderr, "***Error line %d: file open error: %s\n", __LINE__, option.statsFName);
+        } else {
+            reportPrintf(&out, "{\"wallSeconds\":%.6f,\"cpuSeconds\":%.6f,\"peakRssKb\":%llu,\"jobs\":%d,\"stages\":[",
+                wall, cpu, rss, option.jobs);
+            for ( int stage=0; stage<STATS_STAGES; stage++ ) {
+                reportPrintf(&out, "%s{\"name\":\"%s\",\"wallSeconds\":%.6f,\"cpuSeconds\":%.6f}", stage ? ",": "",
+                    statsStageName[stage], stats.wall[stage], stats.cpu[stage]);
+            }
+            reportPuts(&out, "],\"busy\":[");
+            for ( int kind=0; kind<STATS_BUSY; kind++ ) {
+                reportPrintf(&out, "%s{\"name\":\"%s\",\"seconds\":%.6f,\"calls\":%llu}", kind ? ",": "",
+                    statsBusyName[kind], stats.busy[kind], stats.calls[kind]);
+            }
+            reportPrintf(&out, "],\"books\":%llu,\"bytes\":%llu,\"reads\":%llu,\"readBytes\":%llu,\"mappedBytes\":%llu,\"book\":[",
+                stats.books, stats.bytes, stats.reads, stats.readBytes, stats.mappedBytes);
+            for ( size_t i=0; i<stats.numOfBooks; i++ ) {
+                struct statsBook *pB = &stats.pBook[i];
+                reportPuts(&out, i ? ",{\"title\":": "{\"title\":");
+                reportJsonString(&out, pB->title);
+                reportPrintf(&out, ",\"bytes\":%llu,\"seconds\":%.6f,\"mbPerSecond\":%.3f}", pB->bytes, pB->seconds,
+                    statsMbPerSecond(pB->bytes, pB->seconds));
+                if ( out.len >= REPORT_FILE_BUFFER ) {
+                    reportFlush(&out, fp);
+                }
+            }
+            reportPuts(&out, "]}\n");
+            reportFlush(&out, fp);
+            fclose(fp);
+        }
+        reportFree(&out);
+    }
+}
+
+/*
+    memory free for step90_printStats
+*/
+static void terminate90_printStats() {
+    if ( !option.stats ) {
+        return;
+    }
+    for ( int i=0; i<stats.numOfSlowest; i++ ) {
+        free(stats.slowest[i].title);
+    }
+    for ( size_t i=0; i<stats.numOfBooks; i++ ) {
+        free(stats.pBook[i].title);
+    }
+    free(stats.pBook);
+    mutexDestroy(&stats.mutex);
+    memset(&stats, 0, sizeof(stats));
+}
+
+/*
+    print the usage
+*/
+static void printUsage() {
+    fprintf(stderr, "usage:  %s [-j N] [--cache | --cache-check | --cache-rebuild] [--follow [--follow-interval MS]]\n", PROGNAME);
+    fprintf(stderr, "            [--typing-model FILE] [--optimize] [--ngram [--ngram-top K]]\n");
+    fprintf(stderr, "            [--words [--words-top K] [--words-memory MB]] [--compact] [--encoding NAME] [--format LIST]\n");
+    fprintf(stderr, "            [--shard i/N] [--partial FILE] [--stats] [--stats-json FILE]\n");
+    fprintf(stderr, "            [--sample TOL [--sample-block KB] [--sample-top N]] [--index [--index-block KB]] [--list FILE] [SOURCE ...]\n");
+    fprintf(stderr, "        %s merge [-j N] [--typing-model FILE] [--optimize] [--format LIST] PARTIAL ...\n", PROGNAME);
+    fprintf(stderr, "        %s bench [-j N] [--typing-model FILE] [--format LIST] [--bench-mb MB] [--bench-books N] [DIR]\n", PROGNAME);
+    fprintf(stderr, "        %s query [-j N] [--typing-model FILE] [--format LIST] [--range FROM:TO ...] [--window KB [--window-step KB]] BOOK ...\n", PROGNAME);
+    fprintf(stderr, "  -j N              count N books at the same time by N threads. (0: number of CPUs, default: 1)\n");
+    fprintf(stderr, "  --cache           count only the changed books, the others are from %s\n", CACHEFILE);
+    fprintf(stderr, "  --cache-check     count every book and report the wrong entries in %s, then update it\n", CACHEFILE);
+    fprintf(stderr, "  --cache-rebuild   count every book and make %s again\n", CACHEFILE);
+    fprintf(stderr, "  --follow          keep running, count the bytes appended to the books and write %s again\n", OUTPUTFILE);
+    fprintf(stderr, "  --follow-interval MS  changes in MS milli seconds are put together (default: %d)\n", option.followInterval);
+    fprintf(stderr, "  --typing-model FILE   read the typing methods and the business hours from FILE (e.g. %sTypingModel.txt)\n", PROGNAME);
+    fprintf(stderr, "  --optimize        search the keys of the hungarian letters for the shortest typing time of the books\n");
+    fprintf(stderr, "  --ngram           count the bigrams and the trigrams, report the hungarian letters as graphemes (cs, dzs, ...)\n");
+    fprintf(stderr, "  --ngram-top K     number of bigrams and trigrams in the report (default: %d)\n", option.ngramTop);
+    fprintf(stderr, "  --words           word statistics, and the measured letters per word for the typing time\n");
+    fprintf(stderr, "  --words-top K     number of words in the report (default: %d)\n", option.wordsTop);
+    fprintf(stderr, "  --words-memory MB max memory for the words of all the books (default: %d)\n", option.wordsMemory);
+    fprintf(stderr, "  --compact         bounded memory for very many books:  small batches, packed books (not with --cache, --follow)\n");
+    fprintf(stderr, "  --encoding NAME   encoding of the books:  auto (each book, default), cp1250, utf8, iso8859-2, cp852\n");
+    fprintf(stderr, "  --format LIST     result files, comma separated:  text (%s, default), csv, json, bin\n", OUTPUTFILE);
+    fprintf(stderr, "                    csv, json, bin:  the counts of each book, without the bar charts unless text is listed\n");
+    fprintf(stderr, "  --shard i/N       count only the books at the position k of the book list, k %% N = i-1 (i: 1 .. N)\n");
+    fprintf(stderr, "                    writes only the partial result (%sPart<i>of<N>.bin) unless --format is given\n", PROGNAME);
+    fprintf(stderr, "  --partial FILE    write the histogram of each book to the partial result FILE\n");
+    fprintf(stderr, "  --stats           time of each stage (wall, cpu), the slowest books, read calls and peak RSS to stderr\n");
+    fprintf(stderr, "  --stats-json FILE --stats, and the statistics with every book (bytes, MB/s) in FILE (JSON)\n");
+    fprintf(stderr, "  --sample TOL      estimate a large book from random blocks, until the 95%% confidence interval of every\n");
+    fprintf(stderr, "                    percent in the bar chart is within +-TOL (e.g. 0.1) and the top letters are stable\n");
+    fprintf(stderr, "  --sample-block KB size of a sampled block (default: %d)\n", option.sampleBlock);
+    fprintf(stderr, "  --sample-top N    letters in the ranking to be stable, and their intervals in the report (default: %d)\n", option.sampleTop);
+    fprintf(stderr, "  --index           write the positional index BOOK%s of each counted book, for query\n", INDEX_EXT);
+    fprintf(stderr, "  --index-block KB  bytes between the checkpoints of the index (default: %d).  larger: smaller index, slower query\n", option.indexBlock);
+    fprintf(stderr, "  merge PARTIAL ... the report from the partial results of the shards, same as one process\n");
+    fprintf(stderr, "  bench [DIR]       throughput of the counting kernel, step10, the report and end-to-end runs (MB/s, books/s)\n");
+    fprintf(stderr, "                    on synthetic books in a new directory %s.XXXXXX in DIR (default: the temp directory),\n", BENCH_DIR);
+    fprintf(stderr, "                    and the check of the counts.  the directory is removed\n");
+    fprintf(stderr, "  --bench-mb MB     bench:  memory of the kernels, bytes of the book size sweep (default: %d)\n", option.benchMb);
+    fprintf(stderr, "  --bench-books N   bench:  max books of a set (default: %d)\n", option.benchBooks);
+    fprintf(stderr, "  query BOOK ...    the letters of the byte ranges of the books counted with --index, each range is a book\n");
+    fprintf(stderr, "  --range FROM:TO   query:  bytes [FROM, TO), K M G (1024) e.g. 1M:2M, no TO is the end (default: the whole book)\n");
+    fprintf(stderr, "  --window KB       query:  a range at every step, the time series of the book (e.g. with --format csv)\n");
+    fprintf(stderr, "  --window-step KB  query:  the step of --window (default: the window)\n");
+    fprintf(stderr, "  --list FILE       book list file, one title in a line.  \"-\" is stdin (default: %s without SOURCE)\n", BOOKLIST);
+    fprintf(stderr, "  SOURCE            a book file, a directory (every file, recursively) or a glob pattern\n");
+    fprintf(stderr, "                    a .tar or .zip archive is all its members.  \"archive!member\" is a member\n");
+}
+
+/*
+    bytes of --range:  a number with K, M or G (1024), e.g. 64K.  no number is the empty value
+    ppStr:  [in/out] the string, the next letter after the number
+*/
+static int readBytes(char **ppStr, unsigned long long *pV, unsigned long long empty) {
+    char *end;
+    int shift;
+    if ( !isdigit((unsigned char)**ppStr) ) {
+        *pV = empty;
+        return true;
+    }
+    *pV = strtoull(*ppStr, &end, 10);
+    shift = toupper((unsigned char)*end) == 'K' ? 10: toupper((unsigned char)*end) == 'M' ? 20: toupper((unsigned char)*end) == 'G' ? 30: 0;
+    if ( shift ) {
+        if ( *pV > (ULLONG_MAX >> shift) ) {
+            return false;
+        }
+        *pV <<= shift;
+        end++;
+    }
+    *ppStr = end;
+    return true;
+}
+
+/*
+    read the command line option
+    return: false if the option is wrong
+*/
+static int step00_readOption(int argc, char *argv[]) {
+    static char partialFName[64];
+    bool format = false;
+    bool shard = false;
+    if ( argc > 1 && strcmp(argv[1], "merge") == 0 ) {
+        option.merge = true;                        // hlfc merge [option] FILE ...
+        argv++;
+        argc--;
+    } else if ( argc > 1 && strcmp(argv[1], "bench") == 0 ) {
+        option.bench = true;                        // hlfc bench [option] [DIR]
+        argv++;
+        argc--;
+    } else if ( argc > 1 && strcmp(argv[1], "query") == 0 ) {
+        option.query = true;                        // hlfc query [option] BOOK ...
+        argv++;
+        argc--;
+    }
+    for ( int i=1; i<argc; i++ ) {
+        if ( strncmp(argv[i], "-j", 2) == 0 ) {
+            char *value = argv[i][2] ? &argv[i][2]: (i+1<argc ? argv[++i]: NULL);
+            if ( value == NULL || !isdigit((unsigned char)*value) ) {
+                return false;
+            }
+            option.jobs = atoi(value);
+            if ( option.jobs == 0 ) {
+                option.jobs = numberOfCpu();
+            }
+        } else if ( strcmp(argv[i], "--cache") == 0 ) {
+            option.cache = CACHE_USE;
+        } else if ( strcmp(argv[i], "--cache-check") == 0 ) {
+            option.cache = CACHE_CHECK;
+        } else if ( strcmp(argv[i], "--cache-rebuild") == 0 ) {
+            option.cache = CACHE_REBUILD;
+        } else if ( strcmp(argv[i], "--follow") == 0 ) {
+            option.follow = true;
+        } else if ( strcmp(argv[i], "--follow-interval") == 0 ) {
+            if ( i+1 >= argc || !isdigit((unsigned char)*argv[i+1]) ) {
+                return false;
+            }
+            option.followInterval = atoi(argv[++i]);
+        } else if ( strcmp(argv[i], "--typing-model") == 0 ) {
+            if ( i+1 >= argc ) {
+                return false;
+            }
+            option.typingModelFName = argv[++i];
+        } else if ( strcmp(argv[i], "--optimize") == 0 ) {
+            option.optimize = true;
+        } else if ( strcmp(argv[i], "--ngram") == 0 ) {
+            option.ngram = true;
+        } else if ( strcmp(argv[i], "--ngram-top") == 0 ) {
+            if ( i+1 >= argc || !isdigit((unsigned char)*argv[i+1]) ) {
+                return false;
+            }
+            option.ngramTop = atoi(argv[++i]);
+        } else if ( strcmp(argv[i], "--words") == 0 ) {
+            option.words = true;
+        } else if ( strcmp(argv[i], "--words-top") == 0 ) {
+            if ( i+1 >= argc || !isdigit((unsigned char)*argv[i+1]) ) {
+                return false;
+            }
+            option.wordsTop = atoi(argv[++i]);
+        } else if ( strcmp(argv[i], "--words-memory") == 0 ) {
+            if ( i+1 >= argc || !isdigit((unsigned char)*argv[i+1]) ) {
+                return false;
+            }
+            option.wordsMemory = atoi(argv[++i]);
+        } else if ( strcmp(argv[i], "--compact") == 0 ) {
+            option.compact = true;
+        } else if ( strcmp(argv[i], "--encoding") == 0 ) {
+            if ( ++i >= argc ) {
+                return false;
+            }
+            for ( option.encoding = 0; option.encoding < ENCODINGS && strcmp(argv[i], codepage[option.encoding].name) != 0; option.encoding++ ) {
+            }
+            if ( option.encoding == ENCODINGS ) {
+                return false;
+            }
+        } else if ( strcmp(argv[i], "--format") == 0 ) {
+            if ( ++i >= argc ) {
+                return false;
+            }
+            option.formats = 0;
+            format = true;
+            for ( char *p = argv[i]; *p; ) {
+                int len = (int)strcspn(p, ",");
+                int format = 0;
+                for ( ; format < RESULT_FORMATS && (strncmp(p, resultFormat[format].name, len) != 0 || resultFormat[format].name[len]); format++ ) {
+                }
+                if ( format == RESULT_FORMATS ) {
+                    return false;
+                }
+                option.formats |= 1 << format;
+                p += len + (p[len] == ',');
+            }
+            if ( option.formats == 0 ) {
+                return false;
+            }
+        } else if ( strcmp(argv[i], "--shard") == 0 ) {
+            if ( ++i >= argc || sscanf(argv[i], "%d/%d", &option.shard, &option.shards) != 2
+              || option.shards < 1 || option.shard < 1 || option.shard > option.shards ) {
+                return false;
+            }
+            shard = true;
+        } else if ( strcmp(argv[i], "--partial") == 0 ) {
+            if ( ++i >= argc ) {
+                return false;
+            }
+            option.partialFName = argv[i];
+        } else if ( strcmp(argv[i], "--stats") == 0 ) {
+            option.stats = true;
+        } else if ( strcmp(argv[i], "--stats-json") == 0 ) {
+            if ( ++i >= argc ) {
+                return false;
+            }
+            option.stats = true;
+            option.statsFName = argv[i];
+        } else if ( strcmp(argv[i], "--sample") == 0 ) {
+            if ( i+1 >= argc || (option.sample = atof(argv[i+1])) <= 0. || option.sample > 100. ) {
+                return false;
+            }
+            i++;
+        } else if ( strcmp(argv[i], "--sample-block") == 0 ) {
+            if ( i+1 >= argc || atoi(argv[i+1]) < 1 ) {
+                return false;
+            }
+            option.sampleBlock = MIN(atoi(argv[i+1]), 256*1024);
+            i++;
+        } else if ( strcmp(argv[i], "--sample-top") == 0 ) {
+            if ( i+1 >= argc || atoi(argv[i+1]) < 1 ) {
+                return false;
+            }
+            option.sampleTop = MIN(atoi(argv[i+1]), 256*1024);
+            i++;
+        } else if ( strcmp(argv[i], "--index") == 0 ) {
+            option.index = true;
+        } else if ( strcmp(argv[i], "--index-block") == 0 ) {
+            if ( i+1 >= argc || atoi(argv[i+1]) < 1 ) {
+                return false;
+            }
+            option.indexBlock = MIN(atoi(argv[i+1]), 1024*1024);
+            i++;
+        } else if ( strcmp(argv[i], "--window") == 0 ) {
+            if ( i+1 >= argc || atoi(argv[i+1]) < 1 ) {
+                return false;
+            }
+            option.window = MIN(atoi(argv[i+1]), 1024*1024);
+            i++;
+        } else if ( strcmp(argv[i], "--window-step") == 0 ) {
+            if ( i+1 >= argc || atoi(argv[i+1]) < 1 ) {
+                return false;
+            }
+            option.windowStep = MIN(atoi(argv[i+1]), 1024*1024);
+            i++;
+        } else if ( strcmp(argv[i], "--range") == 0 ) {
+            struct byteRange *pR;
+            char *p;
+            if ( ++i >= argc || (option.ranges == NULL && (option.ranges = calloc(argc, sizeof(struct byteRange))) == NULL) ) {
+                return false;
+            }
+            pR = &option.ranges[option.numOfRanges++];
+            p = argv[i];
+            if ( !readBytes(&p, &pR->from, 0) || *p++ != ':' || !readBytes(&p, &pR->to, ULLONG_MAX) || *p || pR->from >= pR->to ) {
+                return false;
+            }
+        } else if ( strcmp(argv[i], "--bench-mb") == 0 ) {
+            if ( i+1 >= argc || atoi(argv[i+1]) < 1 ) {
+                return false;
+            }
+            option.benchMb = atoi(argv[++i]);
+        } else if ( strcmp(argv[i], "--bench-books") == 0 ) {
+            if ( i+1 >= argc || atoi(argv[i+1]) < 1 ) {
+                return false;
+            }
+            option.benchBooks = atoi(argv[++i]);
+        } else if ( strcmp(argv[i], "--list") == 0 || strcmp(argv[i], "-") == 0 || argv[i][0] != '-' ) {
+            bool list = argv[i][0] == '-';
+            if ( strcmp(argv[i], "--list") == 0 && ++i >= argc ) {
+                return false;
+            }
+            if ( option.sources == NULL && (option.sources = calloc(argc, sizeof(struct bookSource))) == NULL ) {
+                return false;
+            }
+            option.sources[option.numOfSources].list = list;
+            option.sources[option.numOfSources++].name = argv[i];
+        } else {
+            return false;
+        }
+    }
+    if ( shard ) {
+        if ( option.partialFName == NULL ) {
+            snprintf(partialFName, sizeof(partialFName), PARTIAL_FNAME, option.shard, option.shards);
+            option.partialFName = partialFName;
+        }
+        if ( !format ) {
+            option.formats = 0;                     // only the partial result:  the shards can run in the same directory
+        }
+    }
+    if ( (option.partialFName || option.merge) && (option.ngram || option.words) ) {
+        fprintf(stderr, "--ngram and --words are not in the partial result (--shard, --partial, merge).\n");
+        return false;
+    }
+    if ( option.compact && (option.cache || option.follow) ) {
+        fprintf(stderr, "--compact is not used with --cache and --follow.\n");
+        return false;
+    }
+    if ( option.merge && (option.numOfSources == 0 || option.cache || option.follow || option.compact || shard || option.partialFName) ) {
+        fprintf(stderr, "merge needs the partial result files, without --cache, --follow, --compact, --shard and --partial.\n");
+        return false;
+    }
+    if ( option.bench && (option.numOfSources > 1 || (option.numOfSources && option.sources[0].list) || option.cache || option.follow
+                       || option.optimize || option.ngram || option.words || option.compact || shard || option.partialFName || option.stats) ) {
+        fprintf(stderr, "bench has only a directory, without --cache, --follow, --optimize, --ngram, --words, --compact, --shard, --partial and --stats.\n");
+        return false;
+    }
+    if ( option.sample > 0. && (option.merge || option.bench || option.cache || option.follow || option.ngram || option.words
+                             || option.compact || shard || option.partialFName) ) {
+        fprintf(stderr, "--sample is an estimate of the report, without merge, bench, --cache, --follow, --ngram, --words, --compact, --shard and --partial.\n");
+        return false;
+    }
+    if ( option.index && (option.merge || option.bench || option.query || option.sample > 0.) ) {
+        fprintf(stderr, "--index is written by counting the books, without merge, bench, query and --sample.\n");
+        return false;
+    }
+    if ( option.query && (option.numOfSources == 0 || option.cache || option.follow || option.ngram || option.words
+                       || option.compact || shard || option.partialFName || (option.window && option.numOfRanges)) ) {
+        fprintf(stderr, "query needs the books with the index, --range or --window, without --cache, --follow, --ngram, --words, --compact, --shard and --partial.\n");
+        return false;
+    }
+    for ( int i=0; option.query && i<option.numOfSources; i++ ) {
+        if ( option.sources[i].list ) {
+            fprintf(stderr, "query needs the book files, not a book list.\n");
+            return false;
+        }
+    }
+    if ( !option.query && (option.numOfRanges || option.window || option.windowStep) ) {
+        fprintf(stderr, "--range, --window and --window-step are options of query.\n");
+        return false;
+    }
+    return true;
+}
+
+/*
+    main() entry.
+    usage:  hlfc [-j N] [--cache | --cache-check | --cache-rebuild] [--follow [--follow-interval MS]]
+                 [--typing-model FILE] [--optimize] [--ngram [--ngram-top K]]
+                 [--words [--words-top K] [--words-memory MB]] [--compact] [--encoding NAME] [--format LIST]
+                 [--shard i/N] [--partial FILE] [--stats] [--stats-json FILE]
+                 [--sample TOL [--sample-block KB] [--sample-top N]] [--index [--index-block KB]] [--list FILE] [SOURCE ...]
+            hlfc merge [-j N] [--typing-model FILE] [--optimize] [--format LIST] PARTIAL ...
+            hlfc bench [-j N] [--typing-model FILE] [--format LIST] [--bench-mb MB] [--bench-books N] [DIR]
+            hlfc query [-j N] [--typing-model FILE] [--format LIST] [--range FROM:TO ...] [--window KB [--window-step KB]] BOOK ...
+            no parameter is also OK.   Just run the program.
+    Input:  BOOKLIST (PROGNAME "BookList.txt")
+    Ouput:  OUTPUTFILE (PROGNAME "Result.txt"), and ".csv", ".jsonl", ".bin" instead of ".txt" by --format
+    Error:  stderr
+    NOTE:   no main() with -DHLFC_LIBRARY (hlfc.h)
+*/
+#if !defined(HLFC_LIBRARY)
+int main(int argc, char* argv[]) {
+    struct bookTable table = { NULL, 0, 0, false, 0, NULL, NULL, NULL, 0, 0, 0 };
+    if ( !step00_readOption(argc, argv) ) {
+        printUsage();
+        return 1;
+    }
+    if ( option.stats ) {
+        initStats();                                    // the time of the stages from here
+    }
+    setlocale(LC_CTYPE, LC_CTYPE_HUNGARY);              // enable hungarian letters áéíóőöúűü
+    initCounterTables();                                // tables of the counter and the report
+    if ( !loadTypingModel(&typingModel, option.typingModelFName) ) {
+        return 1;
+    }
+    initNgram();                                        // letter index for the trigrams
+    initWords();                                        // lowercase table for the words
+    if ( option.bench ) {
+        return step70_bench() ? 0: 4;                   // the synthetic books, no book list
+    }
+/*
+    fprintf(spOutputFile, "isalpha(0xe1)=%d\n", isalpha(0xe9));
     char barString[3][BARCHART_BARLEN+BARCHART_LEN_PERCENT_NULL];
     printf("%s\n", barChart(&(barString[0][0]), BARCHART_BARLEN, (double)BARCAHRT_SATURATION), 0.0 );
 return 0;
 */
-    int books = step01_countBookList(BOOKLIST);                         // read the book list and get the count of books (only the count)
-    if ( books ) {
-        pBookFrequency = (struct bookFrequency*)
-                                 malloc(sizeof(struct bookFrequency)*books);
-        if ( pBookFrequency ) {
-            step02_initializeLf(&grandTotal, pBookFrequency, books);    // Initialize table of the Letter Frequency for grand total
-            step03_readBookList(BOOKLIST, pBookFrequency, books);       // read each book title (in UTF-8) from the book list
-            for (int i=0; i<books; i++) {
-                if ( step10_calcBookFrequency(&pBookFrequency[i]) ) {   // calculate letter frequency for a book
-                    // print letter frequency for a book (if you do not need it then you can comment out the following line)
-                    step11_printBookFrequency(pBookFrequency[i].bookTitle, &pBookFrequency[i].lf);
-                }
+    step02_initializeLf(&grandTotal, NULL, 0);                          // Initialize table of the Letter Frequency for grand total
+    if ( option.ngram ) {
+        grandTotal.pNgram = newNgram();                                 // n-gram of every book (NULL: no memory, not counted)
+    }
+    if ( option.words ) {
+        grandTotal.pWords = newWords();                                 // words of every book (NULL: no memory, not counted)
+    }
+    table.stream = !(option.cache || option.follow || option.optimize);  // these need all the books at the end
+    table.batch = option.compact ? COMPACT_BATCH*option.jobs: BOOK_BATCH;
+    table.flush = flushBookTable;
+    if ( option.compact && option.optimize ) {
+        table.stream = true;                                            // count and pack, print after the optimizer
+        table.flush = packBookTable;
+    }
+    if ( table.stream && table.flush == flushBookTable && !step12_openResult(OUTPUTFILE) ) {
+        return 2;
+    }
+    int stage = statsEnter(STATS_LIST);
+    int books = option.merge ? step06_readPartials(&table)              // the counted books of the shards
+              : option.query ? step07_queryIndex(&table)                // the ranges of the books by the index
+                             : step03_readBookList(&table);             // read each book title (in UTF-8) from the sources
+    statsEnter(stage);
+    if ( books < 0 ) {
+        return 3;
+    }
+    if ( table.flush == packBookTable ) {
+        packBookTable(&table);                                          // count and pack the last books
+        stage = statsEnter(STATS_OPTIMIZE);
+        step25_optimizeLayout(&grandTotal.lf);                          // add the best keyboard layout as a typing method
+        statsEnter(stage);
+        if ( !step12_openResult(OUTPUTFILE) ) {
+            return 2;
+        }
+        step12_printPackedBooks(&table);
+        step12_closeResult(books);
+    } else if ( table.stream ) {
+        flushBookTable(&table);                                         // count and print the last books
+        step12_closeResult(books);                                      // grand total
+    } else {
+        if ( option.cache ) {
+            stage = statsEnter(STATS_CACHE);
+            step04_readCache(CACHEFILE, &cache, table.pBf, table.books);    // the unchanged books are from the cache
+            statsEnter(stage);
+        }
+        if ( !option.merge && !option.query ) {
+            step08_countBooks(table.pBf, table.books);
+        }
+        if ( option.cache ) {
+            stage = statsEnter(STATS_CACHE);
+            step40_writeCache(CACHEFILE, &cache, table.pBf, table.books);   // keep the histograms for the next run
+            terminate04_readCache(&cache);
+            statsEnter(stage);
+        }
+        if ( option.optimize ) {
+            stage = statsEnter(STATS_OPTIMIZE);
+            step25_optimizeLayout(&grandTotal.lf);                      // add the best keyboard layout as a typing method
+            statsEnter(stage);
+        }
+        if ( !step12_writeResult(OUTPUTFILE, table.pBf, table.books) ) {   // print letter frequency for each book and grand total
+            return 2;
+        }
+        if ( option.follow && table.books ) {
+            if ( option.stats ) {
+                step90_printStats();                                    // the first run, before the changes
             }
-            // pint letter frequency from every books
-            step11_printBookFrequency("[Grand Total]", &grandTotal.lf);
+            step50_followBooks(OUTPUTFILE, table.pBf, table.books);     // never returns, until Ctrl+C
         }
     }
-    step30_printConfiguration();
-    terminate03_readBookList(NULL, pBookFrequency, books);                   // terminate procedure, free()
-    fclose(spOutputFile);
-    free(pBookFrequency);
-}
\ No newline at end of file
+    if ( option.stats ) {
+        step90_printStats();                                            // time of each stage, the books and the reads
+    }
+    freeNgram(grandTotal.pNgram);
+    freeWords(grandTotal.pWords);
+    freeNgramPool();
+    terminate90_printStats();
+    terminate03_readBookList(&table);                                   // terminate procedure, free()
+    free(option.sources);
+    free(option.ranges);
+}
+#endif
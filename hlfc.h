@@ -0,0 +1,54 @@
+/*************************************************************************************************************
+
+   hlfc.h - Hungarian letter frequency counter, the library
+   Build:   compile hlfc.c with -DHLFC_LIBRARY (no main()) and link it with the program which includes this header.
+   Usage:   hlfcInit(NULL);                                     // once, before the other functions and the threads
+            struct hlfcContext *pC = hlfcNew(HLFC_ENCODING_AUTO);
+            hlfcUpdate(pC, buf, len);                           // the chunks of a document, in the order
+            hlfcFinalize(pC);                                   // the counters and the typing times
+            hlfcGetCounts(pC, &counts);
+            hlfcReport(pC, "title", write, user);               // the same section as in hlfcResult.txt
+            hlfcFree(pC);
+   NOTE:    A context is used by one thread at a time.  The contexts are independent, so each thread can count
+            its documents.  hlfcMerge() adds a counted document to the other context (e.g. the grand total).
+            A context can be updated again after hlfcFinalize():  the counters are of all the chunks.
+ *************************************************************************************************************/
+#ifndef HLFC_H
+#define HLFC_H
+#include <stddef.h>
+
+#define HLFC_ENCODING_AUTO          0               // decided by the first non-ASCII bytes of the document
+#define HLFC_ENCODING_CP1250        1
+#define HLFC_ENCODING_UTF8          2
+#define HLFC_ENCODING_ISO8859_2     3
+#define HLFC_ENCODING_CP852         4               // DOS Central Europe
+#define HLFC_MAX_TYPINGMETHOD       64              // max number of the typing methods
+
+struct hlfcContext;
+
+struct hlfcCounts {
+    unsigned long long bytes;                       // letters of the document (CRLF is one newline)
+    unsigned long long totalLetters;                // letters without white space
+    unsigned long long totalAlphabets;              // hungarian alphabets
+    unsigned long long totalHungarian;              // hungarian special letters áéíóőöúűü ÁÉÍÓŐÖÚŰÜ
+    unsigned long long punctuation;
+    unsigned long long digit;                       // [0-9] numbers
+    unsigned long long letter[256];                 // count of each CP1250 letter, upper case
+    int encoding;                                   // HLFC_ENCODING_*.  HLFC_ENCODING_AUTO: only ASCII so far
+    int typingMethods;                              // number of the typing methods
+    double typingSeconds[HLFC_MAX_TYPINGMETHOD];    // typing time of the document by each method
+};
+
+typedef size_t (*hlfcWriteFunc)(void *user, const char *data, size_t len);  // return: len if written
+
+int hlfcInit(const char *typingModelFName);         // typingModelFName:  NULL is the built-in typing methods
+struct hlfcContext *hlfcNew(int encoding);          // return: NULL if no memory or a wrong encoding
+void hlfcReset(struct hlfcContext *pC);             // a new document, the same encoding as hlfcNew()
+int hlfcUpdate(struct hlfcContext *pC, const void *buf, size_t len);
+int hlfcMerge(struct hlfcContext *pDst, const struct hlfcContext *pSrc);
+void hlfcFinalize(struct hlfcContext *pC);
+void hlfcGetCounts(struct hlfcContext *pC, struct hlfcCounts *pCounts);
+int hlfcReport(struct hlfcContext *pC, const char *title, hlfcWriteFunc write, void *user);
+void hlfcFree(struct hlfcContext *pC);
+
+#endif